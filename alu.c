@@ -0,0 +1,79 @@
+/**
+ * @file: alu.c
+ * @desc: Defines the parity table and the computation of the arithmetic
+ *        flags left pending by alu().
+ */
+
+#include "alu.h"
+
+/* Parity of 2, 4 and 6 bit counts, n is the parity of the bits above. */
+#define P2(n) n, n ^ 1, n ^ 1, n
+#define P4(n) P2(n), P2(n ^ 1), P2(n ^ 1), P2(n)
+#define P6(n) P4(n), P4(n ^ 1), P4(n ^ 1), P4(n)
+
+const uint8_t parity_tab[256] = {
+	P6(1), P6(0), P6(0), P6(1)
+};
+
+/**
+ * CF and OF of an operation at one width - ut and st are its unsigned
+ * and signed types. The overflow builtins compile to the add or sub and
+ * a setc/seto, without comparing against the limits.
+ */
+#define CARRY(ut, st, op, d, s, cf, of)                                        \
+	do {                                                                       \
+		ut u_;                                                                 \
+		st s_;                                                                 \
+		switch (op) {                                                          \
+		case LZ_ADD:                                                           \
+			cf = __builtin_add_overflow((ut)(d), (ut)(s), &u_);                \
+			of = __builtin_add_overflow((st)(d), (st)(s), &s_);                \
+			break;                                                             \
+		case LZ_SUB:                                                           \
+			cf = __builtin_sub_overflow((ut)(d), (ut)(s), &u_);                \
+			of = __builtin_sub_overflow((st)(d), (st)(s), &s_);                \
+			break;                                                             \
+		case LZ_INC:                                                           \
+			of = __builtin_add_overflow((st)(d), (st)(s), &s_);                \
+			break;                                                             \
+		case LZ_DEC:                                                           \
+			of = __builtin_sub_overflow((st)(d), (st)(s), &s_);                \
+			break;                                                             \
+		case LZ_MUL:                                                           \
+			cf = of = __builtin_mul_overflow((st)(d), (st)(s), &s_);           \
+			break;                                                             \
+		}                                                                      \
+	} while (0)
+
+/**
+ * @desc  : Computes AF, CF, OF, PF, SF and ZF from the operation left
+ *          pending by flags_defer(), the way the 8086 sets them. INC and
+ *          DEC keep CF, MUL sets CF and OF when the product does not fit
+ *          its width and clears AF.
+ * @param : flags -
+ * @return: void
+ */
+void flags_eval(flags_t *flags) {
+	int op = flags->lz_op, w = flags->lz_w;
+	int d = flags->lz_dst, s = flags->lz_src, r = flags->lz_res;
+	int cf = flags->cf, of = 0;
+
+	if (op == LZ_NONE) {
+		return;
+	}
+
+	if (w == 8) {
+		CARRY(uint8_t, int8_t, op, d, s, cf, of);
+	} else {
+		CARRY(uint16_t, int16_t, op, d, s, cf, of);
+	}
+
+	unsigned u = r & (w == 8 ? 0xff : 0xffff);
+	flags->cf = cf;
+	flags->of = of;
+	flags->af = ((d ^ s ^ r) >> 4) & (op != LZ_MUL);
+	flags->zf = u == 0;
+	flags->sf = u >> (w - 1);
+	flags->pf = parity_tab[u & 0xff];
+	flags->lz_op = LZ_NONE;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file: alu.h
+ * @desc: Declares the arithmetic shared by ADD, SUB, MUL, CMP, INC, DEC
+ *        and NEG, and the parity table the flags are computed with.
+ */
+
+#ifndef _ASE_ALU_H_
+#define _ASE_ALU_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "flags.h"
+#include "glob.h"
+#include "tengine.h"
+
+/* alu() results. */
+#define ALU_OK    1
+#define ALU_STORE 2
+
+/* parity_tab[b] is 1 if b has an even number of bits set - PF of b. */
+extern const uint8_t parity_tab[256];
+
+/**
+ * @desc  : Computes an operation on two signed values and leaves the
+ *          flags it sets pending, see flags_defer(). INC, DEC and NEG
+ *          take the value in dval and wrap around, ADD fails once its
+ *          result does not fit width.
+ * @param : glob  -
+ *          opc   - OPC_ADD, OPC_SUB, OPC_MUL, OPC_CMP, OPC_INC, OPC_DEC
+ *                  or OPC_NEG.
+ *          dval  - destination value.
+ *          sval  - source value, unused by INC, DEC and NEG.
+ *          width - width of the destination, 8 or 16.
+ *          res   - receives the result.
+ * @return: int   - ALU_OK if it succeeded, with ALU_STORE if res is to be
+ *                  written to the destination.
+ */
+static inline int alu(glob_t *glob, int opc, int dval, int sval, int width, int *res) {
+	*res = 0;
+
+	switch (opc) {
+	case OPC_ADD: {
+		int ans = dval + sval;
+		int max = width == 8 ? 127 : 32767;
+		flags_defer(glob->flags, LZ_ADD, width, dval, sval, ans);
+
+		if (ans > max || ans < -max - 1) {
+			fprintf(stderr, "Overflow: operand value exceeds the limits.\n");
+			return ALU_STORE;
+		}
+
+		*res = ans;
+		return ALU_OK | ALU_STORE;
+	}
+	case OPC_SUB:
+		*res = dval - sval;
+		flags_defer(glob->flags, LZ_SUB, width, dval, sval, *res);
+		return ALU_OK | ALU_STORE;
+	case OPC_MUL:
+		*res = dval * sval;
+		flags_defer(glob->flags, LZ_MUL, width, dval, sval, *res);
+		return ALU_OK | ALU_STORE;
+	case OPC_CMP:
+		/* SUB without the store. */
+		flags_defer(glob->flags, LZ_SUB, width, dval, sval, dval - sval);
+		return ALU_OK;
+	case OPC_INC:
+		*res = dval + 1;
+		flags_defer(glob->flags, LZ_INC, width, dval, 1, *res);
+		return ALU_OK | ALU_STORE;
+	case OPC_DEC:
+		*res = dval - 1;
+		flags_defer(glob->flags, LZ_DEC, width, dval, 1, *res);
+		return ALU_OK | ALU_STORE;
+	case OPC_NEG:
+		/* 0 - dval, CF is set unless it is 0. */
+		*res = -dval;
+		flags_defer(glob->flags, LZ_SUB, width, 0, dval, *res);
+		return ALU_OK | ALU_STORE;
+	}
+
+	return 0;
+}
+
+#endif
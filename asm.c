@@ -0,0 +1,525 @@
+/**
+ * @file: asm.c
+ * @desc: Defines functions that assemble a source file into an
+ *        in-memory instruction array before execution.
+ *
+ *        The source is tokenised exactly once. Execution then
+ *        walks the array with an instruction pointer (glob->ip), so a
+ *        jump is a plain index assignment instead of a file seek.
+ */
+
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "asm.h"
+
+/* Smallest chunk worth a thread of its own when glob->jobs is 0. */
+#define ASM_CHUNK_MIN (256 * 1024)
+#define ASM_MAX_JOBS  64
+
+/* Line aligned slice of the source, assembled on its own thread. */
+typedef struct chunk {
+	/**
+	 * begin, end - Slice of the source.
+	 * first_line - Number of lines before begin.
+	 * last_line  - Last line tokenised, the failing one if !ok.
+	 * prog       - Instructions, lines and labels of the slice. Label
+	 *              indices are relative to the slice.
+	 * refs       - Label operand of every instruction in prog.
+	 * lo, hi     - Range of the slice in the merged program.
+	 * whole      - Merged program, refs_all - its label operands.
+	 * bad        - First jump in lo..hi to an undeclared label.
+	 */
+	const char *begin, *end;
+	int first_line, last_line, ok, spawned;
+	prog_t *prog;
+	tok_t *refs;
+	int r_cap;
+
+	int lo, hi, bad;
+	prog_t *whole;
+	tok_t *refs_all;
+	pthread_t thread;
+} chunk_t;
+
+/**
+ * @desc  : Returns the next free instruction slot of the program.
+ * @param : prog     - program being assembled.
+ * @return: instr_t* - free slot, or NULL.
+ */
+static instr_t *next_instr(prog_t *prog) {
+	if (prog->n == prog->cap) {
+		int cap = prog->cap ? prog->cap * 2 : 64;
+		instr_t *instrs = realloc(prog->instrs, cap * sizeof(instr_t));
+		if (!instrs) {
+			fprintf(stderr, "next_instr(): realloc failure.\n");
+			return NULL;
+		}
+
+		prog->instrs = instrs;
+		prog->cap = cap;
+	}
+
+	return &prog->instrs[prog->n];
+}
+
+/**
+ * @desc  : Records the offset of a source line in the line map.
+ * @param : prog - program being assembled.
+ *          off  - offset of the line into the source text.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+static int add_line(prog_t *prog, unsigned int off) {
+	if (prog->n_lines == prog->l_cap) {
+		int cap = prog->l_cap ? prog->l_cap * 2 : 256;
+		unsigned int *lines = realloc(prog->lines, cap * sizeof(unsigned int));
+		if (!lines) {
+			fprintf(stderr, "add_line(): realloc failure.\n");
+			return 0;
+		}
+
+		prog->lines = lines;
+		prog->l_cap = cap;
+	}
+
+	prog->lines[prog->n_lines++] = off;
+	return 1;
+}
+
+/**
+ * @desc  : Resolves the label operand of every jump in a range of the
+ *          merged program to the index of the instruction it points
+ *          to. The label table is only read, so ranges can be resolved
+ *          concurrently.
+ * @param : arg   - chunk_t whose lo..hi range to resolve.
+ * @return: void* - NULL, the first jump to an undeclared label is left
+ *                  in chunk->bad, -1 if none.
+ */
+static void *resolve_chunk(void *arg) {
+	chunk_t *ch = arg;
+	prog_t *prog = ch->whole;
+
+	ch->bad = -1;
+	for (int i = ch->lo; i < ch->hi; i++) {
+		instr_t *instr = &prog->instrs[i];
+		/* Every instruction beginning with J takes a label. */
+		if (instr->ops[0].kind != OP_LABEL || instr->n_op != 1) {
+			continue;
+		}
+
+		tok_t *ref = &ch->refs_all[i];
+		sym_t *sym = find_sym(prog->labels, ref->ptr, ref->len);
+		if (!sym) {
+			ch->bad = i;
+			break;
+		}
+
+		instr->target = sym->idx;
+	}
+
+	return NULL;
+}
+
+/**
+ * @desc  : Runs fn on every chunk, the first one on the calling thread
+ *          and the others on threads of their own. A chunk whose thread
+ *          cannot be started runs on the calling thread as well.
+ * @param : ch - chunks.
+ *          n  - number of chunks.
+ *          fn - assemble_chunk() or resolve_chunk().
+ * @return: void
+ */
+static void run_chunks(chunk_t *ch, int n, void *(*fn)(void *)) {
+	for (int i = 1; i < n; i++) {
+		ch[i].spawned = !pthread_create(&ch[i].thread, NULL, fn, &ch[i]);
+	}
+
+	fn(&ch[0]);
+	for (int i = 1; i < n; i++) {
+		if (ch[i].spawned) {
+			pthread_join(ch[i].thread, NULL);
+		} else {
+			fn(&ch[i]);
+		}
+	}
+}
+
+/**
+ * @desc  : Allocates an empty program over src.
+ * @param : src     - mapped source file.
+ * @return: prog_t* - the program, or NULL.
+ */
+static prog_t *init_prog(src_t *src) {
+	prog_t *prog = calloc(1, sizeof(prog_t));
+	if (prog) {
+		prog->labels = init_symtab();
+		prog->text = src->base;
+		prog->text_len = src->len;
+	}
+
+	if (!prog || !prog->labels) {
+		fprintf(stderr, "init_prog(): malloc failure.\n");
+		destroy_prog(prog);
+		return NULL;
+	}
+
+	return prog;
+}
+
+/**
+ * @desc  : Tokenises the lines of a chunk into its own program. Only
+ *          touches the chunk, so chunks can be assembled concurrently.
+ * @param : arg   - chunk_t to assemble.
+ * @return: void* - NULL, the result is left in chunk->ok.
+ */
+static void *assemble_chunk(void *arg) {
+	chunk_t *ch = arg;
+	prog_t *prog = ch->prog;
+	const char *ptr = ch->begin;
+	int ln = ch->first_line;
+
+	ch->ok = 1;
+	while (ptr < ch->end) {
+		const char *eol = memchr(ptr, '\n', ch->end - ptr);
+		const char *next = eol ? eol + 1 : ch->end;
+		ln++;
+
+		if (!add_line(prog, ptr - prog->text)) {
+			ch->ok = 0;
+			break;
+		}
+
+		if (should_skip_ln(ptr)) {
+			ptr = next;
+			continue;
+		}
+
+		tok_t toks[3], label;
+		instr_t *instr = next_instr(prog);
+		if (!instr || !tokenize(ptr, eol ? eol : ch->end, ln, instr, toks, &label) ||
+		    !decode_instr(instr, toks)) {
+			fprintf(stderr, "Could not parse line.\n");
+			ch->ok = 0;
+			break;
+		}
+
+		if (label.len && !add_sym(prog->labels, &label, ln, prog->n)) {
+			ch->ok = 0;
+			break;
+		}
+
+		/* A line holding only a label adds no instruction. */
+		if (toks[0].len) {
+			if (ch->r_cap < prog->cap) {
+				tok_t *tmp = realloc(ch->refs, prog->cap * sizeof(tok_t));
+				if (!tmp) {
+					fprintf(stderr, "assemble_chunk(): realloc failure.\n");
+					ch->ok = 0;
+					break;
+				}
+
+				ch->refs = tmp;
+				ch->r_cap = prog->cap;
+			}
+
+			ch->refs[prog->n++] = toks[1];
+		}
+
+		ptr = next;
+	}
+
+	ch->last_line = ln;
+	return NULL;
+}
+
+/**
+ * @desc  : Picks the number of chunks to split src into.
+ * @param : glob -
+ *          src  - mapped source file.
+ * @return: int  - number of chunks, at least 1.
+ */
+static int count_chunks(glob_t *glob, src_t *src) {
+	long n = glob->jobs;
+	if (n <= 0) {
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+		if (n > (long)(src->len / ASM_CHUNK_MIN)) {
+			n = src->len / ASM_CHUNK_MIN;
+		}
+	}
+
+	return n < 1 ? 1 : n > ASM_MAX_JOBS ? ASM_MAX_JOBS : (int)n;
+}
+
+/**
+ * @desc  : Splits src into line aligned chunks of about the same size.
+ *          Counting line breaks is far cheaper than tokenising them, so
+ *          the first line of every chunk is found up front and each
+ *          chunk reports errors with the real line number.
+ * @param : src - mapped source file.
+ *          ch  - chunks to fill, the first one already holds prog.
+ *          n   - number of chunks.
+ * @return: int - 0 if fail, 1 if success.
+ */
+static int split_chunks(src_t *src, chunk_t *ch, int n) {
+	const char *end = src->base + src->len;
+	const char *ptr = src->base;
+	int ln = 0;
+
+	for (int i = 0; i < n; i++) {
+		const char *stop = i == n - 1 ? end : src->base + src->len / n * (i + 1);
+		if (stop < ptr) {
+			stop = ptr;
+		}
+
+		/* Move the boundary past the end of the line it falls in. */
+		if (stop < end && stop > src->base && stop[-1] != '\n') {
+			const char *eol = memchr(stop, '\n', end - stop);
+			stop = eol ? eol + 1 : end;
+		}
+
+		ch[i].begin = ptr;
+		ch[i].end = stop;
+		ch[i].first_line = ln;
+
+		if (i && !(ch[i].prog = init_prog(src))) {
+			return 0;
+		}
+
+		for (; ptr < stop && (ptr = memchr(ptr, '\n', stop - ptr)); ptr++, ln++);
+		ptr = stop;
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Appends every chunk to the program of the first one, in
+ *          source order, and moves their labels into its label table.
+ *          Errors are reported for the earliest chunk that failed, as
+ *          a single pass over the whole source would.
+ * @param : glob -
+ *          ch   - assembled chunks.
+ *          n    - number of chunks.
+ * @return: int  - 0 if a chunk failed or a label is duplicated, 1 if
+ *                 success.
+ */
+static int merge_chunks(glob_t *glob, chunk_t *ch, int n) {
+	prog_t *prog = ch[0].prog;
+	int n_instrs = 0, n_lines = 0;
+
+	for (int i = 0; i < n; i++) {
+		n_instrs += ch[i].prog->n;
+		n_lines += ch[i].prog->n_lines;
+	}
+
+	if (n_instrs > prog->cap) {
+		instr_t *instrs = realloc(prog->instrs, n_instrs * sizeof(instr_t));
+		prog->instrs = instrs ? instrs : prog->instrs;
+		prog->cap = instrs ? n_instrs : prog->cap;
+
+		tok_t *refs = realloc(ch[0].refs, n_instrs * sizeof(tok_t));
+		ch[0].refs = refs ? refs : ch[0].refs;
+		ch[0].r_cap = refs ? n_instrs : ch[0].r_cap;
+	}
+
+	if (n_lines > prog->l_cap) {
+		unsigned int *lines = realloc(prog->lines, n_lines * sizeof(unsigned int));
+		prog->lines = lines ? lines : prog->lines;
+		prog->l_cap = lines ? n_lines : prog->l_cap;
+	}
+
+	if (prog->cap < n_instrs || ch[0].r_cap < n_instrs || prog->l_cap < n_lines) {
+		fprintf(stderr, "merge_chunks(): realloc failure.\n");
+		return 0;
+	}
+
+	for (int i = 0; i < n; i++) {
+		if (!ch[i].ok) {
+			glob->c_line = ch[i].last_line;
+			return 0;
+		}
+
+		ch[i].lo = i ? prog->n : 0;
+		ch[i].hi = ch[i].lo + ch[i].prog->n;
+		if (!i) {
+			continue;
+		}
+
+		prog_t *part = ch[i].prog;
+		int base = prog->n;
+		for (int j = 0; j < part->labels->n; j++) {
+			sym_t *sym = &part->labels->syms[j];
+			if (!add_sym(prog->labels, &sym->name, sym->line, sym->idx + base)) {
+				glob->c_line = sym->line;
+				return 0;
+			}
+		}
+
+		memcpy(prog->instrs + base, part->instrs, part->n * sizeof(instr_t));
+		memcpy(ch[0].refs + base, ch[i].refs, part->n * sizeof(tok_t));
+		memcpy(prog->lines + prog->n_lines, part->lines, part->n_lines * sizeof(unsigned int));
+		prog->n += part->n;
+		prog->n_lines += part->n_lines;
+	}
+
+	for (int i = 0; i < n; i++) {
+		ch[i].whole = prog;
+		ch[i].refs_all = ch[0].refs;
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Tokenises the whole source into an instruction array and
+ *          collects every label in the same pass. Jump targets are then
+ *          resolved once, against the complete label table.
+ *          Large sources are split into line aligned chunks assembled
+ *          on glob->jobs threads, then merged in source order.
+ *          Label names are views into src, so src must outlive the
+ *          program.
+ * @param : glob -
+ *          src  - mapped source file.
+ * @return: prog_t* - assembled program, or NULL if a line could not
+ *                    be parsed or a label is duplicated or undefined.
+ */
+prog_t *assemble(glob_t *glob, src_t *src) {
+	if (!glob || !src) {
+		fprintf(stderr, "assemble(): nullptr received.\n");
+		return NULL;
+	}
+
+	chunk_t ch[ASM_MAX_JOBS];
+	int n = count_chunks(glob, src), ok = 1;
+
+	memset(ch, 0, n * sizeof(chunk_t));
+	if (!(ch[0].prog = init_prog(src))) {
+		return NULL;
+	}
+
+	ok = split_chunks(src, ch, n);
+
+	if (ok) {
+		run_chunks(ch, n, assemble_chunk);
+		ok = merge_chunks(glob, ch, n);
+	}
+
+	if (ok) {
+		run_chunks(ch, n, resolve_chunk);
+		for (int i = 0; ok && i < n; i++) {
+			if (ch[i].bad >= 0) {
+				instr_t *instr = &ch[0].prog->instrs[ch[i].bad];
+				tok_t *ref = &ch[0].refs[ch[i].bad];
+				glob->c_line = instr->line;
+				fprintf(stderr, "Undefined label [%.*s] @ [%d].\n",
+					ref->len, ref->ptr, instr->line);
+				ok = 0;
+			}
+		}
+	}
+
+	prog_t *prog = ch[0].prog;
+	for (int i = 0; i < n; i++) {
+		free(ch[i].refs);
+		if (i) {
+			destroy_prog(ch[i].prog);
+		}
+	}
+
+	if (!ok) {
+		destroy_prog(prog);
+		return NULL;
+	}
+
+	glob->c_line = prog->n_lines;
+	return prog;
+}
+
+/**
+ * @desc  : Tokenises a line aligned slice of the source into a program
+ *          of its own, leaving jumps unresolved. Used to re-assemble the
+ *          lines of a source that changed.
+ * @param : glob       -
+ *          src        - source the slice belongs to.
+ *          begin, end - the slice.
+ *          first_line - number of lines before begin.
+ *          refs       - receives the label operand of every instruction,
+ *                       to be freed by the caller.
+ * @return: prog_t* - the slice, label indices relative to its first
+ *                    instruction, or NULL if a line could not be parsed.
+ */
+prog_t *assemble_lines(glob_t *glob, src_t *src, const char *begin, const char *end,
+                       int first_line, tok_t **refs) {
+	chunk_t ch;
+	memset(&ch, 0, sizeof(chunk_t));
+	ch.begin = begin;
+	ch.end = end;
+	ch.first_line = first_line;
+
+	if (!(ch.prog = init_prog(src))) {
+		return NULL;
+	}
+
+	assemble_chunk(&ch);
+	if (!ch.ok) {
+		glob->c_line = ch.last_line;
+		destroy_prog(ch.prog);
+		free(ch.refs);
+		return NULL;
+	}
+
+	*refs = ch.refs;
+	return ch.prog;
+}
+
+/**
+ * @desc  : Release memory allocated to the program.
+ * @param : prog - program to release.
+ * @return: void
+ */
+void destroy_prog(prog_t *prog) {
+	if (!prog) {
+		return;
+	}
+
+	destroy_symtab(prog->labels);
+	if (prog->map) {
+		munmap(prog->map, prog->map_len);
+	} else {
+		free(prog->instrs);
+		free(prog->lines);
+	}
+
+	free(prog->exec);
+	free(prog);
+}
+
+/**
+ * @desc  : Returns the text of a source line, through the line map.
+ * @param : prog - assembled program.
+ *          ln   - source line number.
+ * @return: tok_t - the line without its line break, len 0 if there is
+ *                  no such line.
+ */
+tok_t src_line(prog_t *prog, int ln) {
+	tok_t line = {"", 0};
+	if (!prog || ln < 1 || ln > prog->n_lines) {
+		return line;
+	}
+
+	unsigned long end = ln < prog->n_lines ? prog->lines[ln] : prog->text_len;
+	line.ptr = prog->text + prog->lines[ln - 1];
+	line.len = end - prog->lines[ln - 1];
+
+	while (line.len && (line.ptr[line.len - 1] == '\n' || line.ptr[line.len - 1] == '\r')) {
+		line.len--;
+	}
+
+	return line;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file: asm.h
+ * @desc: Declares functions that assemble a source file into an
+ *        in-memory instruction array before execution.
+ */
+
+#ifndef _ASE_ASM_H_
+#define _ASE_ASM_H_
+
+#include "glob.h"
+#include "load.h"
+#include "parse.h"
+#include "symtab.h"
+
+prog_t *assemble       (glob_t *glob, src_t *src);
+prog_t *assemble_lines (glob_t *glob, src_t *src, const char *begin, const char *end,
+                        int first_line, tok_t **refs);
+void    destroy_prog   (prog_t *prog);
+tok_t   src_line       (prog_t *prog, int ln);
+
+#endif
@@ -0,0 +1,606 @@
+/**
+ * @file: batch.c
+ * @desc: Defines the batch loader.
+ *
+ *        With tens of thousands of small programs, opening and reading
+ *        them costs more than running them. Opens, reads and closes are
+ *        queued on an io_uring, up to BATCH_QD files at a time, so a
+ *        single io_uring_enter() call serves many files. Each file is
+ *        handed to the caller as its read completes, while the reads of
+ *        the next files are still in flight.
+ *
+ *        The ring is driven through the raw system calls, so no library
+ *        is needed. If the kernel does not provide io_uring (or denies
+ *        it), a pool of threads does blocking open/pread calls instead.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "batch.h"
+
+#if defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BATCH_URING
+#endif
+#endif
+
+/* Stage of a request, kept in the low bits of its user_data. */
+#define ST_OPEN  0
+#define ST_READ  1
+#define ST_CLOSE 2
+
+typedef struct bfile {
+	/**
+	 * name - name of the file in the directory.
+	 * fd   - descriptor while the file is open.
+	 * buf  - contents read so far, len bytes of cap.
+	 * done - set once the file was handed to the caller.
+	 */
+	const char *name;
+	int fd;
+	char *buf;
+	size_t len, cap;
+	int done;
+} bfile_t;
+
+/**
+ * @desc  : Selects the .asm files of a directory.
+ * @param : ent - directory entry.
+ * @return: int - 0 if no, 1 if yes.
+ */
+static int is_asm(const struct dirent *ent) {
+	size_t len = strlen(ent->d_name);
+	return len > 4 && !strcmp(ent->d_name + len - 4, ".asm") && ent->d_type != DT_DIR;
+}
+
+/**
+ * @desc  : Hands a file to the caller and releases its buffer.
+ * @param : file - file that was read, or could not be.
+ *          ok   - set if the file was read.
+ *          fn   - callback.
+ *          arg  - callback argument.
+ * @return: void
+ */
+static void hand_over(bfile_t *file, int ok, batch_fn fn, void *arg) {
+	src_t src = {file->buf, file->len, 0};
+
+	if (!ok) {
+		fprintf(stderr, "Could not read [%s].\n", file->name);
+	}
+
+	fn(arg, file->name, ok ? &src : NULL);
+	free(file->buf);
+	file->buf = NULL;
+	file->done = 1;
+}
+
+#ifdef BATCH_URING
+typedef struct uring {
+	/**
+	 * fd       - ring descriptor.
+	 * sq_*     - submission ring, sqes holds the entries.
+	 * cq_*     - completion ring.
+	 * queued   - entries added since the last io_uring_enter().
+	 * inflight - entries submitted whose completion was not reaped.
+	 */
+	int fd;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+
+	void *sq_map, *cq_map;
+	size_t sq_len, cq_len, sqes_len;
+	unsigned int n_entries, queued, inflight;
+} uring_t;
+
+/**
+ * @desc  : Sets up a ring and maps its queues.
+ * @param : ring - receives the ring.
+ *          n    - number of submission entries.
+ * @return: int  - 0 if io_uring is not available, 1 if success.
+ */
+static int init_uring(uring_t *ring, unsigned int n) {
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	memset(ring, 0, sizeof(uring_t));
+
+	ring->fd = syscall(__NR_io_uring_setup, n, &p);
+	if (ring->fd < 0) {
+		return 0;
+	}
+
+	/* IORING_OP_OPENAT, _READ and _CLOSE arrived along with this flag. */
+	if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+		close(ring->fd);
+		return 0;
+	}
+
+	ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->sq_len = ring->cq_len = ring->sq_len > ring->cq_len ? ring->sq_len : ring->cq_len;
+	}
+
+	ring->sq_map = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                    ring->fd, IORING_OFF_SQ_RING);
+	ring->cq_map = p.features & IORING_FEAT_SINGLE_MMAP ? ring->sq_map :
+	               mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                    ring->fd, IORING_OFF_CQ_RING);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                  ring->fd, IORING_OFF_SQES);
+
+	if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		fprintf(stderr, "init_uring(): Could not map the ring.\n");
+		if (ring->sq_map != MAP_FAILED) {
+			munmap(ring->sq_map, ring->sq_len);
+		}
+
+		if (ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) {
+			munmap(ring->cq_map, ring->cq_len);
+		}
+
+		if (ring->sqes != MAP_FAILED) {
+			munmap(ring->sqes, ring->sqes_len);
+		}
+
+		close(ring->fd);
+		return 0;
+	}
+
+	char *sq = ring->sq_map, *cq = ring->cq_map;
+	ring->sq_head = (unsigned int *)(sq + p.sq_off.head);
+	ring->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+	ring->sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned int *)(sq + p.sq_off.array);
+	ring->cq_head = (unsigned int *)(cq + p.cq_off.head);
+	ring->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+	ring->cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	ring->n_entries = p.sq_entries;
+
+	return 1;
+}
+
+/**
+ * @desc  : Unmaps and closes a ring.
+ * @param : ring - ring to release.
+ * @return: void
+ */
+static void destroy_uring(uring_t *ring) {
+	munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_map != ring->sq_map) {
+		munmap(ring->cq_map, ring->cq_len);
+	}
+
+	munmap(ring->sq_map, ring->sq_len);
+	close(ring->fd);
+}
+
+/**
+ * @desc  : Returns the next free submission entry, cleared.
+ * @param : ring - ring.
+ *          data - user_data of the request.
+ * @return: struct io_uring_sqe* - the entry.
+ */
+static struct io_uring_sqe *get_sqe(uring_t *ring, unsigned long long data) {
+	unsigned int tail = *ring->sq_tail;
+	unsigned int idx = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->user_data = data;
+	ring->sq_array[idx] = idx;
+
+	/* The kernel must see the entry before the new tail. */
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->queued++;
+	ring->inflight++;
+
+	return sqe;
+}
+
+/**
+ * @desc  : Queues the read of the rest of a file's buffer.
+ * @param : ring - ring.
+ *          file - file to read, open.
+ *          idx  - index of the file.
+ * @return: void
+ */
+static void queue_read(uring_t *ring, bfile_t *file, unsigned long long idx) {
+	struct io_uring_sqe *sqe = get_sqe(ring, idx << 2 | ST_READ);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = file->fd;
+	sqe->addr = (unsigned long)(file->buf + file->len);
+	sqe->len = file->cap - file->len;
+	sqe->off = file->len;
+}
+
+/**
+ * @desc  : Submits the queued entries and waits for a completion.
+ * @param : ring - ring.
+ * @return: int  - 0 if io_uring_enter() failed, 1 if success.
+ */
+static int enter_uring(uring_t *ring) {
+	int ret = syscall(__NR_io_uring_enter, ring->fd, ring->queued, 1,
+	                  IORING_ENTER_GETEVENTS, NULL, 0);
+	if (ret < 0 && errno != EINTR) {
+		fprintf(stderr, "uring_batch(): io_uring_enter failed.\n");
+		return 0;
+	}
+
+	ring->queued = ret > 0 ? ring->queued - ret : ring->queued;
+	return 1;
+}
+
+/**
+ * @desc  : Takes back the entries the kernel has not consumed. Their
+ *          closes are done here, their opens and reads are dropped.
+ * @param : ring - ring.
+ * @return: void
+ */
+static void unqueue_uring(uring_t *ring) {
+	unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	unsigned int tail = *ring->sq_tail;
+
+	for (; tail != head; tail--) {
+		struct io_uring_sqe *sqe = &ring->sqes[ring->sq_array[(tail - 1) & *ring->sq_mask]];
+		if ((sqe->user_data & 3) == ST_CLOSE) {
+			close(sqe->fd);
+		}
+
+		ring->inflight--;
+	}
+
+	__atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+	ring->queued = 0;
+}
+
+/**
+ * @desc  : Waits for every entry in flight, without handing anything
+ *          over. Files opened meanwhile are closed again.
+ * @param : ring - ring.
+ * @return: int  - 0 if the ring failed before all completed, 1 if success.
+ */
+static int drain_uring(uring_t *ring) {
+	while (ring->inflight) {
+		if (!enter_uring(ring)) {
+			/* Nothing submitted, wait for what the kernel already has. */
+			if (!ring->queued) {
+				return 0;
+			}
+
+			unqueue_uring(ring);
+			continue;
+		}
+
+		unsigned int head = *ring->cq_head;
+		while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe = &ring->cqes[head++ & *ring->cq_mask];
+			if ((cqe->user_data & 3) == ST_OPEN && cqe->res >= 0) {
+				close(cqe->res);
+			}
+
+			ring->inflight--;
+		}
+
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Reads the files through io_uring.
+ * @param : ring  - ring.
+ *          dfd   - descriptor of the directory.
+ *          files - files to read.
+ *          n     - number of files.
+ *          fn    - callback.
+ *          arg   - callback argument.
+ * @return: int   - number of files left unread if the ring failed, moved
+ *                  to the front of files and reset, else 0.
+ */
+static int uring_batch(uring_t *ring, int dfd, bfile_t *files, int n, batch_fn fn, void *arg) {
+	int next = 0, done = 0, open = 0;
+
+	while (done < n) {
+		/* Every open file holds one entry, a close one more. */
+		while (next < n && open < BATCH_QD && ring->inflight + 2 <= ring->n_entries) {
+			struct io_uring_sqe *sqe = get_sqe(ring, (unsigned long long)next << 2 | ST_OPEN);
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = dfd;
+			sqe->addr = (unsigned long)files[next++].name;
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+			open++;
+		}
+
+		if (!enter_uring(ring)) {
+			break;
+		}
+
+		unsigned int head = *ring->cq_head;
+		while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe = &ring->cqes[head++ & *ring->cq_mask];
+			bfile_t *file = &files[cqe->user_data >> 2];
+			int res = cqe->res;
+
+			ring->inflight--;
+			switch (cqe->user_data & 3) {
+			case ST_OPEN:
+				file->fd = res;
+				file->cap = BATCH_BUF_SZ;
+				if (res >= 0 && !(file->buf = malloc(file->cap))) {
+					close(res);
+					file->fd = -1;
+				}
+
+				if (file->fd < 0) {
+					hand_over(file, 0, fn, arg);
+					open--;
+					done++;
+					break;
+				}
+
+				queue_read(ring, file, cqe->user_data >> 2);
+				break;
+
+			case ST_READ: {
+				/* A short read of a regular file is its end. */
+				int full = res > 0 && (file->len += res) == file->cap;
+				if (full) {
+					char *buf = realloc(file->buf, file->cap * 2);
+					if (buf) {
+						file->buf = buf;
+						file->cap *= 2;
+						queue_read(ring, file, cqe->user_data >> 2);
+						break;
+					}
+				}
+
+				struct io_uring_sqe *sqe = get_sqe(ring, ST_CLOSE);
+				sqe->opcode = IORING_OP_CLOSE;
+				sqe->fd = file->fd;
+
+				hand_over(file, res >= 0 && !full, fn, arg);
+				open--;
+				done++;
+				break;
+			}
+			}
+		}
+
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	/* Wait for the last closes, or for what a failed ring still has in flight. */
+	int drained = drain_uring(ring);
+	if (done == n) {
+		return 0;
+	}
+
+	/**
+	 * The files not handed over yet are read again from the start. A read
+	 * the ring could not be drained of may still land in its buffer, which
+	 * is then leaked rather than freed.
+	 */
+	int left = 0;
+	for (int i = 0; i < n; i++) {
+		bfile_t *file = &files[i];
+		if (file->done) {
+			continue;
+		}
+
+		if (file->fd >= 0) {
+			close(file->fd);
+		}
+
+		if (drained) {
+			free(file->buf);
+		}
+
+		files[left++] = (bfile_t){file->name, -1, NULL, 0, 0, 0};
+	}
+
+	return left;
+}
+#endif
+
+typedef struct pool {
+	/**
+	 * dfd   - descriptor of the directory.
+	 * files - files to read, next is the first one not taken yet.
+	 * ready - files in the order their reads completed, n_ready long.
+	 */
+	int dfd, n;
+	bfile_t *files;
+	atomic_int next;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int *ready, *ok, n_ready;
+} pool_t;
+
+/**
+ * @desc  : Pool thread - reads files until none are left.
+ * @param : arg   - pool.
+ * @return: void* - NULL
+ */
+static void *pread_worker(void *arg) {
+	pool_t *pool = arg;
+	int idx;
+
+	while ((idx = atomic_fetch_add(&pool->next, 1)) < pool->n) {
+		bfile_t *file = &pool->files[idx];
+		struct stat st;
+		int ok = 0;
+
+		int fd = openat(pool->dfd, file->name, O_RDONLY | O_CLOEXEC);
+		if (fd >= 0 && !fstat(fd, &st)) {
+			file->cap = st.st_size ? st.st_size : 1;
+			file->buf = malloc(file->cap);
+			ok = file->buf != NULL;
+
+			while (ok && file->len < (size_t)st.st_size) {
+				ssize_t ret = pread(fd, file->buf + file->len, st.st_size - file->len, file->len);
+				if (ret <= 0) {
+					ok = ret == 0;
+					break;
+				}
+
+				file->len += ret;
+			}
+		}
+
+		if (fd >= 0) {
+			close(fd);
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		pool->ok[idx] = ok;
+		pool->ready[pool->n_ready++] = idx;
+		pthread_cond_signal(&pool->cond);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * @desc  : Reads the files on a pool of threads doing blocking
+ *          open/pread calls. The caller's thread runs the callbacks.
+ * @param : dfd   - descriptor of the directory.
+ *          files - files to read.
+ *          n     - number of files.
+ *          fn    - callback.
+ *          arg   - callback argument.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+static int pool_batch(int dfd, bfile_t *files, int n, batch_fn fn, void *arg) {
+	pool_t pool;
+	pthread_t threads[BATCH_THREADS];
+	long n_threads = sysconf(_SC_NPROCESSORS_ONLN) * 2;
+
+	n_threads = n_threads < 1 ? 1 : n_threads > BATCH_THREADS ? BATCH_THREADS : n_threads;
+	n_threads = n_threads > n ? n : n_threads;
+
+	memset(&pool, 0, sizeof(pool_t));
+	pool.dfd = dfd;
+	pool.n = n;
+	pool.files = files;
+	pool.ready = malloc(n * sizeof(int));
+	pool.ok = malloc(n * sizeof(int));
+	atomic_init(&pool.next, 0);
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	int started = 0;
+	for (int i = 0; pool.ready && pool.ok && i < n_threads; i++) {
+		started += !pthread_create(&threads[started], NULL, pread_worker, &pool);
+	}
+
+	/* Without threads the reads happen right here. */
+	if (!started && pool.ready && pool.ok) {
+		pread_worker(&pool);
+	}
+
+	for (int done = 0; pool.ready && pool.ok && done < n; done++) {
+		pthread_mutex_lock(&pool.lock);
+		while (pool.n_ready == done) {
+			pthread_cond_wait(&pool.cond, &pool.lock);
+		}
+
+		int idx = pool.ready[done];
+		pthread_mutex_unlock(&pool.lock);
+
+		hand_over(&files[idx], pool.ok[idx], fn, arg);
+	}
+
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	int ok = pool.ready && pool.ok;
+	if (!ok) {
+		fprintf(stderr, "pool_batch(): malloc failure.\n");
+	}
+
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.cond);
+	free(pool.ready);
+	free(pool.ok);
+	return ok;
+}
+
+/**
+ * @desc  : Reads every .asm file of a directory and calls fn with each
+ *          one, in the order the reads complete.
+ * @param : dir   - path of the directory.
+ *          uring - use io_uring if the kernel provides it, else the
+ *                  pread threads are used.
+ *          fn    - called once per file.
+ *          arg   - passed to fn.
+ * @return: int   - 0 if the directory could not be read, 1 if success.
+ */
+int load_batch(const char *dir, int uring, batch_fn fn, void *arg) {
+	struct dirent **ents = NULL;
+	int n = scandir(dir, &ents, is_asm, alphasort);
+	int dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (n < 0 || dfd < 0) {
+		fprintf(stderr, "load_batch(): Could not read directory [%s].\n", dir);
+		if (dfd >= 0) {
+			close(dfd);
+		}
+
+		free(ents);
+		return 0;
+	}
+
+	bfile_t *files = calloc(n ? n : 1, sizeof(bfile_t));
+	int ok = files != NULL, n_left = n;
+
+	for (int i = 0; ok && i < n; i++) {
+		files[i].name = ents[i]->d_name;
+		files[i].fd = -1;
+	}
+
+#ifdef BATCH_URING
+	uring_t ring;
+	if (ok && uring && n && init_uring(&ring, 2 * BATCH_QD)) {
+		/* If the ring fails, the threads read what it left. */
+		n_left = uring_batch(&ring, dfd, files, n, fn, arg);
+		destroy_uring(&ring);
+	}
+#endif
+
+	if (ok && n_left) {
+		ok = pool_batch(dfd, files, n_left, fn, arg);
+	}
+
+	for (int i = 0; i < n; i++) {
+		free(ents[i]);
+	}
+
+	free(ents);
+	free(files);
+	close(dfd);
+	return ok;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file: batch.h
+ * @desc: Declares the batch loader - reads every .asm file of a
+ *        directory and hands each one to the caller as soon as it has
+ *        been read.
+ */
+
+#ifndef _ASE_BATCH_H_
+#define _ASE_BATCH_H_
+
+#include "load.h"
+
+/* Number of files being read at once. */
+#define BATCH_QD      64
+/* Read buffer of a file whose size is not known yet. */
+#define BATCH_BUF_SZ  (16 * 1024)
+/* Upper bound of pread threads when io_uring is not available. */
+#define BATCH_THREADS 16
+
+/**
+ * Called once per file, in the order the reads complete.
+ * arg  - as passed to load_batch().
+ * name - name of the file in the directory.
+ * src  - contents of the file, NULL if it could not be read. Released
+ *        once the call returns.
+ */
+typedef void (*batch_fn)(void *arg, const char *name, src_t *src);
+
+int load_batch (const char *dir, int uring, batch_fn fn, void *arg);
+
+#endif
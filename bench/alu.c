@@ -0,0 +1,71 @@
+/**
+ * @file: bench/alu.c
+ * @desc: Measures nanoseconds per ALU operation, for each operation and
+ *        width - once leaving the flags pending, the way handlers do,
+ *        and once computing them after every operation, the way a flag
+ *        read right after it would.
+ *        Built by `make bench`.
+ *
+ *        ./bench_alu
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+#include "../alu.h"
+
+#define ROUNDS 5
+#define N_OPS  (1 << 24)
+
+/* Keeps the results alive. */
+static volatile int sink;
+
+/* Best ns per operation of ROUNDS runs, operands stay small enough for ADD not to fail. */
+static double measure(glob_t *glob, int opc, int width, int sync) {
+	double best = 0;
+
+	for (int r = 0; r < ROUNDS; r++) {
+		struct timespec a, b;
+		int res, acc = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &a);
+		for (int i = 0; i < N_OPS; i++) {
+			int d = (i & 0x3f) - 32, s = ((i >> 6) & 0x3f) - 32;
+			alu(glob, opc, d, s, width, &res);
+			if (sync) {
+				flags_sync(glob->flags);
+				acc += glob->flags->cf + glob->flags->pf;
+			}
+			acc += res;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &b);
+		sink = acc;
+
+		double ns = ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / N_OPS;
+		best = !r || ns < best ? ns : best;
+	}
+
+	return best;
+}
+
+int main(void) {
+	flags_t flags = {0};
+	glob_t glob = {0};
+	glob.flags = &flags;
+
+	const int opcs[] = {OPC_ADD, OPC_SUB, OPC_CMP, OPC_MUL, OPC_INC, OPC_DEC, OPC_NEG};
+	const char *names[] = {"ADD", "SUB", "CMP", "MUL", "INC", "DEC", "NEG"};
+
+	for (int i = 0; i < 7; i++) {
+		for (int width = 8; width <= 16; width += 8) {
+			double lazy = measure(&glob, opcs[i], width, 0);
+			double eager = measure(&glob, opcs[i], width, 1);
+			printf("%s %2d bit: pending %5.2f ns/op, flags computed %5.2f ns/op\n",
+				names[i], width, lazy, eager);
+		}
+	}
+
+	return 0;
+}
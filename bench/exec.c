@@ -0,0 +1,181 @@
+/**
+ * @file: bench/exec.c
+ * @desc: Measures instructions per second of the execution engine, with
+ *        and without superinstructions, and of the block translating
+ *        tier, against the loop main() ran
+ *        before, which called every handler through call_instr() and
+ *        checked for halts and debug mode each time.
+ *        Built by `make bench` once threaded and once with -DEXEC_SWITCH.
+ *
+ *        ./bench_exec [file.asm]
+ *        Without a file, two counting loops are used - one mostly
+ *        handler work, one mostly NOPs, which shows the dispatch cost.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../asm.h"
+#include "../bind.h"
+#include "../exec.h"
+#include "../fuse.h"
+#include "../jit.h"
+#include "../load.h"
+
+#define ROUNDS 7
+
+/* Each measurement repeats the program for at least this long, in seconds. */
+#define MIN_SEC 0.03
+
+/* Mostly handler work. */
+static const char mixed[] =
+	"MOV CX, 7FFFH\n"
+	"L1: MOV AX, CX\n"
+	"SUB AX, 1\n"
+	"XCHG AX, BX\n"
+	"NOP\n"
+	"DEC CX\n"
+	"CMP CX, 0H\n"
+	"JNE L1\n"
+	"HLT\n";
+
+/* Mostly dispatch. */
+static const char dispatch[] =
+	"MOV CX, 7FFFH\n"
+	"L1: NOP\nNOP\nNOP\nNOP\nNOP\nNOP\nNOP\nNOP\n"
+	"NOP\nNOP\nNOP\nNOP\nNOP\nNOP\nNOP\nNOP\n"
+	"DEC CX\n"
+	"CMP CX, 0H\n"
+	"JNE L1\n"
+	"HLT\n";
+
+/* The loop main() used to execute programs with. */
+static int run_loop(glob_t *glob) {
+	prog_t *prog = glob->prog;
+	int flag = 0, exec = 1;
+
+	while (exec) {
+		if (glob->ip >= prog->n) {
+			break;
+		}
+
+		load_instr(glob, &prog->instrs[glob->ip]);
+		glob->ip++;
+		glob->steps++;
+
+		int ret = call_instr(glob, NULL, (unsigned long)BUF_SZ);
+		if (ret == -1) {
+			exec = 0;
+		}
+
+		if (!ret) {
+			flag = 1;
+			exec = 0;
+		}
+
+		if (exec && glob->debug) {
+			return 1;
+		}
+	}
+
+	return flag;
+}
+
+static int run_exec(glob_t *glob) {
+	fuse_prog(glob->prog, 0);
+	return exec_prog(glob);
+}
+
+static int run_fused(glob_t *glob) {
+	fuse_prog(glob->prog, 1);
+	return exec_prog(glob);
+}
+
+/* jit_prog() translates the blocks again on every run. */
+static int run_jit(glob_t *glob) {
+	int blocks;
+	return jit_prog(glob, &blocks);
+}
+
+/* Instructions per second of fn, run from a clean state until MIN_SEC passed. */
+static double measure(glob_t *glob, int (*fn)(glob_t *glob)) {
+	struct timespec a, b;
+	unsigned long steps = 0;
+	double sec = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	while (sec < MIN_SEC) {
+		reset_glob(glob);
+		if (fn(glob)) {
+			return 0;
+		}
+
+		steps += glob->steps;
+		clock_gettime(CLOCK_MONOTONIC, &b);
+		sec = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+	}
+
+	return steps / sec;
+}
+
+/* Assembles src and prints the rate of both loops on it. */
+static int bench(const char *name, src_t *src) {
+	FILE *fd = fopen("/dev/null", "r");
+	glob_t *glob = init_glob(fd);
+	glob->mem->warned = 1;
+
+	prog_t *prog = glob->prog = assemble(glob, src);
+	if (!prog) {
+		return 0;
+	}
+
+	/* Best of ROUNDS, the loops take turns so drift hits them alike. */
+	int (*const fns[4])(glob_t *glob) = {run_loop, run_exec, run_fused, run_jit};
+	double best[4] = {0};
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int i = 0; i < 4; i++) {
+			double ips = measure(glob, fns[i]);
+			if (!ips) {
+				fprintf(stderr, "Program halted due to an error.\n");
+				return 0;
+			}
+
+			best[i] = ips > best[i] ? ips : best[i];
+		}
+	}
+
+	double loop = best[0], fast = best[1], fused = best[2], jit = best[3];
+	int pairs = fuse_prog(prog, 1);
+
+	printf("%-8s %8lu instructions, loop %6.2f M/s, exec_prog %6.2f M/s (%.2fx), "
+		"%d fused %6.2f M/s (%.2fx), jit %6.2f M/s (%.2fx)\n",
+		name, glob->steps, loop / 1e6, fast / 1e6, fast / loop,
+		pairs, fused / 1e6, fused / loop, jit / 1e6, jit / loop);
+
+	destroy_prog(prog);
+	destroy_glob(glob);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		int fd = open(argv[1], O_RDONLY);
+		src_t *src = fd < 0 ? NULL : map_src(fd);
+		if (!src) {
+			fprintf(stderr, "Could not open specified file.\n");
+			return 1;
+		}
+
+		return !bench(argv[1], src);
+	}
+
+	src_t s_mixed = {mixed, sizeof(mixed) - 1, 0};
+	src_t s_dispatch = {dispatch, sizeof(dispatch) - 1, 0};
+	return !bench("mixed", &s_mixed) || !bench("dispatch", &s_dispatch);
+}
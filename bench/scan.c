@@ -0,0 +1,261 @@
+/**
+ * @file: bench/scan.c
+ * @desc: Measures the throughput of the assembler front end - splitting
+ *        the source into lines, tokenising and decoding them. Built by
+ *        `make bench` once per scanner (scalar, SSE2, AVX2).
+ *
+ *        Each run also measures base_tokenize(), tokenize() as it was
+ *        before scan.c, on isalnum() and byte compares, and reports the
+ *        speedup of the scanner over it. Decoding is the same for both.
+ *
+ *        ./bench_scan [file.asm]
+ *        Without a file, a synthetic source of 500k lines is used.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../load.h"
+#include "../parse.h"
+
+#define ROUNDS 9
+
+typedef int (*tok_fn)(const char *line, const char *end, int ln, instr_t *instr,
+                      tok_t *toks, tok_t *label);
+
+static const char *sample[] = {
+	"L%d: MOV AX, 1234H\n",
+	"\tADD  BX,   [100]    ; add the word at 100\n",
+	"CMP CX, 0H\n",
+	"JNE L%d\n",
+	"; comment line\n",
+	"        XCHG AL, BH\n",
+};
+
+/* tokenize() before scan.c, kept as the baseline. */
+static int base_tokenize(const char *line, const char *end, int ln, instr_t *instr,
+                         tok_t *toks, tok_t *label) {
+	int i = 0;
+	int flag = 0;
+	const char *ptr = line;
+
+	memset(instr, 0, sizeof(instr_t));
+	memset(toks, 0, 3 * sizeof(tok_t));
+	label->ptr = NULL;
+	label->len = 0;
+	instr->line = ln;
+	instr->target = -1;
+
+	while (ptr < end) {
+		if (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n') {
+			ptr++;
+			continue;
+		}
+
+		const char *tok = ptr;
+		while (ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n') {
+			ptr++;
+		}
+
+		int len = ptr - tok;
+
+		/* Skip if comment line begins. */
+		if (*tok == ';') {
+			break;
+		}
+
+		/* There's a space between label and colon? */
+		if (*tok == ':') {
+			fprintf(stderr, "Valid label syntax: Label: [instr] [operands] @ [%d].\n", ln);
+			return 0;
+		}
+
+		/* There's no instruction that takes more than 2 operands. */
+		if (i > 2) {
+			fprintf(stderr, "Exceeded token limit.\n");
+			return 0;
+		}
+
+		if (*tok == ',') {
+			/* Are we expecting a comma? Are we parsing op2? */
+			if (flag && i > 1) {
+				flag = 0;
+				continue;
+			}
+
+			fprintf(stderr, "Unexpected character [,].\n");
+			return 0;
+		}
+
+		/* Token can begin only with alpha-numeric chars or a '['. */
+		if (!isalnum(*tok) && *tok != '[' && *tok != '-') {
+			fprintf(stderr, "Unexpected character [%c].\n", *tok);
+			return 0;
+		}
+
+		if (len >= BUF_SZ) {
+			fprintf(stderr, "Token too long @ [%d].\n", ln);
+			return 0;
+		}
+
+		/**
+		 * Check if comment line begins. No space between op and ';' perhaps?
+		 * Eg: instr op1 op2; This is a comment line.
+		 */
+		const char *semi = memchr(tok, ';', len);
+		if (semi) {
+			toks[i].ptr = tok;
+			toks[i++].len = semi - tok;
+			break;
+		}
+
+		/* Check for label. Do not count label as a token. */
+		if (tok[len - 1] == ':') {
+			label->ptr = tok;
+			label->len = len - 1;
+			continue;
+		}
+
+		if (!isalnum(tok[len - 1]) && tok[len - 1] != ']') {
+			len--;
+		} else {
+			/* We're expecting a comma. */
+			flag = 1;
+		}
+
+		toks[i].ptr = tok;
+		toks[i++].len = len;
+	}
+
+	instr->n_op = i - 1;
+	return 1;
+}
+
+/**
+ * @desc  : Splits src into lines and tokenises, and optionally decodes,
+ *          every line that holds an instruction.
+ * @param : src    - source text.
+ *          fn     - tokeniser.
+ *          decode - set to decode the tokens too.
+ *          n_ins  - receives the number of instructions.
+ * @return: double - MB/s, 0 if a line failed.
+ */
+static double measure(src_t *src, tok_fn fn, int decode, long *n_ins) {
+	struct timespec a, b;
+	const char *ptr = src->base, *end = src->base + src->len;
+	int ln = 0;
+
+	*n_ins = 0;
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	while (ptr < end) {
+		const char *eol = memchr(ptr, '\n', end - ptr);
+		const char *next = eol ? eol + 1 : end;
+		instr_t instr;
+		tok_t toks[3], label;
+
+		ln++;
+		if (!should_skip_ln(ptr)) {
+			if (!fn(ptr, eol ? eol : end, ln, &instr, toks, &label) ||
+			    (decode && !decode_instr(&instr, toks))) {
+				return 0;
+			}
+
+			(*n_ins)++;
+		}
+
+		ptr = next;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &b);
+	double sec = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+	return src->len / sec / (1 << 20);
+}
+
+/**
+ * @desc  : Checks that both tokenisers split every line the same way.
+ * @param : src - source text.
+ * @return: int - 0 if they differ, 1 if they agree.
+ */
+static int same_tokens(src_t *src) {
+	const char *ptr = src->base, *end = src->base + src->len;
+
+	for (int ln = 1; ptr < end; ln++) {
+		const char *eol = memchr(ptr, '\n', end - ptr);
+		instr_t i_a, i_b;
+		tok_t t_a[3], t_b[3], l_a, l_b;
+
+		if (!should_skip_ln(ptr)) {
+			int ok_a = tokenize(ptr, eol ? eol : end, ln, &i_a, t_a, &l_a);
+			int ok_b = base_tokenize(ptr, eol ? eol : end, ln, &i_b, t_b, &l_b);
+
+			if (ok_a != ok_b || i_a.n_op != i_b.n_op || l_a.len != l_b.len ||
+			    memcmp(t_a, t_b, sizeof(t_a))) {
+				fprintf(stderr, "Tokenisers differ on line %d.\n", ln);
+				return 0;
+			}
+		}
+
+		ptr = eol ? eol + 1 : end;
+	}
+
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	src_t *src = NULL;
+	char *text = NULL;
+
+	if (argc > 1) {
+		int fd = open(argv[1], O_RDONLY);
+		if (fd < 0 || !(src = map_src(fd))) {
+			fprintf(stderr, "Could not open specified file.\n");
+			return 1;
+		}
+	} else {
+		size_t len = 0, cap = 64 << 20;
+		text = malloc(cap);
+		for (int i = 0; text && i < 500000; i++) {
+			len += sprintf(text + len, sample[i % 6], i);
+		}
+
+		static src_t gen;
+		gen.base = text;
+		gen.len = len;
+		src = &gen;
+	}
+
+	if (!same_tokens(src)) {
+		return 1;
+	}
+
+	/* Best of ROUNDS, the variants take turns so drift hits them alike. */
+	long n_ins = 0;
+	double best[4] = {0};
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int v = 0; v < 4; v++) {
+			double mbs = measure(src, v & 1 ? tokenize : base_tokenize, v >> 1, &n_ins);
+			if (!mbs) {
+				return 1;
+			}
+
+			best[v] = mbs > best[v] ? mbs : best[v];
+		}
+	}
+
+	double base = best[0], scan = best[1], base_dec = best[2], scan_dec = best[3];
+
+	printf("%ld instructions\n", n_ins);
+	printf("tokenise          : baseline %7.1f MB/s, scanner %7.1f MB/s (%.2fx)\n",
+		base, scan, scan / base);
+	printf("tokenise + decode : baseline %7.1f MB/s, scanner %7.1f MB/s (%.2fx)\n",
+		base_dec, scan_dec, scan_dec / base_dec);
+	free(text);
+	return 0;
+}
@@ -1,56 +1,53 @@
 /**
  * @file: bind.c
- * @desc: Defines function that helps in binding instruction set to
- *        strings.
+ * @desc: Defines the table binding the instruction set to its handlers
+ *        and the function calling them.
  */ 
 
-#include <assert.h>
-
 #include "bind.h"
+#include "probe.h"
+
+#define ENTRY(name, f_ptr, n_ops) [OPC_##name] = {n_ops, f_ptr},
+#define FORM_ENTRY(name, k0, k1, f_ptr) \
+	[FORM_##name##_##k0##_##k1] = {(OP_##k0 != OP_NONE) + (OP_##k1 != OP_NONE), f_ptr},
 
 /**
- * @desc  : Bind instruction set to strings.
- * @param : table - table containing the entries.
- * @return: void
- */ 
-void bind_calls(table_t *table) {
-	
-	if (!table) {
-		fprintf(stderr, "nullptr - table.\n");
-		return;
+ * Indexed by instr->form, OPC_NONE and OPC_BAD have no handler. The
+ * opcodes from OPC_EXT on have none until load_plugin() binds them.
+ */
+entry_t instr_set[N_FORM] = {
+	INSTR_SET(ENTRY)
+	FORM_SET(FORM_ENTRY)
+};
+
+/**
+ * @desc  : Call the handler of the instruction being executed.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 0 if fail, 1 if success, -1 to halt.
+ */
+int call_instr(glob_t *glob, char *buf, unsigned long size) {
+	const instr_t *instr = glob->instr;
+	if (instr->opc == OPC_NONE) {
+		return 1;
+	}
+
+	PROBE_INSTR(instr);
+
+	if (instr->opc == OPC_BAD) {
+		fprintf(stderr, "Invalid entry [%s]: reached end of the table.\n", instr->mnem);
+		return 0;
+	}
+
+	const entry_t *entry = &instr_set[instr->form];
+
+	/* Check if we've the operands required */
+	if (glob->n_op != entry->n_ops) {
+		fprintf(stderr, "call_instr(): Invalid number of operands [%d] [%s].\n",
+			glob->n_op, instr->mnem);
+		return 0;
 	}
 
-	assert(register_entry(table, "ADD",  math_op,    2));
-	assert(register_entry(table, "CLC",  clear_flag, 0));
-	assert(register_entry(table, "CLD",  clear_flag, 0));
-	assert(register_entry(table, "CLI",  clear_flag, 0));
-	assert(register_entry(table, "CMC",  cmc,        0));
-	assert(register_entry(table, "CMP",  math_op,    2));
-	assert(register_entry(table, "DEC",  unary,      1));
-	assert(register_entry(table, "HLT",  hlt,        0));
-	assert(register_entry(table, "IN",   nop,        2));
-	assert(register_entry(table, "INC",  unary,      1));
-	assert(register_entry(table, "JCXZ", jump_cx,    1));
-	assert(register_entry(table, "JC",   jump_jx,    1));
-	assert(register_entry(table, "JE",   jump_jx,    1));
-	assert(register_entry(table, "JNC",  jump_jnx,   1));
-	assert(register_entry(table, "JNE",  jump_jnx,   1));
-	assert(register_entry(table, "JP",   jump_jx,    1));
-	assert(register_entry(table, "JPE",  jump_jx,    1));
-	assert(register_entry(table, "JMP",  jump,       1));
-	assert(register_entry(table, "LAHF", lahf,       0));
-	assert(register_entry(table, "MOV",  move,       2));
-	assert(register_entry(table, "MUL",  math_op,    1));
-	assert(register_entry(table, "NEG",  neg,        1));
-	assert(register_entry(table, "NOP",  nop,        0));
-	assert(register_entry(table, "ORG",  org,        1));
-	assert(register_entry(table, "OUT",  nop,        2));
-	assert(register_entry(table, "POP",  pop,        1));
-	assert(register_entry(table, "PUSH", push,       1));
-	assert(register_entry(table, "SAHF", sahf,       0));
-	assert(register_entry(table, "STC",  set_flag,   0));
-	assert(register_entry(table, "STD",  set_flag,   0));
-	assert(register_entry(table, "STI",  set_flag,   0));
-	assert(register_entry(table, "SUB",  math_op,    2));
-	assert(register_entry(table, "XCHG", xchg,       2));
-}
\ No newline at end of file
+	return entry->f_ptr(glob, buf, size);
+}
@@ -1,18 +1,28 @@
 /**
  * @file: bind.h
- * @desc: Declares function that helps in binding instruction set to
- *        strings.
+ * @desc: Declares the function that calls the handler the instruction
+ *        set binds an opcode to.
  */ 
 
 #ifndef _ASE_BIND_H_
 #define _ASE_BIND_H_
 
 #include "flags.h"
+#include "glob.h"
 #include "mathop.h"
 #include "mem.h"
+#include "parse.h"
 #include "stack.h"
 #include "tengine.h"
 
-void bind_calls(table_t *table);
+typedef struct entry {
+	int n_ops;
+	int (*f_ptr)(glob_t *glob, char *buf, unsigned long size);
+} entry_t;
 
-#endif
\ No newline at end of file
+/* Indexed by instr->form, defined in bind.c. Plugins fill in OPC_EXT on. */
+extern entry_t instr_set[N_FORM];
+
+int call_instr (glob_t *glob, char *buf, unsigned long size);
+
+#endif
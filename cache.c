@@ -0,0 +1,307 @@
+/**
+ * @file: cache.c
+ * @desc: Defines functions that save an assembled program to a .aseb
+ *        bytecode cache and map it back in.
+ *
+ *        A cache hit costs one mmap() and a hash of the source, the
+ *        instruction array is used straight from the mapping. The
+ *        mapping is never written, fuse_prog() keeps its handlers in a
+ *        separate array.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "asm.h"
+#include "cache.h"
+#include "fuse.h"
+#include "tengine.h"
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+#define FNV_INIT  14695981039346656037ull
+
+#define OPC_STR(name, f_ptr, n_ops)   #name " " #f_ptr " " #n_ops "\n"
+#define FORM_STR(name, k0, k1, f_ptr) #name " " #k0 " " #k1 " " #f_ptr "\n"
+#define FUSE_STR(name, f_ptr)         #name " " #f_ptr "\n"
+
+/* The instruction tables as text, any change to them changes the build key. */
+static const char tables[] = INSTR_SET(OPC_STR) FORM_SET(FORM_STR) FUSE_SET(FUSE_STR);
+
+/**
+ * @desc  : FNV-1a 64 bit hash.
+ * @param : h    - initial hash value.
+ *          data - data to hash.
+ *          len  - length of the data.
+ * @return: uint64_t - hash value.
+ */
+static uint64_t hash64(uint64_t h, const void *data, size_t len) {
+	const unsigned char *ptr = data;
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ ptr[i]) * 1099511628211ull;
+	}
+
+	return h;
+}
+
+/**
+ * @desc  : Key of the running emulator build, derived from what the
+ *          cached records depend on. A change to ASEB_VERSION, the layout
+ *          of instr_t, the instruction tables, or other plugins bound to
+ *          the opcodes they take, invalidates existing caches. Rebuilding
+ *          the same sources does not.
+ * @return: uint64_t - build key.
+ */
+static uint64_t build_key(void) {
+	const uint32_t sizes[] = {ASEB_VERSION, sizeof(instr_t), sizeof(operand_t),
+	                          N_OPC, N_FORM, N_EXEC, N_REG, N_EA};
+
+	uint64_t h = hash64(FNV_INIT, tables, sizeof(tables));
+	h = hash64(h, sizes, sizeof(sizes));
+
+	for (int opc = OPC_EXT; opc <= OPC_EXT_LAST; opc++) {
+		const char *mnem = opc_mnem(opc);
+		h = hash64(h, mnem, strlen(mnem) + 1);
+	}
+
+	return h;
+}
+
+/**
+ * @desc  : Checks that a section lies within the file, 8 byte aligned
+ *          and past the header.
+ * @param : off  - offset of the section.
+ *          n    - number of records.
+ *          sz   - size of a record.
+ *          size - size of the file.
+ * @return: int  - 0 if no, 1 if yes.
+ */
+static int in_file(uint64_t off, uint64_t n, uint64_t sz, uint64_t size) {
+	return off % 8 == 0 && off >= sizeof(aseb_hdr_t) && off <= size && n <= (size - off) / sz;
+}
+
+/**
+ * @desc  : Checks a mapped instruction before exec_prog() trusts it. The
+ *          handler ids index the dispatch tables, target is a jump index
+ *          and the registers index the register file.
+ * @param : instr - instruction read from the cache.
+ *          n     - number of instructions.
+ * @return: int   - 0 if it could not have been assembled, 1 if valid.
+ */
+static int valid_instr(const instr_t *instr, int n) {
+	if (instr->opc < OPC_NONE || instr->opc >= N_OPC || instr->form != find_form(instr) ||
+	    instr->n_op < 0 || instr->n_op > 2 || instr->target < -1 || instr->target > n ||
+	    !memchr(instr->mnem, '\0', sizeof(instr->mnem))) {
+		return 0;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		const operand_t *op = &instr->ops[i];
+		switch (op->kind) {
+		case OP_NONE:
+		case OP_IMM:
+		case OP_LABEL:
+			break;
+
+		case OP_MEM:
+			if (op->ea < 0 || op->ea >= N_EA) {
+				return 0;
+			}
+			/* fall through - reg is the segment */
+		case OP_REG:
+			if (op->reg < 0 || op->reg >= N_REG) {
+				return 0;
+			}
+			break;
+
+		default:
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Derives the cache path of a source file, file.asm becomes
+ *          file.aseb.
+ * @param : src_path - path of the source file.
+ *          buf      - buffer that receives the cache path.
+ *          size     - size of the buffer.
+ * @return: void
+ */
+void cache_path(const char *src_path, char *buf, unsigned long size) {
+	size_t len = strlen(src_path);
+	if (len > 4 && !strcmp(&src_path[len - 4], ".asm")) {
+		len -= 4;
+	}
+
+	snprintf(buf, size, "%.*s.aseb", (int)len, src_path);
+}
+
+/**
+ * @desc  : Maps a .aseb file and builds a program from it, if it was
+ *          written for this source and this emulator build.
+ * @param : glob    -
+ *          src     - mapped source file.
+ *          path    - path of the cache.
+ * @return: prog_t* - the program, or NULL on a cache miss.
+ */
+prog_t *load_cache(glob_t *glob, src_t *src, const char *path) {
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(aseb_hdr_t)) {
+		close(fd);
+		return NULL;
+	}
+
+	/* Read only - concurrent runs of one program share its pages. */
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	const aseb_hdr_t *hdr = map;
+	const uint64_t size = st.st_size;
+
+	int hit = !memcmp(hdr->magic, ASEB_MAGIC, 4) &&
+	          hdr->version == ASEB_VERSION &&
+	          hdr->build == build_key() &&
+	          hdr->src_len == src->len &&
+	          hdr->n_instrs <= INT_MAX && hdr->n_lines <= INT_MAX &&
+	          in_file(hdr->off_instrs, hdr->n_instrs, sizeof(instr_t), size) &&
+	          in_file(hdr->off_lines, hdr->n_lines, sizeof(unsigned int), size) &&
+	          in_file(hdr->off_syms, hdr->n_syms, sizeof(aseb_sym_t), size) &&
+	          hdr->src_hash == hash64(FNV_INIT, src->base, src->len);
+
+	/* A file that matches but holds records no build could write is a miss too. */
+	const instr_t *instrs = (const instr_t *)((char *)map + hdr->off_instrs);
+	for (uint32_t i = 0; hit && i < hdr->n_instrs; i++) {
+		hit = valid_instr(&instrs[i], hdr->n_instrs);
+	}
+
+	const unsigned int *lines = (const unsigned int *)((char *)map + hdr->off_lines);
+	for (uint32_t i = 0; hit && i < hdr->n_lines; i++) {
+		hit = lines[i] <= (i + 1 < hdr->n_lines ? lines[i + 1] : src->len);
+	}
+
+	prog_t *prog = hit ? calloc(1, sizeof(prog_t)) : NULL;
+	if (prog) {
+		prog->labels = init_symtab();
+	}
+
+	if (!prog || !prog->labels) {
+		free(prog);
+		munmap(map, size);
+		return NULL;
+	}
+
+	prog->map = map;
+	prog->map_len = size;
+	prog->text = src->base;
+	prog->text_len = src->len;
+	prog->n = prog->cap = hdr->n_instrs;
+	prog->instrs = (instr_t *)((char *)map + hdr->off_instrs);
+	prog->n_lines = prog->l_cap = hdr->n_lines;
+	prog->lines = (unsigned int *)((char *)map + hdr->off_lines);
+
+	const aseb_sym_t *syms = (const aseb_sym_t *)((char *)map + hdr->off_syms);
+	for (uint32_t i = 0; i < hdr->n_syms; i++) {
+		tok_t name = {src->base + syms[i].off, syms[i].len};
+
+		if ((uint64_t)syms[i].off + syms[i].len > src->len ||
+		    syms[i].idx < 0 || (uint32_t)syms[i].idx > hdr->n_instrs ||
+		    !add_sym(prog->labels, &name, syms[i].line, syms[i].idx)) {
+			destroy_prog(prog);
+			return NULL;
+		}
+	}
+
+	return prog;
+}
+
+/**
+ * @desc  : Writes the program to a .aseb file. The file is written
+ *          under a temporary name and renamed into place, so readers
+ *          never map a partially written cache.
+ * @param : prog - assembled program.
+ *          src  - source the program was assembled from.
+ *          path - path of the cache.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int save_cache(prog_t *prog, src_t *src, const char *path) {
+	if (!prog || !src || !path) {
+		fprintf(stderr, "save_cache(): nullptr received.\n");
+		return 0;
+	}
+
+	aseb_hdr_t hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ASEB_MAGIC, 4);
+
+	hdr.version = ASEB_VERSION;
+	hdr.build = build_key();
+	hdr.src_hash = hash64(FNV_INIT, src->base, src->len);
+	hdr.src_len = src->len;
+	hdr.n_instrs = prog->n;
+	hdr.n_lines = prog->n_lines;
+	hdr.n_syms = prog->labels->n;
+	hdr.off_instrs = ALIGN8(sizeof(hdr));
+	hdr.off_lines = ALIGN8(hdr.off_instrs + (uint64_t)prog->n * sizeof(instr_t));
+	hdr.off_syms = ALIGN8(hdr.off_lines + (uint64_t)prog->n_lines * sizeof(unsigned int));
+
+	const uint64_t size = hdr.off_syms + (uint64_t)hdr.n_syms * sizeof(aseb_sym_t);
+	char *image = calloc(1, size);
+	if (!image) {
+		fprintf(stderr, "save_cache(): malloc failure.\n");
+		return 0;
+	}
+
+	memcpy(image, &hdr, sizeof(hdr));
+	memcpy(image + hdr.off_instrs, prog->instrs, prog->n * sizeof(instr_t));
+	memcpy(image + hdr.off_lines, prog->lines, prog->n_lines * sizeof(unsigned int));
+
+	aseb_sym_t *syms = (aseb_sym_t *)(image + hdr.off_syms);
+	for (uint32_t i = 0; i < hdr.n_syms; i++) {
+		sym_t *sym = &prog->labels->syms[i];
+		syms[i].off = sym->name.ptr - src->base;
+		syms[i].len = sym->name.len;
+		syms[i].line = sym->line;
+		syms[i].idx = sym->idx;
+	}
+
+	char tmp[4096];
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+	FILE *fd = fopen(tmp, "wb");
+	if (!fd) {
+		fprintf(stderr, "save_cache(): Could not create [%s].\n", tmp);
+		free(image);
+		return 0;
+	}
+
+	int ok = fwrite(image, size, 1, fd) == 1;
+	ok = (fclose(fd) == 0) && ok;
+	free(image);
+
+	if (!ok || rename(tmp, path) != 0) {
+		fprintf(stderr, "save_cache(): Could not write [%s].\n", path);
+		unlink(tmp);
+		return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file: cache.h
+ * @desc: Declares functions that save an assembled program to a .aseb
+ *        bytecode cache and map it back in.
+ */
+
+#ifndef _ASE_CACHE_H_
+#define _ASE_CACHE_H_
+
+#include <stdint.h>
+
+#include "glob.h"
+#include "load.h"
+#include "symtab.h"
+
+#define ASEB_MAGIC   "ASEB"
+#define ASEB_VERSION 7
+
+/**
+ * Layout of a .aseb file. Sections are 8 byte aligned and addressed by
+ * their offset from the start of the file, so the file can be mapped
+ * anywhere and shared read-only between processes.
+ *
+ *   aseb_hdr_t
+ *   instr_t       [n_instrs]
+ *   unsigned int  [n_lines]   - line map, offsets into the source.
+ *   aseb_sym_t    [n_syms]
+ */
+typedef struct aseb_hdr {
+	/**
+	 * build    - Key of the emulator build that wrote the file.
+	 * src_hash - Hash of the source text.
+	 * src_len  - Length of the source text.
+	 */
+	char magic[4];
+	uint32_t version;
+	uint64_t build, src_hash, src_len;
+	uint32_t n_instrs, n_lines, n_syms, pad;
+	uint64_t off_instrs, off_lines, off_syms;
+} aseb_hdr_t;
+
+typedef struct aseb_sym {
+	/**
+	 * off, len  - Label name, as an offset into the source.
+	 * line, idx - See sym_t.
+	 */
+	uint32_t off, len;
+	int32_t line, idx;
+} aseb_sym_t;
+
+void    cache_path (const char *src_path, char *buf, unsigned long size);
+prog_t *load_cache (glob_t *glob, src_t *src, const char *path);
+int     save_cache (prog_t *prog, src_t *src, const char *path);
+
+#endif
@@ -10,9 +10,17 @@
 #include <string.h>
 
 #include "display.h"
+#include "flags.h"
 
 #define BUILD 1906
 
+#define REG_NAME(name) #name,
+
+/* Names of the registers, indexed by register id. */
+static const char reg_name[N_REG][3] = {
+	REG_SET(REG_NAME)
+};
+
 /**
  * @desc  : Display the help menu.
  * @return: void
@@ -20,14 +28,25 @@
 void show_flags() {
   fprintf(stderr, "Supported flags: \n\
 		-a : Enable all (below) emulator specified flags \n\
+		-b : Break at line N and step through the program from there \n\
+		-c : Cache the assembled program in [Source File].aseb \n\
 		-d : Enable debug mode \n\
+		-e : Translate [Source File] into a standalone C program, written to E \n\
 		-f : Show flag contents \n\
+		-F : Fuse common instruction pairs into superinstructions \n\
 		-h : Show help (this) screen \n\
+		-j : Number of threads assembling [Source File], one per core by default \n\
+		-J : Translate hot blocks into x86-64 code, report how many \n\
+		-k : With -W, keep registers, flags, memory and stack between runs \n\
 		-l : Display declared labels with their line \n\
 		-m : Show memory contents \n\
+		-p : Execute while the source is still being assembled \n\
+		-P : Load the instructions of the plugin P, may be given more than once \n\
 		-r : Show register contents \n\
 		-s : Show stack contents \n\
-		-v : Show version info \n");
+		-v : Show version info \n\
+		-W : Run again each time [Source File] is saved \n\
+		A directory as [Source File] runs every .asm file in it \n");
 }
 
 /**
@@ -41,6 +60,7 @@ void display(glob_t *glob, args_t p_args) {
 	}
 
 	if (p_args.f && glob->flags) {
+		flags_sync(glob->flags);
 		printf("Flags:\n");
 		printf("[CF]:[%d]\n",   glob->flags->cf);
 		printf("[DF]:[%d]\n",   glob->flags->df);
@@ -55,44 +75,55 @@ void display(glob_t *glob, args_t p_args) {
 		show_flags();
 	}
 
-	if (p_args.l) {
-		if (glob->idx) {
+	if (p_args.l && glob->prog) {
+		symtab_t *labels = glob->prog->labels;
+		if (labels->n) {
 			printf("User specified labels:\n");
 		}
 
-		for (int i = 0; i < glob->idx; i++) {
-			printf("[%s]:[%d]\n", glob->label_locs[i].label,
-				glob->label_locs[i].line);
+		for (int i = 0; i < labels->n; i++) {
+			printf("[%.*s]:[%d]\n", labels->syms[i].name.len,
+				labels->syms[i].name.ptr, labels->syms[i].line);
 		}
 	}
 
+	/* Bytes that hold something, by physical address - only written pages can. */
 	if (p_args.m && glob->mem) {
-		mem_nodes_t *node = glob->mem->head;
-		
-		if (node && glob) {
-			printf("Memory:\n");
-			
-			while (node && glob) {
-				printf("[%d:%d] - [%s]\n", node->seg, node->offset, node->val);
-				node = node->next;
+		int shown = 0;
+
+		for (uint32_t pn = 0; pn < N_PAGES; pn++) {
+			const uint8_t *page = glob->mem->pages[pn];
+
+			for (int off = 0; page && off < PAGE_SZ; off++) {
+				if (!page[off]) {
+					continue;
+				}
+
+				if (!shown++) {
+					printf("Memory:\n");
+				}
+				printf("[%05x] - [%x]\n", pn << PAGE_SHIFT | off, page[off]);
 			}
 		}
+
+		if (shown) {
+			printf("\n");
+		}
 	}
 
 	if (p_args.r && glob->registers) {
 		printf("Register:\n");
-		printf("[AX]:[%s]\n",   glob->registers->ax);
-		printf("[BX]:[%s]\n",   glob->registers->bx);
-		printf("[CX]:[%s]\n",   glob->registers->cx);
-		printf("[DX]:[%s]\n\n", glob->registers->dx);
+		for (int i = 0; i < N_REG; i++) {
+			printf("[%s]:[%x]\n", reg_name[i], glob->registers->x[i]);
+		}
+		printf("[IP]:[%x]\n\n", glob->ip);
 	}
 
+	/* The words from SS:SP up to the first one pushed. */
 	if (p_args.s && glob->stack) {
-		int sz = glob->stack->top;
-		while (sz >= 0) {
-			printf("[%p]:[%s]\n", (void*)&glob->stack->arr[sz],
-				glob->stack->arr[sz]);
-			sz--;
+		for (int n = 0; n <= glob->stack->top; n++) {
+			printf("[%04x]:[%x]\n", (uint16_t)(glob->registers->x[R_SP] + 2 * n),
+				mem_read(glob->mem, STACK_PA(glob, n), 16));
 		}
 	}
 
@@ -9,9 +9,14 @@
 
 #include "glob.h"
 #include "parse.h"
+#include "symtab.h"
 
 typedef struct args_ {
-	int a, f, h, l, m, r, s, v;
+	int a, c, f, h, k, l, m, p, r, s, v, F, J, W;
+	/* File to write the C translation to, NULL if none. */
+	const char *e;
+	/* Set if a plugin failed to load. */
+	int P;
 } args_t;
 
 void display    (glob_t *glob, args_t p_args);
@@ -0,0 +1,730 @@
+/**
+ * @file: emit.c
+ * @desc: Defines the translator from an assembled program to a
+ *        standalone C program. Every instruction becomes the C statements
+ *        its handler would run on the operands it was assembled with,
+ *        labels become goto targets, flags and registers locals of
+ *        main(). The byte registers are shifts and masks of theirs.
+ *        Once compiled the program runs natively and prints the state
+ *        display() would, for the display options given to ASE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "bind.h"
+#include "emit.h"
+#include "symtab.h"
+
+/**
+ * Runtime of the emitted program. The registers are locals of main(),
+ * the macros naming them are only used there. Memory is the pages of
+ * mem_t laid end to end, a single program only has the pages it touches
+ * backed by the system anyway.
+ */
+static const char prelude[] =
+	"#include <stdint.h>\n"
+	"#include <stdio.h>\n"
+	"#include <stdlib.h>\n"
+	"#include <string.h>\n"
+	"\n"
+	"#define STACK_MAX (1 << 15)\n"
+	"\n"
+	"#define S8(v)  ((int8_t)(v))\n"
+	"#define S16(v) ((int16_t)(v))\n"
+	"\n"
+	"#define MEM_SZ   (1 << 20)\n"
+	"#define MEM_MASK (MEM_SZ - 1)\n"
+	"\n"
+	"/* Physical address of a memory operand, see OP_PA(). */\n"
+	"#define MEM_ADDR(seg, off) ((((uint32_t)(seg) << 4) + (uint16_t)(off)) & MEM_MASK)\n"
+	"\n"
+	"/* STACK_PA() */\n"
+	"#define STACK_ADDR(n) ((((uint32_t)SS << 4) + (uint16_t)(SP + 2 * (n))) & MEM_MASK)\n"
+	"\n"
+	"#define LZ_ADD 1\n"
+	"#define LZ_SUB 2\n"
+	"#define LZ_MUL 3\n"
+	"#define LZ_INC 4\n"
+	"#define LZ_DEC 5\n"
+	"\n"
+	"/* flags_eval() for the types of one width, unused flags are dropped by the compiler. */\n"
+	"#define ALU_FLAGS(op, ut, st, d, s, r)                                      \\\n"
+	"\tdo {                                                                    \\\n"
+	"\t\tut u_;                                                              \\\n"
+	"\t\tst s_;                                                              \\\n"
+	"\t\tswitch (op) {                                                       \\\n"
+	"\t\tcase LZ_ADD:                                                        \\\n"
+	"\t\t\tcf = __builtin_add_overflow((ut)(d), (ut)(s), &u_);             \\\n"
+	"\t\t\tof = __builtin_add_overflow((st)(d), (st)(s), &s_);             \\\n"
+	"\t\t\tbreak;                                                          \\\n"
+	"\t\tcase LZ_SUB:                                                        \\\n"
+	"\t\t\tcf = __builtin_sub_overflow((ut)(d), (ut)(s), &u_);             \\\n"
+	"\t\t\tof = __builtin_sub_overflow((st)(d), (st)(s), &s_);             \\\n"
+	"\t\t\tbreak;                                                          \\\n"
+	"\t\tcase LZ_INC:                                                        \\\n"
+	"\t\t\tof = __builtin_add_overflow((st)(d), (st)(s), &s_);             \\\n"
+	"\t\t\tbreak;                                                          \\\n"
+	"\t\tcase LZ_DEC:                                                        \\\n"
+	"\t\t\tof = __builtin_sub_overflow((st)(d), (st)(s), &s_);             \\\n"
+	"\t\t\tbreak;                                                          \\\n"
+	"\t\tcase LZ_MUL:                                                        \\\n"
+	"\t\t\tcf = of = __builtin_mul_overflow((st)(d), (st)(s), &s_);        \\\n"
+	"\t\t\tbreak;                                                          \\\n"
+	"\t\t}                                                                   \\\n"
+	"\t\taf = (((d) ^ (s) ^ (r)) >> 4) & ((op) != LZ_MUL);                  \\\n"
+	"\t\tzf = (ut)(r) == 0;                                                  \\\n"
+	"\t\tsf = (st)(r) < 0;                                                   \\\n"
+	"\t\tpf = !(__builtin_popcount((ut)(r) & 0xff) & 1);                     \\\n"
+	"\t} while (0)\n"
+	"\n"
+	"#define FAIL(l, i) do { line = (l); ip = (i); goto fail; } while (0)\n"
+	"#define ERR(l, i, m) do { fputs((m), stderr); FAIL(l, i); } while (0)\n"
+	"\n"
+	"static uint8_t ram[MEM_SZ];\n"
+	"static int warned;\n"
+	"\n"
+	"/* put_op_val() - tells if v can be stored, without overflowing max. */\n"
+	"static inline int fits(int v, int max) {\n"
+	"\tif (v > max || v < -max - 1) {\n"
+	"\t\tfprintf(stderr, \"put_op_val(): Operand value too large [%d].\\n\", v);\n"
+	"\t\treturn 0;\n"
+	"\t}\n"
+	"\treturn 1;\n"
+	"}\n"
+	"\n"
+	"/* mem_read() - little endian word, wrapping around past 1 MiB. */\n"
+	"static inline int mem_get(uint32_t pa) {\n"
+	"\treturn ram[pa] | ram[(pa + 1) & MEM_MASK] << 8;\n"
+	"}\n"
+	"\n"
+	"/* mem_write() */\n"
+	"static inline void mem_put(uint32_t pa, int val) {\n"
+	"\tram[pa] = (uint8_t)val;\n"
+	"\tram[(pa + 1) & MEM_MASK] = (uint8_t)(val >> 8);\n"
+	"}\n"
+	"\n"
+	"/* mem_store() - a byte if w is 8, else a word. segs tells DS and ES are set. */\n"
+	"static inline void mem_set(uint32_t pa, int w, int val, int segs) {\n"
+	"\tif (!segs && !warned && !getenv(\"DIW\")) {\n"
+	"\t\tfprintf(stderr, \"mem_store(): Did not init [D/E]S?\\n\");\n"
+	"\t\twarned = 1;\n"
+	"\t}\n"
+	"\tif (w == 8) {\n"
+	"\t\tram[pa] = (uint8_t)val;\n"
+	"\t} else {\n"
+	"\t\tmem_put(pa, val);\n"
+	"\t}\n"
+	"}\n"
+	"\n";
+
+#define REG_NAME(name) #name,
+
+/* Names of the registers, indexed by register id. */
+static const char reg_name[N_REG][3] = {
+	REG_SET(REG_NAME)
+};
+
+#define EA_REGS(name, r1, r2) {r1, r2},
+
+/* Registers of each effective address form, -1 for none. */
+static const int ea_regs[N_EA][2] = {
+	EA_SET(EA_REGS)
+};
+
+/* Set once the emitted program refers to its fail label. */
+static int fails;
+
+/* Index of the instruction being emitted, glob->ip once it fails. */
+static int cur_ip;
+
+/**
+ * @desc  : Writes the C expression of the value of a register operand -
+ *          a 16 bit register or one of its bytes - into buf.
+ * @param : buf -
+ *          op  - register operand.
+ * @return: const char* - buf.
+ */
+static const char *reg_cell(char *buf, const operand_t *op) {
+	if (op->width == 8) {
+		sprintf(buf, op->hi ? "(uint8_t)(%s >> 8)" : "(uint8_t)%s", reg_name[op->reg]);
+	} else {
+		sprintf(buf, "%s", reg_name[op->reg]);
+	}
+	return buf;
+}
+
+/* Unsigned and signed type of the width of op, for ALU_FLAGS(). */
+static const char *alu_types(const operand_t *op) {
+	return OP_WIDTH(op) == 8 ? "uint8_t, int8_t" : "uint16_t, int16_t";
+}
+
+/* Macro reading the value of op as signed, as math_op() does. */
+static const char *op_signed(const operand_t *op) {
+	return OP_WIDTH(op) == 8 ? "S8" : "S16";
+}
+
+/* Writes s as the body of a C string literal. */
+static void put_str(FILE *out, const char *s, int len) {
+	for (int i = 0; i < len && s[i]; i++) {
+		unsigned char ch = s[i];
+		if (ch == '\\' || ch == '"') {
+			fprintf(out, "\\%c", ch);
+		} else if (ch < ' ' || ch > '~') {
+			fprintf(out, "\\%03o", ch);
+		} else {
+			fputc(ch, out);
+		}
+	}
+}
+
+/**
+ * @desc  : Emits the statement ending the run with an error.
+ * @param : out  -
+ *          line - source line the error is reported on.
+ *          cond - C condition of the error, NULL if there is none.
+ *          msg  - message printed first, NULL for none.
+ * @return: void
+ */
+static void put_err(FILE *out, int line, const char *cond, const char *msg) {
+	fails = 1;
+	fputc('\t', out);
+	if (cond) {
+		fprintf(out, "if (%s) ", cond);
+	}
+
+	/* glob->ip is past the failing instruction. */
+	if (!msg) {
+		fprintf(out, "FAIL(%d, %d);\n", line, cur_ip + 1);
+		return;
+	}
+
+	fprintf(out, "ERR(%d, %d, \"", line, cur_ip + 1);
+	put_str(out, msg, strlen(msg));
+	fprintf(out, "\\n\");\n");
+}
+
+/* Writes the C expression of the physical address of a memory operand into buf, see OP_PA(). */
+static const char *mem_addr(char *buf, const operand_t *op) {
+	int n = sprintf(buf, "MEM_ADDR(%s, ", reg_name[op->reg]);
+
+	for (int i = 0; i < 2; i++) {
+		int r = ea_regs[op->ea][i];
+		if (r >= 0) {
+			n += sprintf(buf + n, "%s + ", reg_name[r]);
+		}
+	}
+
+	sprintf(buf + n, "%d)", op->val);
+	return buf;
+}
+
+/* Writes the C expression of the value of a register or memory operand into buf. */
+static const char *op_cell(char *buf, const operand_t *op) {
+	char addr[64];
+
+	if (op->kind == OP_MEM) {
+		sprintf(buf, OP_WIDTH(op) == 8 ? "ram[%s]" : "mem_get(%s)", mem_addr(addr, op));
+		return buf;
+	}
+	return reg_cell(buf, op);
+}
+
+/* Emits what set_op_val() does - stores the C expression val to op, a byte register keeps the other byte. */
+static void put_set(FILE *out, const operand_t *op, const char *val) {
+	const char *reg = reg_name[op->reg];
+	char cell[96];
+
+	if (op->kind == OP_MEM) {
+		fprintf(out, "mem_set(%s, %d, %s, DS && ES);\n", mem_addr(cell, op), OP_WIDTH(op), val);
+	} else if (op->width != 8) {
+		fprintf(out, "%s = %s;\n", reg, val);
+	} else if (op->hi) {
+		fprintf(out, "%s = (uint16_t)((%s & 0xff) | (uint8_t)(%s) << 8);\n", reg, reg, val);
+	} else {
+		fprintf(out, "%s = (uint16_t)((%s & 0xff00) | (uint8_t)(%s));\n", reg, reg, val);
+	}
+}
+
+/**
+ * @desc  : Emits what get_op_val() does for op - reads it into val.
+ *          Registers, memory and literals always succeed, anything else
+ *          fails.
+ * @param : out -
+ *          op  - operand to read.
+ *          val - name of the int receiving the value.
+ * @return: int - 1 if the read succeeds, 0 if it fails.
+ */
+static int put_get(FILE *out, const operand_t *op, const char *val) {
+	char cell[96];
+
+	switch (op->kind) {
+	case OP_REG:
+	case OP_MEM:
+		fprintf(out, "\t%s = %s;\n", val, op_cell(cell, op));
+		return 1;
+
+	case OP_IMM:
+		fprintf(out, "\t%s = 0x%x;\n", val, op->val & 0xffff);
+		return 1;
+	}
+
+	/* Labels and missing operands have no value. */
+	return 0;
+}
+
+/**
+ * @desc  : Emits math_op() storing the result of ADD, SUB or MUL.
+ * @param : out  -
+ *          dest - destination operand.
+ *          line - source line, for errors.
+ * @return: void
+ */
+static void put_store(FILE *out, const operand_t *dest, int line) {
+	int max = OP_WIDTH(dest) == 8 ? 127 : 32767;
+
+	if (dest->kind != OP_MEM && dest->kind != OP_REG) {
+		put_err(out, line, NULL, "math_op(): invalid destination operand.");
+		return;
+	}
+
+	fprintf(out, "\tif (fits(res, %d)) ", max);
+	put_set(out, dest, "res");
+}
+
+/* math_op() - ADD, SUB, MUL and CMP. */
+static void put_alu(FILE *out, const instr_t *instr) {
+	const operand_t acc = {OP_REG, R_AX, 16, 0, 0, 0};
+	const operand_t *dest = &instr->ops[0], *src_ = &instr->ops[1];
+	int line = instr->line;
+
+	/* MUL multiplies AX, the accumulator, by its only operand. */
+	if (instr->opc == OPC_MUL) {
+		dest = &acc;
+		src_ = &instr->ops[0];
+	}
+
+	/* Fails if only one of the operands can be read. */
+	int st0 = put_get(out, dest, "t0");
+	int st1 = put_get(out, src_, "t1");
+	if (st0 != st1) {
+		put_err(out, line, NULL, NULL);
+		return;
+	} else if (!st0) {
+		fprintf(out, "\tt0 = t1 = 0;\n");
+	}
+
+	int max = OP_WIDTH(dest) == 8 ? 127 : 32767;
+	const char *types = alu_types(dest);
+	fprintf(out, "\td = %s(t0), s = %s(t1);\n", op_signed(dest), op_signed(src_));
+
+	switch (instr->opc) {
+	case OPC_ADD:
+		/* An overflowing sum still stores 0, then fails. */
+		fprintf(out, "\tres = d + s, ovf = 0;\n\tALU_FLAGS(LZ_ADD, %s, d, s, res);\n", types);
+		fprintf(out, "\tif (res > %d || res < %d) {\n"
+		             "\t\tfputs(\"Overflow: operand value exceeds the limits.\\n\", stderr);\n"
+		             "\t\tres = 0, ovf = 1;\n"
+		             "\t}\n", max, -max - 1);
+		put_store(out, dest, line);
+		put_err(out, line, "ovf", NULL);
+		return;
+
+	case OPC_SUB:
+		fprintf(out, "\tres = d - s;\n\tALU_FLAGS(LZ_SUB, %s, d, s, res);\n", types);
+		put_store(out, dest, line);
+		return;
+
+	case OPC_MUL:
+		fprintf(out, "\tres = d * s;\n\tALU_FLAGS(LZ_MUL, %s, d, s, res);\n", types);
+		put_store(out, dest, line);
+		return;
+
+	case OPC_CMP:
+		/* SUB without the store. */
+		fprintf(out, "\tALU_FLAGS(LZ_SUB, %s, d, s, d - s);\n", types);
+		return;
+	}
+}
+
+/* move() - MOV. */
+static void put_mov(FILE *out, const instr_t *instr) {
+	const operand_t *dest = &instr->ops[0], *src_ = &instr->ops[1];
+	int line = instr->line;
+
+	if (dest->kind == OP_REG && src_->kind == OP_REG && dest->width != src_->width) {
+		put_err(out, line, NULL, "move(): both registers must be of same size.");
+		return;
+	}
+
+	if (dest->kind != OP_MEM && dest->kind != OP_REG) {
+		put_err(out, line, NULL, "move(): invalid destination operand.");
+		return;
+	}
+
+	if (!put_get(out, src_, "t1")) {
+		put_err(out, line, NULL, NULL);
+		return;
+	}
+
+	fputc('\t', out);
+	put_set(out, dest, "t1");
+}
+
+/* unary() and neg() - INC, DEC and NEG. */
+static void put_unary(FILE *out, const instr_t *instr) {
+	const operand_t *op = &instr->ops[0];
+	char cell[96];
+
+	if (op->kind != OP_REG && op->kind != OP_MEM) {
+		put_err(out, instr->line, NULL, instr->opc == OPC_NEG ?
+			"neg(): Invalid operand specified." : "unary(): Invalid operand specified.");
+		return;
+	}
+
+	/* The value is read as wide as the operand. */
+	fprintf(out, "\td = %s(%s);\n", op_signed(op), op_cell(cell, op));
+	switch (instr->opc) {
+	case OPC_INC: fprintf(out, "\tres = d + 1;\n\tALU_FLAGS(LZ_INC, %s, d, 1, res);\n", alu_types(op)); break;
+	case OPC_DEC: fprintf(out, "\tres = d - 1;\n\tALU_FLAGS(LZ_DEC, %s, d, 1, res);\n", alu_types(op)); break;
+	case OPC_NEG: fprintf(out, "\tres = -d;\n\tALU_FLAGS(LZ_SUB, %s, 0, d, res);\n", alu_types(op)); break;
+	}
+	fputc('\t', out);
+	put_set(out, op, "res");
+}
+
+/* xchg() - XCHG. */
+static void put_xchg(FILE *out, const instr_t *instr) {
+	int line = instr->line;
+
+	if (instr->ops[0].kind == OP_MEM && instr->ops[1].kind == OP_MEM) {
+		put_err(out, line, NULL, "xchg(): Both the operands cannot be memory addresses.");
+		return;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		const operand_t *op = &instr->ops[i];
+
+		if (op->kind != OP_REG && op->kind != OP_MEM) {
+			char msg[64];
+			snprintf(msg, sizeof(msg), "xchg(): Invalid operand specified [op%d].", i + 1);
+			put_err(out, line, NULL, msg);
+			return;
+		}
+	}
+
+	put_get(out, &instr->ops[0], "t0");
+	put_get(out, &instr->ops[1], "t1");
+	fputc('\t', out);
+	put_set(out, &instr->ops[0], "t1");
+	fputc('\t', out);
+	put_set(out, &instr->ops[1], "t0");
+}
+
+/* push() and pop() - PUSH and POP. */
+static void put_stack(FILE *out, const instr_t *instr) {
+	const operand_t *op = &instr->ops[0];
+	int line = instr->line;
+
+	if (instr->opc == OPC_PUSH) {
+		/* The stack holds a segment of STACK_MAX words, a failed read still pushes 0. */
+		put_err(out, line, "top + 1 >= STACK_MAX", "push(): Stack overflow.");
+		fprintf(out, "\tt1 = 0;\n");
+		int st = put_get(out, op, "t1");
+		fprintf(out, "\tSP -= 2;\n\tmem_put(STACK_ADDR(0), t1);\n\ttop++;\n");
+		if (!st) {
+			put_err(out, line, NULL, NULL);
+		}
+		return;
+	}
+
+	if (op->kind != OP_MEM && op->kind != OP_REG) {
+		put_err(out, line, NULL, "pop(): Invalid operand specified.");
+		return;
+	}
+
+	put_err(out, line, "top < 0", "Illegal instruction: POP before PUSH.");
+	fprintf(out, "\tt1 = mem_get(STACK_ADDR(0));\n\tSP += 2;\n\ttop--;\n\t");
+	put_set(out, op, "t1");
+}
+
+/* Tells if an instruction is a jump, decided at assembly. */
+static int is_jump(const instr_t *instr) {
+	switch (instr->opc) {
+	case OPC_JC: case OPC_JCXZ: case OPC_JE: case OPC_JMP:
+	case OPC_JNC: case OPC_JNE: case OPC_JP: case OPC_JPE:
+		return instr->n_op == instr_set[instr->form].n_ops;
+	}
+
+	return 0;
+}
+
+/* jump() - JMP, JCXZ and the conditional jumps. */
+static void put_jump(FILE *out, const instr_t *instr) {
+	const char *cond = NULL;
+
+	switch (instr->opc) {
+	case OPC_JC:   cond = "cf == 1"; break;
+	case OPC_JNC:  cond = "cf == 0"; break;
+	case OPC_JE:   cond = "zf == 1"; break;
+	case OPC_JNE:  cond = "zf == 0"; break;
+	case OPC_JP:   cond = "pf == 1"; break;
+	case OPC_JCXZ: cond = "CX == 0"; break;
+
+	/* jump_jx() goes by the last letter, so JPE tests ZF like JE. */
+	case OPC_JPE:  cond = "zf == 1"; break;
+	}
+
+	if (instr->target < 0) {
+		put_err(out, instr->line, cond, "jump(): Undefined label.");
+	} else if (cond) {
+		fprintf(out, "\tif (%s) goto L%d;\n", cond, instr->target);
+	} else {
+		fprintf(out, "\tgoto L%d;\n", instr->target);
+	}
+}
+
+/**
+ * @desc  : Emits the statements of one instruction.
+ * @param : out   -
+ *          prog  -
+ *          instr - instruction to emit.
+ * @return: void
+ */
+static void put_instr(FILE *out, prog_t *prog, const instr_t *instr) {
+	const operand_t ah = {OP_REG, R_AX, 8, 1, 0, 0, 0};
+	tok_t text = src_line(prog, instr->line);
+	int line = instr->line;
+	char msg[64];
+
+	/* Source line as a comment, without anything closing it early. */
+	fprintf(out, "\t/* %d: ", line);
+	for (int i = 0; i < text.len; i++) {
+		char ch = text.ptr[i];
+		int star = (i && text.ptr[i - 1] == '*') || (i + 1 < text.len && text.ptr[i + 1] == '*');
+		fputc((ch == '/' && star) || ch < ' ' ? ' ' : ch, out);
+	}
+	fprintf(out, " */\n");
+
+	if (instr->opc == OPC_BAD) {
+		snprintf(msg, sizeof(msg), "Invalid entry [%s]: reached end of the table.", instr->mnem);
+		put_err(out, line, NULL, msg);
+		return;
+	}
+
+	if (instr->opc != OPC_NONE && instr->n_op != instr_set[instr->form].n_ops) {
+		snprintf(msg, sizeof(msg), "exec_prog(): Invalid number of operands [%d] [%s].",
+			instr->n_op, instr->mnem);
+		put_err(out, line, NULL, msg);
+		return;
+	}
+
+	switch (instr->opc) {
+	case OPC_ADD: case OPC_CMP: case OPC_MUL: case OPC_SUB:
+		put_alu(out, instr);
+		return;
+
+	case OPC_DEC: case OPC_INC: case OPC_NEG:
+		put_unary(out, instr);
+		return;
+
+	case OPC_MOV:  put_mov(out, instr); return;
+	case OPC_XCHG: put_xchg(out, instr); return;
+
+	case OPC_POP: case OPC_PUSH:
+		put_stack(out, instr);
+		return;
+
+	case OPC_JC: case OPC_JCXZ: case OPC_JE: case OPC_JMP:
+	case OPC_JNC: case OPC_JNE: case OPC_JP: case OPC_JPE:
+		put_jump(out, instr);
+		return;
+
+	case OPC_CLC: fprintf(out, "\tcf = 0;\n"); return;
+	case OPC_CLD: fprintf(out, "\tdf = 0;\n"); return;
+	case OPC_CLI: fprintf(out, "\tiif = 0;\n"); return;
+	case OPC_CMC: fprintf(out, "\tcf = !cf;\n"); return;
+	case OPC_STC: fprintf(out, "\tcf = 1;\n"); return;
+	case OPC_STD: fprintf(out, "\tdf = 1;\n"); return;
+	case OPC_STI: fprintf(out, "\tiif = 1;\n"); return;
+	case OPC_HLT: fprintf(out, "\tip = %d;\n\tgoto done;\n", cur_ip + 1); return;
+
+	/* AH is SF ZF 0 AF 0 PF 1 CF, from bit 7 down. */
+	case OPC_LAHF:
+		fprintf(out, "\tt0 = sf << 7 | zf << 6 | af << 4 | pf << 2 | 1 << 1 | cf;\n\t");
+		put_set(out, &ah, "t0");
+		return;
+
+	case OPC_SAHF:
+		put_get(out, &ah, "t0");
+		fprintf(out, "\tsf = t0 >> 7 & 1, zf = t0 >> 6 & 1, af = t0 >> 4 & 1;\n"
+		             "\tpf = t0 >> 2 & 1, cf = t0 & 1;\n");
+		return;
+
+	case OPC_ORG:
+		if (instr->ops[0].kind != OP_IMM) {
+			put_err(out, line, NULL, "org(): Invalid address.");
+		}
+		return;
+	}
+
+	/* NOP, IN, OUT and lines without an instruction. */
+}
+
+/* display() for the options given, labels are known already. */
+static void put_display(FILE *out, prog_t *prog, args_t args) {
+	if (args.f) {
+		fprintf(out, "\tprintf(\"Flags:\\n\");\n"
+		             "\tprintf(\"[CF]:[%%d]\\n\", cf);\n"
+		             "\tprintf(\"[DF]:[%%d]\\n\", df);\n"
+		             "\tprintf(\"[IF]:[%%d]\\n\", iif);\n"
+		             "\tprintf(\"[OF]:[%%d]\\n\", of);\n"
+		             "\tprintf(\"[PF]:[%%d]\\n\", pf);\n"
+		             "\tprintf(\"[SF]:[%%d]\\n\", sf);\n"
+		             "\tprintf(\"[ZF]:[%%d]\\n\\n\", zf);\n");
+	}
+
+	if (args.l && prog->labels->n) {
+		fprintf(out, "\tfputs(\"User specified labels:\\n\", stdout);\n");
+	}
+
+	for (int i = 0; args.l && i < prog->labels->n; i++) {
+		sym_t *sym = &prog->labels->syms[i];
+		fprintf(out, "\tfputs(\"[");
+		put_str(out, sym->name.ptr, sym->name.len);
+		fprintf(out, "]:[%d]\\n\", stdout);\n", sym->line);
+	}
+
+	if (args.m) {
+		fprintf(out, "\tfor (n = t0 = 0; n < MEM_SZ; n++) {\n"
+		             "\t\tif (ram[n] && !t0++) {\n"
+		             "\t\t\tprintf(\"Memory:\\n\");\n"
+		             "\t\t}\n"
+		             "\t\tif (ram[n]) {\n"
+		             "\t\t\tprintf(\"[%%05x] - [%%x]\\n\", n, ram[n]);\n"
+		             "\t\t}\n"
+		             "\t}\n"
+		             "\tif (t0) {\n"
+		             "\t\tprintf(\"\\n\");\n"
+		             "\t}\n");
+	}
+
+	if (args.r) {
+		fprintf(out, "\tprintf(\"Register:\\n\");\n");
+		for (int i = 0; i < N_REG; i++) {
+			fprintf(out, "\tprintf(\"[%s]:[%%x]\\n\", %s);\n", reg_name[i], reg_name[i]);
+		}
+		fprintf(out, "\tprintf(\"[IP]:[%%x]\\n\\n\", ip);\n");
+	}
+
+	if (args.s) {
+		fprintf(out, "\tfor (n = 0; n <= top; n++) {\n"
+		             "\t\tprintf(\"[%%04x]:[%%x]\\n\", (uint16_t)(SP + 2 * n), mem_get(STACK_ADDR(n)));\n"
+		             "\t}\n");
+	}
+}
+
+/**
+ * @desc  : Translates the assembled program of glob into a standalone C
+ *          program that runs it and prints what display() would with
+ *          args. The warnings ASE would print are printed too, unless
+ *          they were turned off.
+ * @param : glob -
+ *          args - display options.
+ *          path - file to write the program to.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int emit_c(glob_t *glob, args_t args, const char *path) {
+	prog_t *prog = glob->prog;
+	if (!prog) {
+		fprintf(stderr, "emit_c(): nullptr received.\n");
+		return 0;
+	}
+
+	/* Handlers of plugins are machine code, there is no C to give for them. */
+	for (int i = 0; i < prog->n; i++) {
+		const instr_t *instr = &prog->instrs[i];
+		if (instr->opc >= OPC_EXT && instr->opc <= OPC_EXT_LAST) {
+			fprintf(stderr, "emit_c(): [%s] @ [%d] comes from a plugin, can not translate it.\n",
+				instr->mnem, instr->line);
+			return 0;
+		}
+	}
+
+	FILE *out = fopen(path, "w");
+	if (!out) {
+		fprintf(stderr, "emit_c(): Could not open %s.\n", path);
+		return 0;
+	}
+
+	/* Instructions a jump lands on get a label. */
+	char *target = calloc(prog->n + 1, 1);
+	if (!target) {
+		fprintf(stderr, "emit_c(): malloc failure.\n");
+		fclose(out);
+		return 0;
+	}
+
+	for (int i = 0; i < prog->n; i++) {
+		const instr_t *instr = &prog->instrs[i];
+		if (is_jump(instr) && instr->target >= 0) {
+			target[instr->target] = 1;
+		}
+	}
+
+	fails = 0;
+	fprintf(out, "/* Generated by ase --emit-c, do not edit. */\n\n%s", prelude);
+	fprintf(out, "int main(void) {\n\tuint16_t ");
+	for (int i = 0; i < N_REG; i++) {
+		fprintf(out, "%s = 0%s", reg_name[i], i + 1 < N_REG ? ", " : ";\n");
+	}
+
+	fprintf(out, "\tint af = 0, cf = 0, df = 0, iif = 0, of = 0, pf = 0, sf = 0, zf = 0;\n"
+	             "\tint t0 = 0, t1 = 0;\n"
+	             "\tint d = 0, s = 0, res = 0, ovf = 0, n = 0;\n"
+	             "\tint top = -1, line = 0, ip = %d, failed = 0;\n"
+	             "\n"
+	             "\t(void)af, (void)cf, (void)df, (void)iif, (void)of, (void)pf, (void)sf, (void)zf;\n"
+	             "\t(void)t0, (void)t1, (void)d, (void)s;\n"
+	             "\t(void)res, (void)ovf, (void)n, (void)top, (void)line, (void)ip;\n\t", prog->n);
+
+	/* Registers the program leaves alone are still declared. */
+	for (int i = 0; i < N_REG; i++) {
+		fprintf(out, "(void)%s%s", reg_name[i], i + 1 < N_REG ? ", " : ";\n");
+	}
+	fprintf(out, "\twarned = %d;\n\n", glob->mem->warned);
+
+	for (int i = 0; i < prog->n; i++) {
+		if (target[i]) {
+			fprintf(out, "L%d:\n", i);
+		}
+		cur_ip = i;
+		put_instr(out, prog, &prog->instrs[i]);
+	}
+
+	if (target[prog->n]) {
+		fprintf(out, "L%d:\n", prog->n);
+	}
+
+	fprintf(out, "\tgoto done;\n\n");
+	if (fails) {
+		fprintf(out, "fail:\n"
+		             "\tfailed = 1;\n"
+		             "\tfprintf(stderr, \"Emulator halted due to an error in line %%d. State preserved.\\n\\n\", line);\n\n");
+	}
+
+	fprintf(out, "done:\n");
+	put_display(out, prog, args);
+	fprintf(out, "\treturn failed;\n}\n");
+
+	free(target);
+	int ok = !ferror(out);
+	if (fclose(out) || !ok) {
+		fprintf(stderr, "emit_c(): Could not write %s.\n", path);
+		return 0;
+	}
+
+	return 1;
+}
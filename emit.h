@@ -0,0 +1,16 @@
+/**
+ * @file: emit.h
+ * @desc: Declares the translator from an assembled program to a
+ *        standalone C program, which prints the state display() would
+ *        once compiled and run.
+ */
+
+#ifndef _ASE_EMIT_H_
+#define _ASE_EMIT_H_
+
+#include "display.h"
+#include "glob.h"
+
+int emit_c (glob_t *glob, args_t args, const char *path);
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * @file: exec.c
+ * @desc: Defines the fast execution engine - runs an assembled program
+ *        without the debug, breakpoint and stream checks of main's loop.
+ */
+
+#include <stdio.h>
+
+#include "bind.h"
+#include "exec.h"
+#include "fuse.h"
+#include "probe.h"
+
+/* Makes the next instruction current, leaves once the program ends. */
+#define FETCH()                                  \
+	if (ip >= n) {                               \
+		goto done;                               \
+	}                                            \
+	op = exec[ip];                               \
+	instr = &instrs[ip++];                       \
+	glob->c_line = instr->line;                  \
+	glob->n_op = instr->n_op;                    \
+	glob->instr = instr;                         \
+	steps++;                                     \
+	PROBE_INSTR(instr);
+
+/**
+ * Body of a handler - a HLT (-1) or a failure (0) ends the run. The ip
+ * lives in a local, handlers see it in glob->ip and jumps move it there.
+ */
+#define CALL(f_ptr)                                      \
+		glob->ip = ip;                                   \
+		ret = f_ptr(glob, NULL, BUF_SZ);                 \
+		ip = glob->ip;                                   \
+		if (!ret || ret == -1) {                         \
+			goto done;                                   \
+		}                                                \
+		NEXT();
+
+/* Generic handlers check the operand count, find_form() and fuse_prog() did for the rest. */
+#define BODY(f_ptr, n_ops)                               \
+		if (instr->n_op != n_ops) {                      \
+			goto bad_ops;                                \
+		}                                                \
+		CALL(f_ptr)
+
+/* Names are pasted directly, they may be defined as macros elsewhere. */
+#ifdef EXEC_THREADED
+#define CASE(name) op_##name
+#define NEXT()     do { FETCH(); goto *labels[op]; } while (0)
+#define HANDLER(name, f_ptr, n_ops) op_##name: BODY(f_ptr, n_ops)
+#define FORM(name, k0, k1, f_ptr)   form_##name##_##k0##_##k1: CALL(f_ptr)
+#define FUSE(name, f_ptr)           fuse_##name: CALL(f_ptr)
+#else
+#define CASE(name) case OPC_##name
+#define NEXT()     continue
+#define HANDLER(name, f_ptr, n_ops) case OPC_##name: BODY(f_ptr, n_ops)
+#define FORM(name, k0, k1, f_ptr)   case FORM_##name##_##k0##_##k1: CALL(f_ptr)
+#define FUSE(name, f_ptr)           case FUSE_##name: CALL(f_ptr)
+#endif
+
+#define LABEL(name, f_ptr, n_ops) [OPC_##name] = &&op_##name,
+#define FORM_LABEL(name, k0, k1, f_ptr) \
+	[FORM_##name##_##k0##_##k1] = &&form_##name##_##k0##_##k1,
+#define FUSE_LABEL(name, f_ptr) [FUSE_##name] = &&fuse_##name,
+
+/**
+ * @desc  : Executes the program from glob->ip until it ends, halts or
+ *          an instruction fails. Counts executed instructions in
+ *          glob->steps. A program not run yet gets its handlers,
+ *          unfused, from fuse_prog().
+ * @param : glob -
+ * @return: int  - 1 if the emulator halted due to an error, else 0.
+ */
+int exec_prog(glob_t *glob) {
+	prog_t *prog = glob->prog;
+	if (!prog->exec && fuse_prog(prog, 0) < 0) {
+		return 1;
+	}
+
+	instr_t *instrs = prog->instrs;
+	const int *exec = prog->exec;
+	const int n = prog->n;
+
+	unsigned long steps = 0;
+	instr_t *instr = NULL;
+	int ret = 1, op = OPC_NONE, ip = glob->ip;
+
+#ifdef EXEC_THREADED
+	static void *const labels[N_EXEC] = {
+		[OPC_NONE] = &&op_NONE,
+		INSTR_SET(LABEL)
+		[OPC_BAD]  = &&op_BAD,
+		[OPC_EXT ... OPC_EXT_LAST] = &&op_EXT,
+		FORM_SET(FORM_LABEL)
+		FUSE_SET(FUSE_LABEL)
+	};
+
+	NEXT();
+#else
+	for (;;) {
+		FETCH();
+
+		switch (op) {
+#endif
+
+	CASE(NONE):
+		NEXT();
+
+	INSTR_SET(HANDLER)
+	FORM_SET(FORM)
+	FUSE_SET(FUSE)
+
+#ifndef EXEC_THREADED
+		default:
+			if (op >= OPC_EXT && op <= OPC_EXT_LAST) {
+				goto op_EXT;
+			}
+#endif
+	CASE(BAD):
+		fprintf(stderr, "Invalid entry [%s]: reached end of the table.\n", instr->mnem);
+		ret = 0;
+		goto done;
+
+	/* Mnemonics bound by plugins, their handlers are only known at run time. */
+	op_EXT:
+		BODY(instr_set[op].f_ptr, instr_set[op].n_ops)
+
+#ifndef EXEC_THREADED
+		}
+	}
+#endif
+
+bad_ops:
+	fprintf(stderr, "exec_prog(): Invalid number of operands [%d] [%s].\n",
+		instr->n_op, instr->mnem);
+	ret = 0;
+
+done:
+	glob->ip = ip;
+	glob->steps += steps;
+	return !ret;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file: exec.h
+ * @desc: Declares the fast execution engine - runs an assembled program
+ *        without the debug, breakpoint and stream checks of main's loop.
+ */
+
+#ifndef _ASE_EXEC_H_
+#define _ASE_EXEC_H_
+
+#include "glob.h"
+
+/**
+ * Handlers are threaded with GCC's labels as values. Build with
+ * -DEXEC_SWITCH, or with a compiler without them, for a plain switch.
+ */
+#if defined(__GNUC__) && !defined(EXEC_SWITCH)
+#define EXEC_THREADED
+#endif
+
+int exec_prog (glob_t *glob);
+
+#endif
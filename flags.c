@@ -28,6 +28,7 @@ int cmc(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
+	flags_sync(glob->flags);
 	glob->flags->cf = !glob->flags->cf;
 	return 1;
 }
@@ -45,9 +46,10 @@ int clear_flag(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
-	const char *instr = glob->tokens[0];
+	const char *instr = glob->instr->mnem;
 	const char back   = instr[strlen(instr) - 1];
 
+	flags_sync(glob->flags);
 	switch (back) {
 	case 'C': glob->flags->cf  = 0; return 1;      /* CLC */
 	case 'D': glob->flags->df  = 0; return 1;      /* CLD */
@@ -74,6 +76,7 @@ int get_flag_val(glob_t *glob, char *flag) {
 		return -1;
 	}
 
+	flags_sync(glob->flags);
 	switch (*flag) {
 	case 'U': return glob->flags->af;
 	case 'E': return glob->flags->cf;
@@ -100,9 +103,10 @@ int set_flag(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
-	const char *instr = glob->tokens[0];
+	const char *instr = glob->instr->mnem;
 	const char back   = instr[strlen(instr) - 1];
 
+	flags_sync(glob->flags);
 	switch (back) {
 	case 'C': glob->flags->cf  = 1; return 1;      /* STC */
 	case 'D': glob->flags->df  = 1; return 1;      /* STD */
@@ -8,6 +8,7 @@
  *        d) STC
  *        e) STD
  *        f) STI
+ *        and the lazily computed arithmetic flags, see alu.c.
  */ 
 
 #ifndef _ASE_FLAGS_H_
@@ -15,6 +16,33 @@
 
 #include "glob.h"
 
+void flags_eval   (flags_t *flags);
+
+/* Makes the arithmetic flags current, call before reading any of them. */
+static inline void flags_sync(flags_t *flags) {
+	if (flags->lz_op != LZ_NONE) {
+		flags_eval(flags);
+	}
+}
+
+/**
+ * Leaves the arithmetic flags pending from an operation. All but INC and
+ * DEC set all six, so the one pending before is dropped without being
+ * computed. INC and DEC keep CF, so one pending from ADD, SUB or MUL is
+ * computed first.
+ */
+static inline void flags_defer(flags_t *flags, int op, int w, int dst, int src, int res) {
+	if ((op == LZ_INC || op == LZ_DEC) && flags->lz_op != LZ_NONE && flags->lz_op < LZ_INC) {
+		flags_eval(flags);
+	}
+
+	flags->lz_op  = op;
+	flags->lz_w   = w;
+	flags->lz_dst = dst;
+	flags->lz_src = src;
+	flags->lz_res = res;
+}
+
 int cmc          (glob_t *glob, char *buf, unsigned long size);
 int clear_flag   (glob_t *glob, char *buf, unsigned long size);
 int get_flag_val (glob_t *glob, char *flag);
@@ -0,0 +1,205 @@
+/**
+ * @file: fuse.c
+ * @desc: Defines the peephole pass that fuses frequent instruction pairs
+ *        into superinstructions, and the superinstructions themselves.
+ *        A superinstruction takes the place of its first instruction in
+ *        exec_prog() only; the second one is left where it is, for jumps
+ *        landing on it. Only prog->exec is written, never the
+ *        instructions, which may be a shared cache mapping.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bind.h"
+#include "flags.h"
+#include "fuse.h"
+#include "probe.h"
+
+/**
+ * @desc  : Tells if a conditional jump is taken, decided the way
+ *          jump_jx() and jump_jnx() decide it.
+ * @param : flags -
+ *          opc   - opcode of the jump.
+ * @return: int   - 1 if taken, else 0.
+ */
+static inline int jcc_taken(const flags_t *flags, int opc) {
+	switch (opc) {
+	case OPC_JC:  return flags->cf == 1;
+	case OPC_JNC: return flags->cf == 0;
+	case OPC_JE:  return flags->zf == 1;
+	case OPC_JNE: return flags->zf == 0;
+	case OPC_JP:  return flags->pf == 1;
+
+	/* jump_jx() goes by the last letter, so JPE tests ZF like JE. */
+	case OPC_JPE: return flags->zf == 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @desc  : Returns the superinstruction a pair fuses into.
+ * @param : a - first instruction.
+ *          b - instruction following a.
+ * @return: int - a fuse_t, 0 if the pair does not fuse.
+ */
+static int fuse_pair(const instr_t *a, const instr_t *b) {
+	int jcc = b->n_op == 1 && b->ops[0].kind == OP_LABEL;
+
+	switch (b->opc) {
+	case OPC_JC: case OPC_JNC: case OPC_JE:
+	case OPC_JNE: case OPC_JP: case OPC_JPE:
+		break;
+	default:
+		jcc = 0;
+	}
+
+	/* Operand counts are checked here, superinstructions skip that. */
+	if (a->opc == OPC_CMP && a->n_op == 2 && jcc) {
+		return FUSE_CMP_JCC;
+	}
+
+	if (a->opc == OPC_DEC && a->n_op == 1 && jcc && b->opc == OPC_JNE) {
+		return FUSE_DEC_JNE;
+	}
+
+	if (a->opc == OPC_MOV && a->n_op == 2 && b->opc == OPC_MOV && b->n_op == 2) {
+		return FUSE_MOV_MOV;
+	}
+
+	return 0;
+}
+
+/**
+ * @desc  : Makes the second instruction of a pair current and fires its
+ *          instr probe, as exec_prog() would have.
+ * @param : glob -
+ * @return: instr_t* - the second instruction.
+ */
+static inline instr_t *next_instr(glob_t *glob) {
+	instr_t *next = glob->instr + 1;
+
+	glob->c_line = next->line;
+	glob->n_op = next->n_op;
+	glob->instr = next;
+	glob->ip++;
+	glob->steps++;
+	PROBE_INSTR(next);
+
+	return next;
+}
+
+/**
+ * @desc  : Finishes a conditional jump whose condition is known.
+ * @param : glob  -
+ *          taken - condition of the jump.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+static inline int branch(glob_t *glob, int taken) {
+	if (!taken) {
+		return 1;
+	}
+
+	/* Jump - the target was resolved by the assembler. */
+	if (glob->instr->target < 0) {
+		fprintf(stderr, "jump(): Undefined label.\n");
+		return 0;
+	}
+
+	PROBE(jump, glob->c_line, glob->instr->opc, glob->instr->target);
+	glob->ip = glob->instr->target;
+	return 1;
+}
+
+/**
+ * @desc  : Implements CMP followed by JC/JNC/JE/JNE/JP/JPE.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int fuse_cmp_jcc(glob_t *glob, char *buf, unsigned long size) {
+	int ret = instr_set[glob->instr->form].f_ptr(glob, buf, size);
+	if (ret != 1) {
+		return ret;
+	}
+
+	instr_t *jcc = next_instr(glob);
+	flags_sync(glob->flags);
+	return branch(glob, jcc_taken(glob->flags, jcc->opc));
+}
+
+/**
+ * @desc  : Implements DEC followed by JNE, a countdown loop.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int fuse_dec_jne(glob_t *glob, char *buf, unsigned long size) {
+	int ret = unary(glob, buf, size);
+	if (ret != 1) {
+		return ret;
+	}
+
+	next_instr(glob);
+	flags_sync(glob->flags);
+	return branch(glob, glob->flags->zf == 0);
+}
+
+/**
+ * @desc  : Implements two MOVs in a row.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int fuse_mov_mov(glob_t *glob, char *buf, unsigned long size) {
+	int ret = instr_set[glob->instr->form].f_ptr(glob, buf, size);
+	if (ret != 1) {
+		return ret;
+	}
+
+	instr_t *next = next_instr(glob);
+	return instr_set[next->form].f_ptr(glob, buf, size);
+}
+
+/**
+ * @desc  : Builds prog->exec, fusing the pairs of prog that have a
+ *          superinstruction, each instruction is part of one pair at
+ *          most. The fusions of an earlier pass are undone, the program
+ *          may have been patched since.
+ * @param : prog -
+ *          on   - 0 leaves every instruction on its own handler.
+ * @return: int  - number of pairs fused, -1 if fail.
+ */
+int fuse_prog(prog_t *prog, int on) {
+	int fused = 0;
+	int *exec = realloc(prog->exec, (prog->n ? prog->n : 1) * sizeof(int));
+
+	if (!exec) {
+		fprintf(stderr, "fuse_prog(): realloc failure.\n");
+		free(prog->exec);
+		prog->exec = NULL;
+		return -1;
+	}
+
+	prog->exec = exec;
+	for (int i = 0; i < prog->n; i++) {
+		exec[i] = prog->instrs[i].form;
+	}
+
+	for (int i = 0; on && i + 1 < prog->n; i++) {
+		instr_t *a = &prog->instrs[i];
+		int f = fuse_pair(a, a + 1);
+
+		if (f) {
+			exec[i] = f;
+			fused++;
+			i++;
+		}
+	}
+
+	return fused;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file: fuse.h
+ * @desc: Declares the peephole pass that fuses frequent instruction
+ *        pairs of an assembled program into superinstructions, and the
+ *        superinstructions themselves.
+ */
+
+#ifndef _ASE_FUSE_H_
+#define _ASE_FUSE_H_
+
+#include "glob.h"
+#include "tengine.h"
+
+/**
+ * Superinstructions - X(name, handler). Only exec_prog() runs them, the
+ * slow path and call_instr() still go one instruction at a time.
+ */
+#define FUSE_SET(X)                    \
+	X(CMP_JCC, fuse_cmp_jcc)           \
+	X(DEC_JNE, fuse_dec_jne)           \
+	X(MOV_MOV, fuse_mov_mov)
+
+#define FUSE_ENUM(name, f_ptr) FUSE_##name,
+
+/* Numbered on from the specialised handlers. */
+typedef enum fuse {
+	FUSE_FIRST = N_FORM - 1,
+	FUSE_SET(FUSE_ENUM)
+	N_EXEC
+} fuse_t;
+
+int fuse_cmp_jcc (glob_t *glob, char *buf, unsigned long size);
+int fuse_dec_jne (glob_t *glob, char *buf, unsigned long size);
+int fuse_mov_mov (glob_t *glob, char *buf, unsigned long size);
+int fuse_prog    (prog_t *prog, int on);
+
+#endif
@@ -10,63 +10,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "flags.h"
 #include "glob.h"
 #include "parse.h"
+#include "probe.h"
 
-/**
- * @desc  : Allows user to move data to specified mem addr.
- * @param : glob   -
- *          seg    - segment address.
- *          offset - offset address.
- *          PA     - (seg * 10) + offset
- * @return: mem_nodes_t
- */
-mem_nodes_t* add_to_mem(glob_t *glob, int seg, int offset) {
-	if (!glob) {
-		fprintf(stderr, "add_to_mem(): glob - null ptr.\n");
-		return NULL;
-	}
-
-	mem_nodes_t *node = malloc(sizeof(mem_nodes_t));
-	if (!node) {
-		fprintf(stderr, "add_to_mem(): malloc failure.\n");
-		return NULL;
-	}
+const uint8_t zero_page[PAGE_SZ];
 
-	if ((!glob->mem->ds || !glob->mem->es) && !glob->mem->warned && !getenv("DIW")) {
-		fprintf(stderr, "add_to_mem(): Did not init [D/E]S?\n");
-		glob->mem->warned = 1;
-	}
-
-	node->next = NULL;
-	node->seg  = seg;
-	node->offset = offset;
-
-	node->addr = (seg * 10) + offset;
-	if (!glob->mem->head) {
-		glob->mem->head = node;
-		return node;
-	}
-
-	mem_nodes_t *curr = glob->mem->head, *prev = NULL;
-	while (curr) {
-		if (node->addr >= curr->addr) {
-			prev = curr;
-			curr = curr->next;
-		}
+#ifdef PROBE_ON
+#define PROBE_SEM_DEF(name) \
+	unsigned short PROBE_SEM(name) __attribute__((unused, section(".probes")));
 
-		node->next = curr;
-		/* Appending to the beginning of the list? */
-		if (!prev) {
-			glob->mem->head = node;
-			return node;
-		}
+PROBE_SET(PROBE_SEM_DEF)
+#endif
 
-		prev->next = node;
-		return node;
+/* Frees the pages of mem, every page reads as zero_page again. */
+static void mem_unmap(mem_t *mem) {
+	for (int pn = 0; pn < N_PAGES; pn++) {
+		free(mem->pages[pn]);
+		mem->pages[pn] = NULL;
 	}
 
-	return NULL;
+	mem->tlb_pn = N_PAGES;
+	mem->tlb = zero_page;
 }
 
 /**
@@ -82,220 +48,87 @@ void destroy_glob(glob_t *glob) {
 
 	fclose(glob->fd);
 
-	mem_nodes_t *node = glob->mem->head;
-	while (node) {
-		mem_nodes_t *temp = node;
-		node = node->next;
-		free(temp);
-	}
-
+	mem_unmap(glob->mem);
 	free(glob->mem);
 	free(glob->flags);
-
-	int sz = glob->stack->top;
-	while (sz >= 0) {
-		free(glob->stack->arr[sz--]);
-	}
-
 	free(glob->stack);
 	free(glob->registers);
 	free(glob);
 }
 
 /**
- * @desc  : Returns the memory value pointed by addr.
- * @param : glob -
- *          addr - address of the value.
- *          buf  - buffer that receives the data.
- *          size - size of the buffer.
- * @return: int  - 0 if fail, 1 if success.
- */ 
-mem_nodes_t* get_mem_node(glob_t *glob, int addr) {
-	if (!glob) {
-		fprintf(stderr, "get_mem_node(): glob - nullptr.\n");
-		return 0;
-	}
-
-	mem_nodes_t *node = glob->mem->head;
-	while (node) {
-		int pa = (node->seg * 10) + node->offset;
-		if (pa == addr) {
-			return node;
-		}
-
-		node = node->next;
-	}
-
-	return NULL;
-}
-
-/**
- * @desc  : Returns the ptr to the specified operand.
+ * @desc  : Returns the ptr to the specified operand, its value is
+ *          OP_WIDTH(op) bits wide (see read_val()).
  * @param : glob  -
  *          op    - operand
- * @return: char* - a pointer to the operand, or NULL.
+ * @return: void* - a pointer to the operand, or NULL for literals and
+ *                  memory, which is reached through mem_read().
  */
-char *get_op_ptr(glob_t *glob, char *op) {
-	if (is_op_reg(op)) {
-		return get_reg_ptr(glob, op);
-	}
-
-	char addr[BUF_SZ] = {0};
-	memcpy(addr, &op[1], strlen(op) - 2);
+void *get_op_ptr(glob_t *glob, operand_t *op) {
+	registers_t *regs = glob->registers;
 
-	if (!is_valid_addr(addr)) {
-		/* User probably supplied a literal */
-		return NULL;
+	switch (op->kind) {
+	case OP_REG:
+		if (op->width == 8) {
+			return &regs->b[REG_BYTE(op->reg, op->hi)];
+		}
+		return &regs->x[op->reg];
 	}
 
-	return get_mem_node(glob, (int) strtol(addr, NULL, 0))->val;
+	/* User probably supplied a literal */
+	return NULL;
 }
 
 /**
- * @desc  : Gets the specified operand's value.
+ * @desc  : Gets the specified operand's value, unsigned and as wide as
+ *          the operand.
  * @param : glob -
  *          op   - operand
- *          buf  - buffer that receives the value.
- *          size - size of the buffer.
+ *          val  - receives the value.
  * @return: int  - 0 if fail, 1 if success.
  */ 
-int get_op_val(glob_t *glob, char *op, char *buf, unsigned long size) {
+int get_op_val(glob_t *glob, operand_t *op, int *val) {
 	if (!glob) {
 		fprintf(stderr, "get_op_val(): glob - nullptr.\n");
 		return 0;
 	}
 
-	/**
-	 * In some occasions, we set size to -1. This is a hack, to indicate
-	 * that value of op must be copied to buf as it is, without any mod-
-	 * -ifications.
-	 * 	Eg: popping from stack (No conversions, direct copy)
-	 * 
-	 * In such cases, we acknowledge the request, and set the size back
-	 * to BUF_SZ.
-	 */
-	if (size == -1) {
-		/* ab_lit - absolute hex literal (no modifications) */
-		goto ab_lit;
-	}
-
-	if (is_op_addr(op)) {
-		char addr[BUF_SZ];
-		memset(addr, 0, sizeof(addr));
-		memcpy(addr, &op[1], strlen(op) - 2);
-
-		mem_nodes_t *node = get_mem_node(glob, (int)strtol(addr, NULL, 0));
-		if (node) {
-			memcpy(buf, node->val, BUF_SZ);
-			return 1;
-		}
-
-		return 0;
-	}
-
-	if (is_op_reg(op)) {
-		char *ptr = get_reg_ptr(glob, op);
-		memcpy(buf, ptr, size);
+	if (op->kind == OP_IMM) {
+		*val = op->val & 0xffff;
 		return 1;
 	}
 
-	ab_lit: ;
-	/* Operand is a literal */
-	char *lchar = &op[strlen(op) - 1];
-	if (*lchar == 'H' || *lchar == 'h' || size == -1) {
-		if (size != -1) {
-			*lchar = '\0';
-		} else {
-			size = (unsigned long)BUF_SZ;
-		}
-
-		/* Validate hex */
-		if (!is_valid_hex(op)) {
-			fprintf(stderr, "get_op_val(): Invalid hex literal.\n");
-			return 0;
-		}
-
-		memcpy(buf, op, size);
+	if (op->kind == OP_MEM) {
+		*val = mem_read(glob->mem, OP_PA(glob, op), OP_WIDTH(op));
 		return 1;
-	} else {
-		/* Need to convert the literal to hex */
-		const int ksz = strlen(op);
-		for (int i = 0; i < ksz; i++) {
-			if (!isdigit(op[i]) && op[i] != '-') {
-				fprintf(stderr, "get_op_val(): Invalid str literal [%s].\n", op);
-				return 0;
-			}
-		}
-
-		char temp[BUF_SZ];
-		memset(temp, 0, sizeof(temp));
-		int val = (int)strtol(op, NULL, 0);
-
-
-		/* Set flag values */
-		glob->flags->pf = __builtin_popcount(val) % 2 == 0 && val != 0;
-		glob->flags->zf = val == 0;
-
-		/* Check for overflow */
-		if (val > 32767 || val < -32768) {
-			fprintf(stderr, "get_op_val(): Operand value too large [%s].\n", op);
-			glob->flags->of = 1;
-			return 1;
-		}
-
-		sprintf(temp, "%x", val);
-		char *beg = temp;
+	}
 
-		if (strlen(temp) > 4) {
-			beg = &temp[strlen(temp) - 1];
-			beg -= 3;
-		}
-		
-		memcpy(buf, beg, BUF_SZ);
-		return 1;
+	void *ptr = get_op_ptr(glob, op);
+	if (!ptr) {
+		return 0;
 	}
 
-	return 0;
+	*val = read_val(ptr, OP_WIDTH(op));
+	return 1;
 }
 
 /**
- * @desc  : Returns the pointer to the specified register.
+ * @desc  : Returns the pointer to the specified 16 bit register.
  * @param : glob -
- *          reg  - register's pointer that is required.
- * @return: char*
+ *          reg  - register id, R_AX .. R_SS.
+ * @return: uint16_t*
  */ 
-char *get_reg_ptr(glob_t *glob, char *reg) {
-	if (!glob || !reg) {
+uint16_t *get_reg_ptr(glob_t *glob, int reg) {
+	if (!glob) {
 		fprintf(stderr, "get_reg_ptr(): nullptr received.\n");
 		return NULL;
 	}
 
-	char *ptr  = NULL;
-
-	/* Convert 8 bit register to 16 bit. */
-	char *back = &reg[strlen(reg) - 1];
-	if (*back == 'H' || *back == 'L') {
-		*back = 'X';
-	} else if (*back != 'X') {
-		/* back - neither H, L nor X. */
+	if (reg < 0 || reg >= N_REG) {
 		return NULL;
 	}
 
-	int diff = abs(strcmp(reg, REG_AX));
-	switch (diff) {
-	case 0: ptr = glob->registers->ax; break;
-	case 1: ptr = glob->registers->bx; break;
-	case 2: ptr = glob->registers->cx; break;
-	case 3: ptr = glob->registers->dx; break;
-
-	default: return NULL;
-	}
-
-	if (!ptr) {
-		ptr = malloc(BUF_SZ);
-	}
-
-	return ptr;
+	return &glob->registers->x[reg];
 }
 
 /**
@@ -314,7 +147,7 @@ glob_t *init_glob(FILE *fd) {
 		return NULL;
 	}
 	
-	glob->mem = malloc(sizeof(mem_t));
+	glob->mem = calloc(1, sizeof(mem_t));
 	glob->flags = malloc(sizeof(flags_t));
 	glob->stack = malloc(sizeof(stack_t));
 	glob->registers = malloc(sizeof(registers_t));
@@ -325,19 +158,23 @@ glob_t *init_glob(FILE *fd) {
 	assert(glob->registers);
 
 	glob->fd = fd;
-	glob->idx = 0;
 	glob->bpnt = glob->stack->top = -1;
-	glob->c_line = glob->p_len = 0;
+	glob->c_line = glob->ip = glob->jobs = glob->debug = 0;
+	glob->steps = 0;
+	glob->instr = NULL;
+	glob->prog = NULL;
 
-	glob->mem->si = glob->mem->di = glob->mem->ds = glob->mem->es = 0;
+	mem_unmap(glob->mem);
 	memset(glob->flags, 0, sizeof(flags_t));
+	memset(glob->registers, 0, sizeof(registers_t));
 	memset(glob->flags->f_ch, 0, sizeof(glob->flags->f_ch));
 
 	return glob;
 }
 
 /**
- * @desc  : Implements the LAHF instruction.
+ * @desc  : Implements the LAHF instruction - AH is SF ZF 0 AF 0 PF 1 CF,
+ *          from bit 7 down.
  * @param : glob -
  *          buf  - unused
  *          size - unused
@@ -350,16 +187,59 @@ int lahf(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	assert(glob->n_op == 0);
-	sprintf(glob->registers->ax, "%d%d%d%d%d",
-		glob->flags->sf,
-		glob->flags->zf,
-		glob->flags->af,
-		glob->flags->pf,
-		glob->flags->cf);
+	const flags_t *f = glob->flags;
+	flags_sync(glob->flags);
+	glob->registers->b[REG_BYTE(R_AX, 1)] =
+		f->sf << 7 | f->zf << 6 | f->af << 4 | f->pf << 2 | 1 << 1 | f->cf;
 
 	return 1;
 }
 
+/**
+ * @desc  : Returns the page number pn to write to, allocating it zeroed
+ *          on its first write, and makes it the page in the TLB.
+ * @param : mem -
+ *          pn  - page number, below N_PAGES.
+ * @return: uint8_t* - the page, NULL if it could not be allocated.
+ */
+uint8_t *mem_map(mem_t *mem, uint32_t pn) {
+	uint8_t *page = mem->pages[pn];
+
+	if (!page) {
+		page = calloc(1, PAGE_SZ);
+		if (!page) {
+			fprintf(stderr, "mem_map(): malloc failure.\n");
+			return NULL;
+		}
+		mem->pages[pn] = page;
+	}
+
+	mem->tlb_pn = pn;
+	mem->tlb = page;
+	return page;
+}
+
+/**
+ * @desc  : Writes a byte or a word to the memory operand op, at
+ *          seg:offset.
+ * @param : glob -
+ *          op   - memory operand.
+ *          val  - value to write, cut to OP_WIDTH(op) bits.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int mem_store(glob_t *glob, operand_t *op, int val) {
+	const uint16_t *regs = glob->registers->x;
+	if ((!regs[R_DS] || !regs[R_ES]) && !glob->mem->warned && !getenv("DIW")) {
+		fprintf(stderr, "mem_store(): Did not init [D/E]S?\n");
+		glob->mem->warned = 1;
+	}
+
+	uint16_t off = ea_offset(glob, op);
+	uint32_t pa = MEM_PA(regs[op->reg], off);
+	PROBE(mem, glob->c_line, glob->instr ? glob->instr->opc : 0, regs[op->reg], off, pa);
+	return mem_write(glob->mem, pa, OP_WIDTH(op), val);
+}
+
 /**
  * @desc  : Implements the ORG instruction.
  * @param : glob -
@@ -374,21 +254,53 @@ int org(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	/* There is nothing to do with ORG's operand. Retained for compatibility. */
-	char *op = glob->tokens[1];
-	int max = strlen(op);
-
-	if (op[max - 1] != 'h' && op[max - 1] != 'H') {
-		fprintf(stderr, "org(): Required hex suffix.\n");
+	if (glob->instr->ops[0].kind != OP_IMM) {
+		fprintf(stderr, "org(): Invalid address.\n");
 		return 0;
 	}
 
-	op[max - 1] = '\0';
-	if (!is_valid_hex(op)) {
-		fprintf(stderr, "org(): Invalid address [%s].\n", op);
+	return 1;
+}
+
+/**
+ * @desc  : Stores the result of an operation. Results that do not fit
+ *          the signed range of the destination are not stored.
+ * @param : glob  -
+ *          val   - result to store.
+ *          op    - destination operand.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+int put_op_val(glob_t *glob, int val, operand_t *op) {
+	if (!glob || !op) {
+		fprintf(stderr, "put_op_val(): nullptr received.\n");
 		return 0;
 	}
 
-	return 1;
+	/* Check for overflow, OF is left to the operation. */
+	int max = OP_WIDTH(op) == 8 ? 127 : 32767;
+	if (val > max || val < -max - 1) {
+		fprintf(stderr, "put_op_val(): Operand value too large [%d].\n", val);
+		return 1;
+	}
+
+	return set_op_val(glob, op, val);
+}
+
+/**
+ * @desc  : Clears registers, flags, memory and stack, as if the
+ *          emulator had just started. Settings and the program are kept.
+ * @param : glob -
+ * @return: void
+ */
+void reset_glob(glob_t *glob) {
+	glob->stack->top = -1;
+	mem_unmap(glob->mem);
+	memset(glob->flags, 0, sizeof(flags_t));
+	memset(glob->registers, 0, sizeof(registers_t));
+
+	glob->c_line = glob->ip = 0;
+	glob->steps = 0;
+	glob->instr = NULL;
 }
 
 /**
@@ -405,11 +317,35 @@ int sahf(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	assert(glob->n_op == 0);
-	glob->flags->sf = glob->registers->ax[0] == '1';
-	glob->flags->zf = glob->registers->ax[1] == '1';
-	glob->flags->af = glob->registers->ax[2] == '1';
-	glob->flags->pf = glob->registers->ax[3] == '1';
-	glob->flags->cf = glob->registers->ax[4] == '1';
+	int ah = glob->registers->b[REG_BYTE(R_AX, 1)];
+	flags_sync(glob->flags);
+	glob->flags->sf = ah >> 7 & 1;
+	glob->flags->zf = ah >> 6 & 1;
+	glob->flags->af = ah >> 4 & 1;
+	glob->flags->pf = ah >> 2 & 1;
+	glob->flags->cf = ah & 1;
 
 	return 1;
-}
\ No newline at end of file
+}
+
+/**
+ * @desc  : Writes val to a register or memory operand, cut to the width
+ *          of the operand.
+ * @param : glob -
+ *          op   - destination operand.
+ *          val  - value to write.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int set_op_val(glob_t *glob, operand_t *op, int val) {
+	switch (op->kind) {
+	case OP_REG:
+		write_val(get_op_ptr(glob, op), op->width, val);
+		return 1;
+
+	case OP_MEM:
+		return mem_store(glob, op, val);
+	}
+
+	fprintf(stderr, "set_op_val(): Invalid destination operand.\n");
+	return 0;
+}
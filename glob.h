@@ -7,6 +7,7 @@
 #ifndef _ASE_GLOB_H_
 #define _ASE_GLOB_H_
 
+#include <stdint.h>
 #include <stdio.h>
 
 #define BUF_SZ 128
@@ -26,6 +27,71 @@
 #define REG_CX "CX"
 #define REG_DX "DX"
 
+/**
+ * The register file - X(name). AX .. DX also name their bytes, AL and
+ * AH are the low and high byte of AX and so on. IP is not in it, the
+ * instruction pointer is glob->ip.
+ */
+#define REG_SET(X)                     \
+	X(AX) X(BX) X(CX) X(DX)            \
+	X(SI) X(DI) X(BP) X(SP)            \
+	X(CS) X(DS) X(ES) X(SS)
+
+#define REG_ENUM(name) R_##name,
+
+/* Register ids, in the order of registers_t. */
+enum {
+	REG_SET(REG_ENUM)
+	N_REG
+};
+
+/* Index into registers_t.b of the low byte of reg, or the high one if hi is set. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REG_BYTE(reg, hi) (2 * (reg) + !(hi))
+#else
+#define REG_BYTE(reg, hi) (2 * (reg) + !!(hi))
+#endif
+
+/**
+ * Effective address forms of memory operands - X(name, r1, r2). The
+ * offset is r1 + r2 + displacement in 16 bits, -1 stands for no
+ * register. DISP is a displacement alone, [1234]. Each form comes with
+ * no displacement, a byte or a word of it - the 24 of the 8086, which
+ * only differ in how long their encoding is.
+ */
+#define EA_SET(X)                  \
+	X(DISP,  -1,   -1)             \
+	X(BX_SI, R_BX, R_SI)           \
+	X(BX_DI, R_BX, R_DI)           \
+	X(BP_SI, R_BP, R_SI)           \
+	X(BP_DI, R_BP, R_DI)           \
+	X(SI,    R_SI, -1)             \
+	X(DI,    R_DI, -1)             \
+	X(BP,    R_BP, -1)             \
+	X(BX,    R_BX, -1)
+
+#define EA_ENUM(name, r1, r2) EA_##name,
+
+enum {
+	EA_SET(EA_ENUM)
+	N_EA
+};
+
+/* Operand kinds. */
+#define OP_NONE  0
+#define OP_REG   1
+#define OP_IMM   2
+#define OP_MEM   3
+#define OP_LABEL 4
+
+/* Operations the arithmetic flags are left pending from, see flags_t. */
+#define LZ_NONE 0
+#define LZ_ADD  1
+#define LZ_SUB  2
+#define LZ_MUL  3
+#define LZ_INC  4
+#define LZ_DEC  5
+
 typedef struct flags {
 	/**
 	 * Indicates if a flag has changed.
@@ -35,57 +101,167 @@ typedef struct flags {
 	 */
 	int f_ch[8];
 	int af, cf, df, iif, of, pf, sf, zf;
+
+	/**
+	 * Last operation to set the arithmetic flags. AF, CF, OF, PF, SF
+	 * and ZF above are stale until flags_sync() computes them from it.
+	 * lz_op  - LZ_NONE if they are current, else LZ_ADD .. LZ_DEC.
+	 * lz_w   - width of the operation, 8 or 16.
+	 * lz_dst - destination value, signed.
+	 * lz_src - source value, signed.
+	 * lz_res - result, before it is cut to lz_w bits.
+	 */
+	int lz_op, lz_w, lz_dst, lz_src, lz_res;
 } flags_t;
 
-typedef struct mem_nodes {
-	char val[BUF_SZ];
-	int seg, offset, addr;
-	struct mem_nodes *next;
-} mem_nodes_t;
+/* Size of the address space, addresses past it wrap around to 0. */
+#define MEM_SZ   (1 << 20)
+#define MEM_MASK (MEM_SZ - 1)
+
+/* Physical address of seg:off, 20 bits as on the 8086. */
+#define MEM_PA(seg, off) ((((uint32_t)(uint16_t)(seg) << 4) + (uint16_t)(off)) & MEM_MASK)
+
+/* Memory is allocated in pages of PAGE_SZ bytes, see mem_t. */
+#define PAGE_SHIFT 12
+#define PAGE_SZ    (1 << PAGE_SHIFT)
+#define PAGE_MASK  (PAGE_SZ - 1)
+#define N_PAGES    (MEM_SZ >> PAGE_SHIFT)
 
 typedef struct mem {
-	int si, di;
-	int ds, es, warned;
-	mem_nodes_t *head;
+	/**
+	 * warned - Set once the uninitialised DS/ES warning was given.
+	 * tlb_pn - Number of the page accessed last, N_PAGES if none.
+	 * tlb    - That page, zero_page if it has not been written.
+	 * pages  - Page table of the MEM_SZ bytes of memory. A page is
+	 *          allocated zeroed on its first write and NULL until then,
+	 *          reads of it see zero_page. Words are little endian, see
+	 *          mem_read().
+	 */
+	int warned;
+	uint32_t tlb_pn;
+	const uint8_t *tlb;
+	uint8_t *pages[N_PAGES];
 } mem_t;
 
+/* Words the stack holds at most, a segment of 64 KiB. */
+#define STACK_MAX (1 << 15)
+
 typedef struct stack {
+	/**
+	 * Index of the word at SS:SP, -1 if the stack is empty. The words
+	 * are in memory, from SS:SP up, see push().
+	 */
 	int top;
-	char *arr[BUF_SZ];
 } stack_t;
 
 typedef struct registers {
-	char ax[BUF_SZ], bx[BUF_SZ],
-         cx[BUF_SZ], dx[BUF_SZ];
+	/**
+	 * x - 16 bit registers, indexed by register id.
+	 * b - The same bytes, AL .. DH of register reg are b[REG_BYTE(reg, hi)].
+	 */
+	union {
+		uint16_t x[N_REG];
+		uint8_t  b[2 * N_REG];
+	};
 } registers_t;
 
-typedef struct glob {
-	int idx;
-	struct label_loc {
-		int line;
-		char label[BUF_SZ];
-	} label_locs[256];
+/* View into the source text - not NUL terminated. */
+typedef struct tok {
+	const char *ptr;
+	int len;
+} tok_t;
 
-	int debug;
-	int bpnt, n_op;
-	FILE *fd;
+/* Operand decoded once by the assembler. */
+typedef struct operand {
+	/**
+	 * kind  - OP_NONE, OP_REG, OP_IMM, OP_MEM or OP_LABEL.
+	 * reg   - OP_REG: register id, R_AX .. R_SS.
+	 *         OP_MEM: segment register, R_CS .. R_SS.
+	 * width - OP_REG: 8 or 16.
+	 *         OP_MEM: 8 or 16, the width of the register operand of the
+	 *         instruction or of a BYTE/WORD prefix, 0 if neither (16).
+	 * hi    - OP_REG: set for the upper 8 bit register (AH .. DH).
+	 * val   - OP_IMM: literal value, OP_MEM: displacement.
+	 * dec   - OP_IMM: set for decimal literals.
+	 * ea    - OP_MEM: effective address form, EA_DISP .. EA_BX.
+	 */
+	int kind, reg, width, hi, val, dec, ea;
+} operand_t;
 
+typedef struct instr {
 	/**
-	 * label    - Did user specify any label for the present line?
-	 * to_label - Label to jump - filled when from_reg jump instr is specified.
-	 * tokens   - [instr] [op1] [op2]
+	 * line   - Source line the instruction was assembled from.
+	 * n_op   - Number of operands.
+	 * target - Instruction index a jump resolves to, -1 if none.
+	 * opc    - Opcode (opc_t) the mnemonic resolved to.
+	 * form   - Handler to run - a form_t specialised on the operand
+	 *          kinds, else opc (see find_form()).
+	 * mnem   - Upper case mnemonic.
+	 * ops    - Decoded [op1] [op2].
+	 *
+	 * Holds no pointers, so an assembled program can be written out and
+	 * mapped back in as it is (see cache.c).
 	 */
-	char tokens[3][BUF_SZ];
-	char label[BUF_SZ], to_label[BUF_SZ];
+	int line, n_op, target, opc, form;
+	char mnem[8];
+	operand_t ops[2];
+} instr_t;
 
+typedef struct prog {
 	/**
-	 * c_line - Current source line number.
-	 * c_len  - Current source line length.
-	 * p_len  - Previous source line length.
+	 * n      - Number of assembled instructions.
+	 * cap    - Capacity of instrs.
+	 * instrs - Instruction array, indexed by glob->ip.
+	 * labels - Declared labels.
+	 *
+	 * n_lines  - Number of source lines.
+	 * l_cap    - Capacity of lines.
+	 * lines    - Line map, offset of every source line into text.
+	 * text     - Source text.
+	 * text_len - Length of the source text.
 	 *
-	 * Previous line offset = -1 * (c_len + p_len)
+	 * map, map_len - Cache mapping that instrs and lines point into,
+	 *                NULL if the program was assembled from text.
+	 *
+	 * exec   - Handler exec_prog() runs for each instruction - its form,
+	 *          or a fuse_t superinstruction starting there (see
+	 *          fuse_prog()). Kept apart from instrs, so a mapped cache is
+	 *          never written, NULL until the first run.
 	 */
-	int c_line, c_len, p_len;
+	int n, cap;
+	instr_t *instrs;
+	struct symtab *labels;
+
+	int n_lines, l_cap;
+	unsigned int *lines;
+	const char *text;
+	unsigned long text_len;
+
+	void *map;
+	unsigned long map_len;
+
+	int *exec;
+} prog_t;
+
+typedef struct glob {
+	int debug;
+	/* Threads used by assemble(), 0 picks one per core for big sources. */
+	int jobs;
+	int bpnt, n_op;
+	FILE *fd;
+
+	/**
+	 * c_line - Current source line number.
+	 * ip     - Index of the next instruction to execute.
+	 * steps  - Number of instructions executed.
+	 * instr  - Instruction being executed.
+	 * parsed - Holds the line tokenised by parse_line().
+	 * prog   - Assembled source program.
+	 */
+	int c_line, ip;
+	unsigned long steps;
+	instr_t *instr, parsed;
+	prog_t *prog;
 
 	mem_t *mem;
 	flags_t *flags;
@@ -93,15 +269,128 @@ typedef struct glob {
 	registers_t *registers;
 } glob_t;
 
-mem_nodes_t *add_to_mem   (glob_t *glob, int seg, int offset);
-void         destroy_glob (glob_t *glob);
-mem_nodes_t *get_mem_node (glob_t *glob, int addr);
-char        *get_op_ptr   (glob_t *glob, char *op);
-int          get_op_val   (glob_t *glob, char *op, char *buf, unsigned long size);
-char        *get_reg_ptr  (glob_t *glob, char *reg);
-glob_t      *init_glob    (FILE   *fd);
-int          lahf         (glob_t *glob, char *buf, unsigned long size);
-int          org          (glob_t *glob, char *buf, unsigned long size);
-int          sahf         (glob_t *glob, char *buf, unsigned long size);
+/* Width in bits of the value of an operand, literals and memory operands of no width are 16 bit. */
+#define OP_WIDTH(op) ((op)->width == 8 ? 8 : 16)
+
+/* A value of the given width as a signed number. */
+#define VAL_SIGNED(val, width) ((width) == 8 ? (int8_t)(val) : (int16_t)(val))
+
+/* Value at a register or its byte of the given width, see get_op_ptr(). */
+static inline int read_val(const void *ptr, int width) {
+	return width == 8 ? *(const uint8_t *)ptr : *(const uint16_t *)ptr;
+}
+
+static inline void write_val(void *ptr, int width, int val) {
+	if (width == 8) {
+		*(uint8_t *)ptr = (uint8_t)val;
+	} else {
+		*(uint16_t *)ptr = (uint16_t)val;
+	}
+}
+
+/* Page every page not written yet reads as. */
+extern const uint8_t zero_page[PAGE_SZ];
+
+uint8_t *mem_map(mem_t *mem, uint32_t pn);
+
+/* Page number pn to read from, through the TLB. */
+static inline const uint8_t *mem_page(mem_t *mem, uint32_t pn) {
+	if (pn != mem->tlb_pn) {
+		mem->tlb_pn = pn;
+		mem->tlb = mem->pages[pn] ? mem->pages[pn] : zero_page;
+	}
+	return mem->tlb;
+}
+
+/* Page number pn to write to, NULL if it could not be allocated. */
+static inline uint8_t *mem_page_w(mem_t *mem, uint32_t pn) {
+	if (pn == mem->tlb_pn && mem->tlb != zero_page) {
+		return (uint8_t *)mem->tlb;
+	}
+	return mem_map(mem, pn);
+}
+
+/**
+ * Byte or little endian word at physical address pa. The byte after
+ * the last one is the first, a word at MEM_MASK wraps around.
+ */
+static inline int mem_read(mem_t *mem, uint32_t pa, int width) {
+	pa &= MEM_MASK;
+	const uint8_t *page = mem_page(mem, pa >> PAGE_SHIFT);
+	int off = pa & PAGE_MASK;
+
+	if (width == 8) {
+		return page[off];
+	}
+	if (off != PAGE_MASK) {
+		return page[off] | page[off + 1] << 8;
+	}
+
+	/* The word straddles two pages. */
+	int lo = page[off];
+	return lo | mem_page(mem, ((pa + 1) & MEM_MASK) >> PAGE_SHIFT)[0] << 8;
+}
+
+static inline int mem_write(mem_t *mem, uint32_t pa, int width, int val) {
+	pa &= MEM_MASK;
+	uint8_t *page = mem_page_w(mem, pa >> PAGE_SHIFT);
+	int off = pa & PAGE_MASK;
+
+	if (!page) {
+		return 0;
+	}
+
+	page[off] = (uint8_t)val;
+	if (width == 8) {
+		return 1;
+	}
+	if (off != PAGE_MASK) {
+		page[off + 1] = (uint8_t)(val >> 8);
+		return 1;
+	}
+
+	page = mem_page_w(mem, ((pa + 1) & MEM_MASK) >> PAGE_SHIFT);
+	if (!page) {
+		return 0;
+	}
+
+	page[0] = (uint8_t)(val >> 8);
+	return 1;
+}
+
+/* Register r of the effective address form, 0 if there is none. */
+#define EA_REG(x, r) ((r) < 0 ? 0 : (x)[(r) < 0 ? 0 : (r)])
+
+#define EA_CASE(name, r1, r2) \
+	case EA_##name: return (uint16_t)(EA_REG(x, r1) + EA_REG(x, r2) + op->val);
+
+/* Offset of a memory operand in its segment, a couple of adds per form. */
+static inline uint16_t ea_offset(const glob_t *glob, const operand_t *op) {
+	const uint16_t *x = glob->registers->x;
+
+	switch (op->ea) {
+	EA_SET(EA_CASE)
+	}
+	return (uint16_t)op->val;
+}
+
+/* Physical address of a memory operand, seg:offset. */
+#define OP_PA(glob, op) MEM_PA((glob)->registers->x[(op)->reg], ea_offset(glob, op))
+
+/* Physical address of the word n words above the top of the stack, SS:SP + 2n. */
+#define STACK_PA(glob, n) MEM_PA((glob)->registers->x[R_SS], (glob)->registers->x[R_SP] + 2 * (n))
+
+void      destroy_glob (glob_t *glob);
+void     *get_op_ptr   (glob_t *glob, operand_t *op);
+int       get_op_val   (glob_t *glob, operand_t *op, int *val);
+uint16_t *get_reg_ptr  (glob_t *glob, int reg);
+glob_t   *init_glob    (FILE   *fd);
+int       lahf         (glob_t *glob, char *buf, unsigned long size);
+int       mem_store    (glob_t *glob, operand_t *op, int val);
+int       org          (glob_t *glob, char *buf, unsigned long size);
+int       put_op_val   (glob_t *glob, int val, operand_t *op);
+void      reset_glob   (glob_t *glob);
+int       sahf         (glob_t *glob, char *buf, unsigned long size);
+int       set_op_val   (glob_t *glob, operand_t *op, int val);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,800 @@
+/**
+ * @file: jit.c
+ * @desc: Defines the tier that translates hot basic blocks into x86-64
+ *        code. A block starts where control lands - the first instruction
+ *        run, a jump target or the one after a jump - and ends at the next
+ *        jump. Blocks are interpreted until they were entered JIT_HOT
+ *        times, then translated into an mmap'd buffer, which is writable
+ *        while code is emitted and executable otherwise.
+ *
+ *        Inside a block glob stays in rbx, glob->flags in r12, the
+ *        register file in r14 and the step count in r13. AX .. DX live in
+ *        r8w .. r11w and are written back to the register file around
+ *        every call out of the block (see emit_spill()).
+ *
+ *        MOV, ADD, SUB, CMP, INC and DEC on those registers and literals
+ *        are emitted inline. They leave the flags pending as alu() does.
+ *        A conditional jump right after one of them takes the flags from
+ *        the host instead of calling flags_sync(). Every other
+ *        instruction calls its handler from bind.c, so memory, the stack
+ *        and the other registers go through the same code as in
+ *        exec_prog(). A jump goes straight to the code of its target once
+ *        that is translated, so a hot loop never returns to the
+ *        dispatcher.
+ *
+ *        Probes are fired by calls out of the block, made only while a
+ *        tracer is attached (see PROBE_SEM()).
+ */
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bind.h"
+#include "exec.h"
+#include "flags.h"
+#include "jit.h"
+#include "probe.h"
+
+#ifdef JIT_NATIVE
+
+#include <sys/mman.h>
+
+/* Appends the bytes given to the code buffer. */
+#define EMIT(jit, ...)                                       \
+	emit((jit), (const unsigned char[]){__VA_ARGS__},        \
+		sizeof((const unsigned char[]){__VA_ARGS__}))
+
+/* Offsets of the fields the code reads and writes. */
+#define GLOB(field) ((int)offsetof(glob_t, field))
+#define FLAG(field) ((int)offsetof(flags_t, field))
+#define REGS(reg)   ((int)offsetof(registers_t, x[reg]))
+
+/* Registers kept in r8w .. r11w, R_AX .. R_DX. */
+#define JIT_REGS 4
+
+/* A 16 bit register operand kept in a host register. */
+#define IS_HOSTED(op) ((op)->kind == OP_REG && (op)->width == 16 && (op)->reg < JIT_REGS)
+
+/* Host condition codes, setcc is 0x0f 0x90 | cc. */
+#define CC_O 0x0
+#define CC_C 0x2
+#define CC_Z 0x4
+#define CC_S 0x8
+#define CC_P 0xa
+
+/* Flags an inlined instruction leaves in the host flags, see emit_inline(). */
+#define HF_NONE 0
+#define HF_ZSP  1
+#define HF_ALL  2
+
+/* Translated code runs until a handler fails, halts, or control leaves it. */
+typedef int (*block_t)(glob_t *glob);
+
+/* Jump to an instruction that was not translated yet, patched once it is. */
+typedef struct link {
+	int at, ip;
+} link_t;
+
+typedef struct jit {
+	/**
+	 * code   - Executable buffer, starts with the exit every block shares.
+	 * used   - Bytes of code emitted.
+	 * n      - Number of instructions of prog.
+	 * entry  - Per instruction, offset of the block starting there, -1 if none.
+	 * at     - Per instruction, offset of its code in any block, -1 if none.
+	 * hits   - Per instruction, entries into a block starting there.
+	 * links  - Jumps waiting for their target, n_links of l_cap used.
+	 * blocks - Number of blocks translated.
+	 */
+	unsigned char *code;
+	int used, n;
+	int *entry, *at;
+	unsigned int *hits;
+	link_t *links;
+	int n_links, l_cap;
+	int blocks;
+	const prog_t *prog;
+} jit_t;
+
+static void emit(jit_t *jit, const void *bytes, int len) {
+	memcpy(jit->code + jit->used, bytes, len);
+	jit->used += len;
+}
+
+static void emit_16(jit_t *jit, uint16_t val) {
+	emit(jit, &val, 2);
+}
+
+static void emit_32(jit_t *jit, uint32_t val) {
+	emit(jit, &val, 4);
+}
+
+static void emit_64(jit_t *jit, uint64_t val) {
+	emit(jit, &val, 8);
+}
+
+/* Writes the rel32 at offset at so that it lands on offset to. */
+static void patch_rel(jit_t *jit, int at, int to) {
+	int32_t rel = to - (at + 4);
+	memcpy(jit->code + at, &rel, 4);
+}
+
+/* Emits a rel32 landing on offset to. */
+static void emit_rel(jit_t *jit, int to) {
+	emit_32(jit, to - (jit->used + 4));
+}
+
+/* mov dword [rbx + disp], imm */
+static void emit_store(jit_t *jit, int disp, int imm) {
+	EMIT(jit, 0xc7, 0x83);
+	emit_32(jit, disp);
+	emit_32(jit, imm);
+}
+
+/* mov dword [r12 + disp], imm */
+static void emit_flag_imm(jit_t *jit, int disp, int imm) {
+	EMIT(jit, 0x41, 0xc7, 0x84, 0x24);
+	emit_32(jit, disp);
+	emit_32(jit, imm);
+}
+
+/* mov [r12 + disp], reg - eax, ecx or edx. */
+static void emit_flag_reg(jit_t *jit, int disp, int reg) {
+	EMIT(jit, 0x41, 0x89, 0x84 | reg << 3, 0x24);
+	emit_32(jit, disp);
+}
+
+/* setcc byte [r12 + disp], the flags are 0 or 1 so the other bytes stay 0. */
+static void emit_setcc(jit_t *jit, int cc, int disp) {
+	EMIT(jit, 0x41, 0x0f, 0x90 | cc, 0x84, 0x24);
+	emit_32(jit, disp);
+}
+
+/* Writes AX .. DX back to the register file - mov [r14 + reg], rNw */
+static void emit_spill(jit_t *jit) {
+	for (int r = 0; r < JIT_REGS; r++) {
+		EMIT(jit, 0x66, 0x45, 0x89, 0x46 | r << 3, REGS(r));
+	}
+}
+
+/* Loads AX .. DX from the register file - movzx rNd, word [r14 + reg] */
+static void emit_fill(jit_t *jit) {
+	for (int r = 0; r < JIT_REGS; r++) {
+		EMIT(jit, 0x45, 0x0f, 0xb7, 0x46 | r << 3, REGS(r));
+	}
+}
+
+/* mov eax, ret; jmp exit */
+static void emit_exit(jit_t *jit, int ret) {
+	EMIT(jit, 0xb8);
+	emit_32(jit, ret);
+	EMIT(jit, 0xe9);
+	emit_rel(jit, 0);
+}
+
+/**
+ * @desc  : Emits the jump to instruction ip, glob->ip already holds it.
+ *          Leaves for the dispatcher while ip is not translated.
+ * @param : jit -
+ *          ip  - instruction to continue at.
+ * @return: void
+ */
+static void emit_chain(jit_t *jit, int ip) {
+	if (ip >= jit->n) {
+		emit_exit(jit, 1);
+		return;
+	}
+
+	EMIT(jit, 0xe9);
+	if (jit->at[ip] >= 0) {
+		emit_rel(jit, jit->at[ip]);
+		return;
+	}
+
+	/* Falls through to the exit below until it is patched. */
+	if (jit->n_links == jit->l_cap) {
+		int cap = jit->l_cap ? jit->l_cap * 2 : 64;
+		link_t *links = realloc(jit->links, cap * sizeof(link_t));
+		if (links) {
+			jit->links = links;
+			jit->l_cap = cap;
+		}
+	}
+
+	if (jit->n_links < jit->l_cap) {
+		jit->links[jit->n_links++] = (link_t){jit->used, ip};
+	}
+
+	emit_rel(jit, jit->used + 4);
+	emit_exit(jit, 1);
+}
+
+/* Does what exec_prog()'s FETCH does for instruction ip. */
+static void emit_fetch(jit_t *jit, int ip) {
+	const instr_t *instr = &jit->prog->instrs[ip];
+
+	emit_store(jit, GLOB(ip), ip + 1);
+	emit_store(jit, GLOB(c_line), instr->line);
+	emit_store(jit, GLOB(n_op), instr->n_op);
+
+	/* mov rax, instr; mov [rbx + instr], rax; lea r13, [r13 + 1] - keeps the host flags */
+	EMIT(jit, 0x48, 0xb8);
+	emit_64(jit, (uintptr_t)instr);
+	EMIT(jit, 0x48, 0x89, 0x83);
+	emit_32(jit, GLOB(instr));
+	EMIT(jit, 0x4d, 0x8d, 0x6d, 0x01);
+}
+
+/**
+ * Calls a handler, leaves with its return unless it succeeded. AX .. DX
+ * are written back for it and loaded again after, handlers read and
+ * write the register file.
+ */
+static void emit_call(jit_t *jit, int (*f_ptr)(glob_t *, char *, unsigned long)) {
+	emit_spill(jit);
+
+	/* mov rdi, rbx; xor esi, esi; mov edx, BUF_SZ */
+	EMIT(jit, 0x48, 0x89, 0xdf, 0x31, 0xf6, 0xba);
+	emit_32(jit, BUF_SZ);
+
+	/* mov rax, f_ptr; call rax */
+	EMIT(jit, 0x48, 0xb8);
+	emit_64(jit, (uintptr_t)f_ptr);
+	EMIT(jit, 0xff, 0xd0);
+
+	/* cmp eax, 1; jne exit */
+	emit_fill(jit);
+	EMIT(jit, 0x83, 0xf8, 0x01, 0x0f, 0x85);
+	emit_rel(jit, 0);
+}
+
+/* Makes the flags current before translated code reads them, see flags_sync(). */
+static int sync_flags(glob_t *glob, char *buf, unsigned long size) {
+	flags_sync(glob->flags);
+	return 1;
+}
+
+#ifdef PROBE_ON
+/* Fires the instr probe for translated code, see JIT_PROBE(). */
+static int probe_instr(glob_t *glob, char *buf, unsigned long size) {
+	PROBE_INSTR(glob->instr);
+	return 1;
+}
+
+/* Fires the jump probe of a jump translated code takes. */
+static int probe_jump(glob_t *glob, char *buf, unsigned long size) {
+	PROBE(jump, glob->c_line, glob->instr->opc, glob->instr->target);
+	return 1;
+}
+
+/* Calls f_ptr while a tracer is attached to the probe of sem. Changes the host flags. */
+static void emit_probe(jit_t *jit, const unsigned short *sem,
+                       int (*f_ptr)(glob_t *, char *, unsigned long)) {
+	/* mov rax, sem; cmp word [rax], 0; je skip */
+	EMIT(jit, 0x48, 0xb8);
+	emit_64(jit, (uintptr_t)sem);
+	EMIT(jit, 0x66, 0x83, 0x38, 0x00, 0x0f, 0x84);
+	int skip = jit->used;
+	emit_32(jit, 0);
+
+	emit_call(jit, f_ptr);
+	patch_rel(jit, skip, jit->used);
+}
+
+#define JIT_PROBE(jit, name) emit_probe((jit), &PROBE_SEM(name), probe_##name)
+#else
+#define JIT_PROBE(jit, name) ((void)0)
+#endif
+
+/* Tells if an opcode is a jump, those end a block. */
+static int is_jump(int opc) {
+	switch (opc) {
+	case OPC_JC: case OPC_JCXZ: case OPC_JE: case OPC_JMP:
+	case OPC_JNC: case OPC_JNE: case OPC_JP: case OPC_JPE:
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @desc  : Tells if an instruction can be translated. The rest is left to
+ *          the dispatcher, which reports the error as exec_prog() would.
+ * @param : instr -
+ * @return: int   - 1 if it can, else 0.
+ */
+static int is_native(const instr_t *instr) {
+	if (instr->opc == OPC_NONE) {
+		return 1;
+	}
+
+	if (instr->opc == OPC_BAD || instr->n_op != instr_set[instr->form].n_ops) {
+		return 0;
+	}
+
+	return !is_jump(instr->opc) || instr->target >= 0;
+}
+
+/* ecx = the source operand as a signed number, as SPEC_VAL_REG() and SPEC_VAL_IMM() read it. */
+static void emit_src(jit_t *jit, const operand_t *src) {
+	if (src->kind == OP_IMM) {
+		/* mov ecx, imm */
+		EMIT(jit, 0xb9);
+		emit_32(jit, (int16_t)(src->val & 0xffff));
+	} else {
+		/* movsx ecx, rSw */
+		EMIT(jit, 0x41, 0x0f, 0xbf, 0xc8 | src->reg);
+	}
+}
+
+/**
+ * @desc  : Emits ADD, SUB or CMP of a hosted register and a hosted
+ *          register or literal. Leaves the flags pending the way alu()
+ *          does, then runs the operation on the host. A result that does
+ *          not fit 16 bits is left to the handler, which reports it.
+ * @param : jit   -
+ *          instr -
+ * @return: void
+ */
+static void emit_alu(jit_t *jit, const instr_t *instr) {
+	const operand_t *ops = instr->ops;
+	int d = ops[0].reg, opc = instr->opc;
+
+	/* movsx eax, rDw */
+	EMIT(jit, 0x41, 0x0f, 0xbf, 0xc0 | d);
+	emit_src(jit, &ops[1]);
+
+	/* edx = the result before it is cut to 16 bits - lea edx, [rax + rcx] or mov edx, eax; sub edx, ecx */
+	if (opc == OPC_ADD) {
+		EMIT(jit, 0x8d, 0x14, 0x08);
+	} else {
+		EMIT(jit, 0x89, 0xc2, 0x29, 0xca);
+	}
+
+	emit_flag_reg(jit, FLAG(lz_dst), 0);
+	emit_flag_reg(jit, FLAG(lz_src), 1);
+	emit_flag_reg(jit, FLAG(lz_res), 2);
+	emit_flag_imm(jit, FLAG(lz_w), 16);
+	emit_flag_imm(jit, FLAG(lz_op), opc == OPC_ADD ? LZ_ADD : LZ_SUB);
+
+	/* add ax, cx; sub ax, cx or cmp ax, cx */
+	EMIT(jit, 0x66, opc == OPC_ADD ? 0x01 : opc == OPC_SUB ? 0x29 : 0x39, 0xc8);
+	if (opc == OPC_CMP) {
+		return;
+	}
+
+	/* jno store */
+	EMIT(jit, 0x0f, 0x81);
+	int store = jit->used;
+	emit_32(jit, 0);
+
+	/**
+	 * Overflow - ADD fails, SUB reports it and leaves the register as it
+	 * was. The compare gives a jump after it the flags of the subtraction.
+	 */
+	emit_call(jit, instr_set[instr->form].f_ptr);
+	EMIT(jit, 0x41, 0x0f, 0xbf, 0xc0 | d);
+	emit_src(jit, &ops[1]);
+	EMIT(jit, 0x66, 0x39, 0xc8, 0xe9);
+	int done = jit->used;
+	emit_32(jit, 0);
+
+	/* mov rDw, ax */
+	patch_rel(jit, store, jit->used);
+	EMIT(jit, 0x66, 0x41, 0x89, 0xc0 | d);
+	patch_rel(jit, done, jit->used);
+}
+
+/**
+ * @desc  : Emits INC or DEC of a hosted register, the way unary() runs
+ *          it. They keep CF, so flags pending from ADD, SUB or MUL are
+ *          computed first, as flags_defer() does.
+ * @param : jit   -
+ *          instr -
+ * @return: void
+ */
+static void emit_unary(jit_t *jit, const instr_t *instr) {
+	int d = instr->ops[0].reg, inc = instr->opc == OPC_INC;
+
+	/* mov eax, [r12 + lz_op]; dec eax; cmp eax, LZ_MUL - 1; ja defer */
+	EMIT(jit, 0x41, 0x8b, 0x84, 0x24);
+	emit_32(jit, FLAG(lz_op));
+	EMIT(jit, 0xff, 0xc8, 0x83, 0xf8, LZ_MUL - 1, 0x0f, 0x87);
+	int defer = jit->used;
+	emit_32(jit, 0);
+
+	emit_call(jit, sync_flags);
+	patch_rel(jit, defer, jit->used);
+
+	/* movsx eax, rDw; lea edx, [rax +/- 1] */
+	EMIT(jit, 0x41, 0x0f, 0xbf, 0xc0 | d, 0x8d, 0x50, inc ? 0x01 : 0xff);
+
+	emit_flag_reg(jit, FLAG(lz_dst), 0);
+	emit_flag_imm(jit, FLAG(lz_src), 1);
+	emit_flag_reg(jit, FLAG(lz_res), 2);
+	emit_flag_imm(jit, FLAG(lz_w), 16);
+	emit_flag_imm(jit, FLAG(lz_op), inc ? LZ_INC : LZ_DEC);
+
+	/* inc rDw or dec rDw */
+	EMIT(jit, 0x66, 0x41, 0xff, (inc ? 0xc0 : 0xc8) | d);
+}
+
+/**
+ * @desc  : Emits an instruction inline, if it is MOV, ADD, SUB, CMP,
+ *          INC or DEC of hosted registers and literals.
+ * @param : jit   -
+ *          instr -
+ * @return: int   - -1 if it is left to its handler, else the flags it
+ *                  leaves in the host flags - HF_NONE, HF_ZSP (all but
+ *                  CF) or HF_ALL.
+ */
+static int emit_inline(jit_t *jit, const instr_t *instr) {
+	const operand_t *ops = instr->ops;
+	int d = ops[0].reg;
+
+	switch (instr->form) {
+	case FORM_MOV_REG_IMM:
+		if (!IS_HOSTED(&ops[0])) {
+			return -1;
+		}
+
+		/* mov rDw, imm */
+		EMIT(jit, 0x66, 0x41, 0xb8 | d);
+		emit_16(jit, ops[1].val & 0xffff);
+		return HF_NONE;
+
+	case FORM_MOV_REG_REG:
+		if (!IS_HOSTED(&ops[0]) || !IS_HOSTED(&ops[1])) {
+			return -1;
+		}
+
+		/* mov rDw, rSw */
+		EMIT(jit, 0x66, 0x45, 0x89, 0xc0 | ops[1].reg << 3 | d);
+		return HF_NONE;
+
+	case FORM_ADD_REG_IMM: case FORM_SUB_REG_IMM: case FORM_CMP_REG_IMM:
+	case FORM_ADD_REG_REG: case FORM_SUB_REG_REG: case FORM_CMP_REG_REG:
+		if (!IS_HOSTED(&ops[0]) || (ops[1].kind == OP_REG && !IS_HOSTED(&ops[1]))) {
+			return -1;
+		}
+
+		emit_alu(jit, instr);
+		return HF_ALL;
+	}
+
+	if ((instr->opc == OPC_INC || instr->opc == OPC_DEC) && instr->n_op == 1 &&
+	    IS_HOSTED(&ops[0])) {
+		emit_unary(jit, instr);
+		return HF_ZSP;
+	}
+
+	return -1;
+}
+
+/**
+ * @desc  : Does what flags_sync() does from the host flags of the
+ *          instruction just emitted inline.
+ * @param : jit -
+ *          hf  - HF_ZSP or HF_ALL, see emit_inline().
+ * @return: void
+ */
+static void emit_host_flags(jit_t *jit, int hf) {
+	if (hf == HF_ALL) {
+		emit_setcc(jit, CC_C, FLAG(cf));
+	}
+
+	emit_setcc(jit, CC_O, FLAG(of));
+	emit_setcc(jit, CC_Z, FLAG(zf));
+	emit_setcc(jit, CC_S, FLAG(sf));
+	emit_setcc(jit, CC_P, FLAG(pf));
+
+	/* lahf; shr eax, 12; and eax, 1 - AF, bit 4 of ah */
+	EMIT(jit, 0x9f, 0xc1, 0xe8, 0x0c, 0x83, 0xe0, 0x01);
+	emit_flag_reg(jit, FLAG(af), 0);
+	emit_flag_imm(jit, FLAG(lz_op), LZ_NONE);
+}
+
+/**
+ * @desc  : Emits a jump, decided the way jump_jx() and jump_jnx() decide
+ *          it. JCXZ reads CX, so its handler decides and glob->ip tells.
+ * @param : jit   -
+ *          instr - the jump.
+ *          ip    - index of the jump.
+ *          hf    - flags the instruction before left in the host flags,
+ *                  see emit_inline().
+ * @return: void
+ */
+static void emit_jump(jit_t *jit, const instr_t *instr, int ip, int hf) {
+	int flag = FLAG(zf), val = 1;
+
+	switch (instr->opc) {
+	case OPC_JMP:
+		JIT_PROBE(jit, jump);
+		emit_store(jit, GLOB(ip), instr->target);
+		emit_chain(jit, instr->target);
+		return;
+
+	case OPC_JCXZ:
+		emit_call(jit, instr_set[instr->form].f_ptr);
+
+		/* cmp dword [rbx + ip], target */
+		EMIT(jit, 0x81, 0xbb);
+		emit_32(jit, GLOB(ip));
+		emit_32(jit, instr->target);
+		break;
+
+	/* jump_jx() goes by the last letter, so JPE tests ZF like JE. */
+	case OPC_JC:  flag = FLAG(cf); break;
+	case OPC_JNC: flag = FLAG(cf); val = 0; break;
+	case OPC_JNE: val = 0; break;
+	case OPC_JP:  flag = FLAG(pf); break;
+	}
+
+	/* The instr probe of a jump on host flags waits until they are stored. */
+	if (instr->opc != OPC_JCXZ && hf != HF_NONE) {
+		emit_host_flags(jit, hf);
+		JIT_PROBE(jit, instr);
+	} else if (instr->opc != OPC_JCXZ) {
+		/* cmp dword [r12 + lz_op], LZ_NONE; je synced */
+		EMIT(jit, 0x41, 0x83, 0xbc, 0x24);
+		emit_32(jit, FLAG(lz_op));
+		EMIT(jit, LZ_NONE, 0x0f, 0x84);
+		int synced = jit->used;
+		emit_32(jit, 0);
+
+		emit_call(jit, sync_flags);
+		patch_rel(jit, synced, jit->used);
+	}
+
+	if (instr->opc != OPC_JCXZ) {
+		/* cmp dword [r12 + flag], val */
+		EMIT(jit, 0x41, 0x83, 0xbc, 0x24);
+		emit_32(jit, flag);
+		EMIT(jit, val);
+	}
+
+	/* jne not_taken */
+	EMIT(jit, 0x0f, 0x85);
+	int not_taken = jit->used;
+	emit_32(jit, 0);
+
+	/* JCXZ's handler fired it. */
+	if (instr->opc != OPC_JCXZ) {
+		JIT_PROBE(jit, jump);
+	}
+	emit_store(jit, GLOB(ip), instr->target);
+	emit_chain(jit, instr->target);
+
+	patch_rel(jit, not_taken, jit->used);
+	emit_chain(jit, ip + 1);
+}
+
+/**
+ * @desc  : Translates the block starting at instruction start.
+ * @param : jit   -
+ *          start - first instruction of the block.
+ * @return: int   - 0 if it cannot be translated, 1 if success.
+ */
+static int translate(jit_t *jit, int start) {
+	const instr_t *instrs = jit->prog->instrs;
+	if (!is_native(&instrs[start]) || jit->used + 2 * JIT_INSTR_MAX > JIT_CODE_SZ) {
+		return 0;
+	}
+
+	/**
+	 * push rbx; push r12; push r13; push r14; push r15 - r15 keeps calls
+	 * 16 byte aligned. mov rbx, rdi; mov r12, [rbx + flags];
+	 * mov r14, [rbx + registers]; xor r13d, r13d
+	 */
+	jit->entry[start] = jit->used;
+	EMIT(jit, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57,
+		0x48, 0x89, 0xfb, 0x4c, 0x8b, 0xa3);
+	emit_32(jit, GLOB(flags));
+	EMIT(jit, 0x4c, 0x8b, 0xb3);
+	emit_32(jit, GLOB(registers));
+	EMIT(jit, 0x45, 0x31, 0xed);
+	emit_fill(jit);
+
+	int ip = start, jumped = 0, hf = HF_NONE;
+	for (; !jumped && ip < jit->n && ip - start < JIT_BLOCK; ip++) {
+		const instr_t *instr = &instrs[ip];
+		if (!is_native(instr) || jit->used + 2 * JIT_INSTR_MAX > JIT_CODE_SZ) {
+			break;
+		}
+
+		/* A jump on host flags only runs after the instruction that set them. */
+		int fused = hf != HF_NONE && is_jump(instr->opc) &&
+		            instr->opc != OPC_JMP && instr->opc != OPC_JCXZ;
+		if (!fused) {
+			jit->at[ip] = jit->used;
+		}
+		emit_fetch(jit, ip);
+		if (!fused) {
+			JIT_PROBE(jit, instr);
+		}
+
+		/* NOP, IN and OUT do nothing, only their fetch is emitted. */
+		if (is_jump(instr->opc)) {
+			emit_jump(jit, instr, ip, hf);
+			jumped = 1;
+		} else if (instr->opc == OPC_NONE || instr_set[instr->form].f_ptr == nop) {
+			hf = HF_NONE;
+		} else if ((hf = emit_inline(jit, instr)) < 0) {
+			emit_call(jit, instr_set[instr->form].f_ptr);
+			hf = HF_NONE;
+		}
+	}
+
+	/* Cut short, glob->ip is the first instruction left out. */
+	if (!jumped) {
+		emit_chain(jit, ip);
+	}
+
+	/* Jumps waiting for an instruction translated now go there directly. */
+	for (int i = 0; i < jit->n_links;) {
+		link_t *link = &jit->links[i];
+		if (jit->at[link->ip] < 0) {
+			i++;
+			continue;
+		}
+
+		patch_rel(jit, link->at, jit->at[link->ip]);
+		*link = jit->links[--jit->n_links];
+	}
+
+	jit->blocks++;
+	return 1;
+}
+
+static void destroy_jit(jit_t *jit) {
+	if (jit->code) {
+		munmap(jit->code, JIT_CODE_SZ);
+	}
+
+	free(jit->entry);
+	free(jit->at);
+	free(jit->hits);
+	free(jit->links);
+	free(jit);
+}
+
+/**
+ * @desc  : Switches the code buffer between writable, while code is
+ *          emitted into it, and executable. It is never both.
+ * @param : jit  -
+ *          prot - PROT_READ | PROT_WRITE or PROT_READ | PROT_EXEC.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+static int protect_jit(jit_t *jit, int prot) {
+	if (mprotect(jit->code, JIT_CODE_SZ, prot) != 0) {
+		fprintf(stderr, "protect_jit(): Could not protect code, interpreting.\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Maps the code buffer and emits the shared exit into it.
+ * @param : prog -
+ * @return: jit_t* - NULL if fail.
+ */
+static jit_t *init_jit(const prog_t *prog) {
+	jit_t *jit = calloc(1, sizeof(jit_t));
+	if (!jit || !prog->n) {
+		free(jit);
+		return NULL;
+	}
+
+	jit->prog = prog;
+	jit->n = prog->n;
+	jit->entry = malloc(prog->n * sizeof(int));
+	jit->at = malloc(prog->n * sizeof(int));
+	jit->hits = calloc(prog->n, sizeof(unsigned int));
+
+	jit->code = mmap(NULL, JIT_CODE_SZ, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (jit->code == MAP_FAILED) {
+		fprintf(stderr, "init_jit(): Could not map code, interpreting.\n");
+		jit->code = NULL;
+	}
+
+	if (!jit->code || !jit->entry || !jit->at || !jit->hits) {
+		destroy_jit(jit);
+		return NULL;
+	}
+
+	memset(jit->entry, 0xff, prog->n * sizeof(int));
+	memset(jit->at, 0xff, prog->n * sizeof(int));
+
+	/* AX .. DX; add [rbx + steps], r13; pop r15; pop r14; pop r13; pop r12; pop rbx; ret */
+	emit_spill(jit);
+	EMIT(jit, 0x4c, 0x01, 0xab);
+	emit_32(jit, GLOB(steps));
+	EMIT(jit, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0xc3);
+
+	if (!protect_jit(jit, PROT_READ | PROT_EXEC)) {
+		destroy_jit(jit);
+		return NULL;
+	}
+
+	return jit;
+}
+
+/**
+ * @desc  : Interprets instructions from glob->ip up to the next jump.
+ * @param : glob -
+ * @return: int  - return of the last handler run.
+ */
+static int step_block(glob_t *glob) {
+	const prog_t *prog = glob->prog;
+	int ret = 1;
+
+	while (ret == 1 && glob->ip < prog->n) {
+		instr_t *instr = &prog->instrs[glob->ip++];
+		load_instr(glob, instr);
+		glob->steps++;
+
+		ret = call_instr(glob, NULL, BUF_SZ);
+		if (is_jump(instr->opc)) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
+#endif
+
+/**
+ * @desc  : Executes the program from glob->ip until it ends, halts or an
+ *          instruction fails, translating blocks as they get hot. Runs on
+ *          exec_prog() where no code can be emitted.
+ * @param : glob   -
+ *          blocks - receives the number of blocks translated.
+ * @return: int    - 1 if the emulator halted due to an error, else 0.
+ */
+int jit_prog(glob_t *glob, int *blocks) {
+	*blocks = 0;
+
+#ifdef JIT_NATIVE
+	jit_t *jit = init_jit(glob->prog);
+	if (!jit) {
+		return exec_prog(glob);
+	}
+
+	int ret = 1, native = 1;
+	while (ret == 1 && glob->ip < jit->n) {
+		int ip = glob->ip;
+		if (jit->entry[ip] < 0 && jit->hits[ip]++ == JIT_HOT) {
+			native = protect_jit(jit, PROT_READ | PROT_WRITE);
+			if (native) {
+				translate(jit, ip);
+				native = protect_jit(jit, PROT_READ | PROT_EXEC);
+			}
+
+			/* The code cannot run, exec_prog() takes over from here. */
+			if (!native) {
+				break;
+			}
+		}
+
+		if (jit->entry[ip] >= 0) {
+			ret = ((block_t)(void *)(jit->code + jit->entry[ip]))(glob);
+		} else {
+			ret = step_block(glob);
+		}
+	}
+
+	*blocks = jit->blocks;
+	destroy_jit(jit);
+	return native ? !ret : exec_prog(glob);
+#else
+	return exec_prog(glob);
+#endif
+}
@@ -0,0 +1,28 @@
+/**
+ * @file: jit.h
+ * @desc: Declares the tier that counts how often each basic block of an
+ *        assembled program is entered and translates the hot ones into
+ *        x86-64 code.
+ */
+
+#ifndef _ASE_JIT_H_
+#define _ASE_JIT_H_
+
+#include "glob.h"
+
+/* Code is only emitted on x86-64, elsewhere jit_prog() runs exec_prog(). */
+#if defined(__x86_64__) && defined(__unix__)
+#define JIT_NATIVE
+#endif
+
+/* Entries into a block before it is translated. */
+#define JIT_HOT       16
+/* Instructions in a block at most. */
+#define JIT_BLOCK     256
+/* Size of the executable buffer, and the code of one instruction at most. */
+#define JIT_CODE_SZ   (1 << 20)
+#define JIT_INSTR_MAX 512
+
+int jit_prog (glob_t *glob, int *blocks);
+
+#endif
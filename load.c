@@ -0,0 +1,132 @@
+/**
+ * @file: load.c
+ * @desc: Defines functions that map a source file into memory.
+ *
+ *        The tokenizer hands out (pointer, length) views into the
+ *        mapping, so the source text is never copied while assembling.
+ */
+
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "load.h"
+
+/**
+ * @desc  : Reads fd into a heap buffer. Used when fd cannot be mapped
+ *          (Eg: a pipe).
+ * @param : src - receives the buffer.
+ *          fd  - file descriptor of the source file.
+ * @return: int - 0 if fail, 1 if success.
+ */
+static int read_src(src_t *src, int fd) {
+	size_t cap = 4096, len = 0;
+	char *buf = malloc(cap);
+
+	while (buf) {
+		ssize_t ret = read(fd, buf + len, cap - len);
+		if (ret < 0) {
+			break;
+		}
+
+		if (ret == 0) {
+			src->base = buf;
+			src->len = len;
+			return 1;
+		}
+
+		len += ret;
+		if (len == cap) {
+			char *tmp = realloc(buf, cap *= 2);
+			if (!tmp) {
+				break;
+			}
+
+			buf = tmp;
+		}
+	}
+
+	fprintf(stderr, "read_src(): Could not read source.\n");
+	free(buf);
+	return 0;
+}
+
+/**
+ * @desc  : Maps the source file read-only into memory.
+ * @param : fd     - file descriptor of the source file.
+ * @return: src_t* - mapped source, or NULL.
+ */
+src_t *map_src(int fd) {
+	struct stat st;
+	src_t *src = calloc(1, sizeof(src_t));
+	if (!src) {
+		fprintf(stderr, "map_src(): malloc failure.\n");
+		return NULL;
+	}
+
+	/* mmap() refuses zero length mappings, those are read instead. */
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (base != MAP_FAILED) {
+			madvise(base, st.st_size, MADV_SEQUENTIAL);
+			src->base = base;
+			src->len = st.st_size;
+			src->mapped = 1;
+			return src;
+		}
+	}
+
+	if (!read_src(src, fd)) {
+		free(src);
+		return NULL;
+	}
+
+	return src;
+}
+
+/**
+ * @desc  : Reads the source file into private memory. Unlike a
+ *          mapping, the copy does not change when the file is
+ *          rewritten in place, so it can be compared with the next
+ *          version of the file.
+ * @param : fd     - file descriptor of the source file.
+ * @return: src_t* - the source, or NULL.
+ */
+src_t *copy_src(int fd) {
+	src_t *src = calloc(1, sizeof(src_t));
+	if (!src) {
+		fprintf(stderr, "copy_src(): malloc failure.\n");
+		return NULL;
+	}
+
+	if (!read_src(src, fd)) {
+		free(src);
+		return NULL;
+	}
+
+	return src;
+}
+
+/**
+ * @desc  : Releases a mapped source.
+ * @param : src - source to release.
+ * @return: void
+ */
+void unmap_src(src_t *src) {
+	if (!src) {
+		return;
+	}
+
+	if (src->mapped) {
+		munmap((void *)src->base, src->len);
+	} else {
+		free((void *)src->base);
+	}
+
+	free(src);
+}
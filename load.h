@@ -0,0 +1,26 @@
+/**
+ * @file: load.h
+ * @desc: Declares functions that map a source file into memory.
+ */
+
+#ifndef _ASE_LOAD_H_
+#define _ASE_LOAD_H_
+
+#include <stddef.h>
+
+typedef struct src {
+	/**
+	 * base   - First byte of the source text.
+	 * len    - Length of the source text in bytes.
+	 * mapped - Set if base is an mmap'd region, else it is malloc'd.
+	 */
+	const char *base;
+	size_t len;
+	int mapped;
+} src_t;
+
+src_t *copy_src  (int fd);
+src_t *map_src   (int fd);
+void   unmap_src (src_t *src);
+
+#endif
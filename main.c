@@ -6,19 +6,33 @@
  *          Manipal University - 2019
  */
 
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "asm.h"
+#include "batch.h"
 #include "bind.h"
+#include "cache.h"
 #include "display.h"
+#include "emit.h"
+#include "exec.h"
+#include "fuse.h"
 #include "glob.h"
+#include "jit.h"
 #include "mem.h"
 #include "parse.h"
+#include "plugin.h"
 #include "stack.h"
+#include "stream.h"
 #include "tengine.h"
+#include "watch.h"
 
 void parse_args(glob_t *glob, int argc, char **argv, args_t *p_args) {
 	int opt;
@@ -26,40 +40,175 @@ void parse_args(glob_t *glob, int argc, char **argv, args_t *p_args) {
 	struct option long_opt[] = 
 	{
 		{"all-flags", no_argument, 0, 'a'},
+		{"cache",     no_argument, 0, 'c'},
+		{"emit-c",    required_argument, 0, 'e'},
+		{"fuse",      no_argument, 0, 'F'},
+		{"jit",       no_argument, 0, 'J'},
+		{"jobs",      required_argument, 0, 'j'},
+		{"keep",      no_argument, 0, 'k'},
 		{"no-warns",  no_argument, 0, 'w'},
+		{"pipeline",  no_argument, 0, 'p'},
+		{"plugin",    required_argument, 0, 'P'},
+		{"watch",     no_argument, 0, 'W'},
 		{0, 0, 0, 0}
 	};
 
-	while ((opt = getopt_long(argc, argv, "ab:dfhlmrsvw", long_opt, &idx)) != -1) {
+	while ((opt = getopt_long(argc, argv, "ab:cde:fFhj:JklmpP:rsvwW", long_opt, &idx)) != -1) {
 		switch (opt) {
 		case 'a': p_args->f = p_args->m = p_args->r = p_args->s = 1; break;
-
-		/**
-		 * TODO
-		 * Allow user to set a break point.
-		 */
 		case 'b': glob->bpnt = (int)strtol(optarg, NULL, 0); break;
+		case 'c': p_args->c   = 1; break;
 		case 'd': glob->debug = 1; break;
+		case 'e': p_args->e   = optarg; break;
 		case 'f': p_args->f   = 1; break;
+		case 'F': p_args->F   = 1; break;
 		case 'h': p_args->h   = 1; break;
+		case 'j': glob->jobs  = (int)strtol(optarg, NULL, 0); break;
+		case 'J': p_args->J   = 1; break;
+		case 'k': p_args->k   = 1; break;
 		case 'l': p_args->l   = 1; break;
 		case 'm': p_args->m   = 1; break;
+		case 'p': p_args->p   = 1; break;
+		case 'P': p_args->P  |= !load_plugin(optarg); break;
 		case 'r': p_args->r   = 1; break;
 		case 's': p_args->s   = 1; break;
 		case 'v': p_args->v   = 1; break;
+		case 'W': p_args->W   = 1; break;
 		
 		/* Turn off warnings */
 		case 'w': glob->mem->warned = 1; break;
 		}
 	}
 
+	struct stat sb;
 	for (; optind < argc; optind++) {
-		if (!strstr(argv[optind], ".asm")) {
+		if (!strstr(argv[optind], ".asm") &&
+			(stat(argv[optind], &sb) || !S_ISDIR(sb.st_mode))) {
 			fprintf(stderr, "Ignoring extra argument: %s\n", argv[optind]);
 		}
 	}
 }
 
+/**
+ * @desc  : Executes the program from glob->ip until it ends, halts or
+ *          an instruction fails. Runs on exec_prog(), or jit_prog() with
+ *          -J, unless there is something to check between instructions.
+ * @param : glob  -
+ *          st    - stream to fetch from when pipelined, else NULL.
+ *          args  - display options, used in debug mode.
+ * @return: int   - 1 if the emulator halted due to an error, else 0.
+ */
+static int run(glob_t *glob, stream_t *st, args_t args) {
+	/* Nothing to check between instructions, take the fast path. */
+	if (!st && !glob->debug && glob->bpnt < 0) {
+		if (!args.J) {
+			return exec_prog(glob);
+		}
+
+		int blocks, flag = jit_prog(glob, &blocks);
+		printf("Compiled %d blocks.\n\n", blocks);
+		return flag;
+	}
+
+	prog_t *prog = glob->prog;
+	int flag = 0, exec = 1;
+
+	while (exec) {
+		instr_t *instr = NULL;
+		if (st) {
+			instr = stream_fetch(st, glob, glob->ip);
+		} else if (glob->ip < prog->n) {
+			instr = &prog->instrs[glob->ip];
+		}
+
+		/* End of program, or the producer hit a bad line. */
+		if (!instr) {
+			flag = st && st->failed;
+			break;
+		}
+
+		load_instr(glob, instr);
+		glob->ip++;
+		glob->steps++;
+
+		/* Step through the program from the breakpoint on. */
+		if (glob->c_line == glob->bpnt && !glob->debug) {
+			printf("Breakpoint at line %d. Press 'c' to continue.\n\n", glob->bpnt);
+			glob->debug = 1;
+		}
+
+		int ret = call_instr(glob, NULL, (unsigned long)BUF_SZ);
+		if (ret == -1) {
+			exec = 0;
+		}
+
+		if (!ret) {
+			flag = 1;
+			exec = 0;
+		}
+
+		if (exec) {
+			/* Debug mode is called only if there are no bad returns. */
+			if (glob->debug) {
+				tok_t line = src_line(prog, glob->c_line);
+				printf("Evaluating: %.*s\n", line.len, line.ptr);
+				
+				char ch = getchar();
+				while (ch != 'c') {
+					ch = getchar();
+				}
+
+				display(glob, args);
+			}
+		}
+	}
+
+	return flag;
+}
+
+/* State shared by the programs of a batch run. */
+typedef struct batch_run {
+	glob_t *glob;
+	args_t args;
+	int failed;
+} batch_run_t;
+
+/**
+ * @desc  : Assembles and runs one program of a batch, from a clean
+ *          emulator state.
+ * @param : arg  - batch_run_t.
+ *          name - name of the source file.
+ *          src  - source text, NULL if it could not be read.
+ * @return: void
+ */
+static void run_file(void *arg, const char *name, src_t *src) {
+	batch_run_t *batch = arg;
+	glob_t *glob = batch->glob;
+
+	printf("==> %s <==\n", name);
+	reset_glob(glob);
+
+	prog_t *prog = src ? assemble(glob, src) : NULL;
+	glob->prog = prog;
+
+	if (prog && batch->args.F) {
+		printf("Fused %d instruction pairs.\n", fuse_prog(prog, 1));
+	}
+
+	int flag = !prog || run(glob, NULL, batch->args);
+	if (flag && src) {
+		fprintf(stderr, "Emulator halted due to an error in line %d of %s. State preserved.\n\n",
+			glob->c_line, name);
+	}
+
+	display(glob, batch->args);
+	printf("\n");
+
+	glob->prog = NULL;
+	destroy_prog(prog);
+	batch->failed += flag;
+}
+
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		fprintf(stderr, "Error: Please specify minimum number [1] of args.\n");
@@ -75,9 +224,9 @@ int main(int argc, char **argv) {
 	}
 
 	args_t args_ = {0};
-	table_t *table = init_table();
-	bind_calls(table);
-	FILE *fd = fopen(argv[1], "r");
+	/* getopt_long() permutes argv, keep the source path aside. */
+	const char *src_path = argv[1];
+	FILE *fd = fopen(src_path, "r");
 	
 	if (!fd) {
 		fprintf(stderr, "Could not open specified file.\n");
@@ -85,75 +234,146 @@ int main(int argc, char **argv) {
 	}
 
 	int flag = 0, exec = 1;
-	char line[1024];
 	glob_t *glob = init_glob(fd);
-	memset(line, 0, sizeof(line));
 	parse_args(glob, argc, argv, &args_);
 
-	if (glob->debug) {
-		printf("Debug Mode. Press 'c' to continue.\n\n");
+	/* Plugins bind mnemonics the source may use, run nothing without them. */
+	if (args_.P) {
+		destroy_glob(glob);
+		return 1;
 	}
-	
-	while (fgets(line, sizeof(line), fd) != NULL) {
-		if (should_skip_ln(line)) {
-			glob->c_line++;
-			continue;
-		}
-		
-		if (!parse_line(glob, line)) {
-			fprintf(stderr, "Could not parse line.\n");
-			flag = 1;
-			exec = 0;
-		}
 
-		int ret = call_by_name(table, glob, NULL, (unsigned long)BUF_SZ);
-		if (ret == -1) {
-			exec = 0;
-		}
+	/* A directory runs every .asm file in it, one after another. */
+	struct stat sb;
+	if (!fstat(fileno(fd), &sb) && S_ISDIR(sb.st_mode)) {
+		batch_run_t batch = {glob, args_, 0};
+		flag = !load_batch(src_path, 1, run_file, &batch) || batch.failed;
 
-		if (!ret) {
-			flag = 1;
-			exec = 0;
+		destroy_glob(glob);
+		return flag;
+	}
+
+	/**
+	 * Assemble the whole source before executing the first instruction,
+	 * unless pipelining was asked for. Debug mode needs the line map, the
+	 * cache and the C translation the whole program, so all assemble up
+	 * front.
+	 * Watch mode patches the program and compares each version of the
+	 * source with the previous one, so it needs a private copy of both.
+	 */
+	prog_t *prog = NULL;
+	stream_t *st = NULL;
+	src_t *src = args_.W ? copy_src(fileno(fd)) : map_src(fileno(fd));
+	if (src && args_.p && !args_.c && !args_.e && !args_.W && !glob->debug) {
+		if ((st = init_stream(src))) {
+			prog = st->prog;
 		}
+	} else if (src) {
+		char path[4096];
+		cache_path(src_path, path, sizeof(path));
 
-		if (exec) {
-			/* Debug mode is called only if there are no bad returns. */
-			if (glob->debug) {
-				printf("Evaluating: %s %s %s\n", glob->tokens[0], glob->tokens[1],
-					glob->tokens[2]);
-				
-				char ch = getchar();
-				while (ch != 'c') {
-					ch = getchar();
-				}
+		/* Reuse the bytecode cache if it matches this source and build. */
+		prog = args_.c && !args_.W ? load_cache(glob, src, path) : NULL;
+		if (!prog) {
+			prog = assemble(glob, src);
 
-				display(glob, args_);
+			if (prog && args_.c) {
+				save_cache(prog, src, path);
 			}
-			
-		} else {
-			/**
-			 * When exec = 0, we have a bad return from above function calls,
-			 * hence we exit the while loop.
-			 */ 
-			break;
 		}
 	}
 
+	if (!prog) {
+		flag = 1;
+		exec = 0;
+	}
+
+	/* Translate to C instead of running. */
+	if (prog && args_.e) {
+		glob->prog = prog;
+		flag = !emit_c(glob, args_, args_.e);
+
+		destroy_prog(prog);
+		unmap_src(src);
+		destroy_glob(glob);
+		return flag;
+	}
+
+	/* Cached programs are fused again, -F of this run decides. */
+	if (prog && !st) {
+		int fused = fuse_prog(prog, args_.F);
+		if (args_.F) {
+			printf("Fused %d instruction pairs.\n\n", fused);
+		}
+	}
+
+	glob->prog = prog;
+	if (glob->debug) {
+		printf("Debug Mode. Press 'c' to continue.\n\n");
+	}
+	
+	flag = exec ? run(glob, st, args_) : flag;
 	if (flag) {
 		fprintf(stderr, "Emulator halted due to an error in line %d. State preserved.\n\n",
-			++glob->c_line);
+			glob->c_line);
 	}
 
 	if (glob->debug) {
 		printf("\n\nResult\n" TERM_GREEN);
 	}
 
+	/* Listing labels needs the rest of the source. */
+	if (st) {
+		prog = glob->prog = finish_stream(st, glob, !flag && args_.l);
+	}
+
 	/* Program ends here. */
 	display(glob, args_);
 
+	/* Run again whenever the source is saved, until interrupted. */
+	int wfd = args_.W && prog ? init_watch(src_path) : -1;
+	fflush(stdout);
+	while (wfd >= 0 && wait_watch(wfd, src_path)) {
+		FILE *next = fopen(src_path, "r");
+		src_t *edit = next ? copy_src(fileno(next)) : NULL;
+		if (next) {
+			fclose(next);
+		}
+
+		if (!edit || !patch_prog(glob, prog, edit)) {
+			fprintf(stderr, "Keeping the previous program.\n\n");
+			unmap_src(edit);
+			continue;
+		}
+
+		unmap_src(src);
+		src = edit;
+		fuse_prog(prog, args_.F);
+
+		if (args_.k) {
+			glob->ip = 0;
+		} else {
+			reset_glob(glob);
+		}
+
+		printf("\n%s changed, running again.\n\n", src_path);
+		if ((flag = run(glob, NULL, args_))) {
+			fprintf(stderr, "Emulator halted due to an error in line %d. State preserved.\n\n",
+				glob->c_line);
+		}
+
+		display(glob, args_);
+		fflush(stdout);
+	}
+
+	if (wfd >= 0) {
+		close(wfd);
+	}
+
 	/* clearing alloc'ed memory. */
+	destroy_prog(prog);
+	unmap_src(src);
 	destroy_glob(glob);
-	destroy_table(table);
 
 	return flag;
-}
\ No newline at end of file
+}
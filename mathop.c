@@ -4,8 +4,7 @@
  *        a) ADD
  *        b) SUB
  *        c) MUL
- *        d) DIV
- *        e) CMP
+ *        d) CMP
  */
 
 #include <assert.h>
@@ -14,10 +13,33 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "alu.h"
 #include "mathop.h"
+#include "spec.h"
+#include "tengine.h"
+
+/* ADD, SUB and CMP of a register and [op2] of the given kind. */
+#define ALU_FORM(f_id, opc, k1)                                       \
+	int f_id(glob_t *glob, char *buf, unsigned long size) {           \
+		operand_t *ops = glob->instr->ops;                            \
+		int res, dval = SPEC_VAL_REG(glob, &ops[0]);                  \
+		int ret = alu(glob, opc, dval, SPEC_VAL_##k1(glob, &ops[1]),  \
+			ops[0].width, &res);                                      \
+                                                                      \
+		if (!(ret & ALU_STORE)) {                                     \
+			return ret;                                               \
+		}                                                             \
+		return (ret & ALU_OK) &                                       \
+			put_op_val(glob, res, &ops[0]);                           \
+	}
+
+ALU_FORM(add_r_i, OPC_ADD, IMM)
+ALU_FORM(add_r_r, OPC_ADD, REG)
+ALU_FORM(cmp_r_i, OPC_CMP, IMM)
+ALU_FORM(cmp_r_r, OPC_CMP, REG)
 
 /**
- * @desc  : Implements the ADD instruction.
+ * @desc  : Implements the ADD, SUB, MUL and CMP instructions.
  * @param : glob -
  *          buf  - unused
  *          size - unused
@@ -30,108 +52,53 @@ int math_op(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
-	int ret = 1;
 	/* Let AX (accumulator) be the default destination */
-	char *ptr = get_reg_ptr(glob, REG_AX);
+	operand_t acc = {OP_REG, R_AX, 16, 0, 0, 0};
 
-	char *inst = glob->tokens[0];
-	char *dest = glob->tokens[1];
-	char *src_ = glob->tokens[2];
-	char dval[BUF_SZ], sval[BUF_SZ], res[BUF_SZ];
+	int opc = glob->instr->opc;
+	operand_t *dest = &glob->instr->ops[0];
+	operand_t *src_ = &glob->instr->ops[1];
+	int dval = 0, sval = 0, res = 0;
 
-	if (strcmp(inst, DIV) == 0 || strcmp(inst, MUL) == 0) {
+	if (opc == OPC_MUL) {
 		if (glob->n_op != 1) {
 			char *z = glob->n_op > 1 ? "excess" : "missing";
-			fprintf(stderr, "math_op(): %s - %s instructions.\n", inst, z);
+			fprintf(stderr, "math_op(): %s - %s instructions.\n", glob->instr->mnem, z);
 			return 0;
 		}
 
 		/**
-		 * DIV & MUL take only 1 operand.
+		 * MUL takes only 1 operand.
 		 * The default and the destination operand is AX (accumulator).
 		 */
-		dest = REG_AX;
-		src_ = glob->tokens[1];
+		dest = &acc;
+		src_ = &glob->instr->ops[0];
 	}
 
-	int ret1 = get_op_val(glob, dest, dval, sizeof(dval));
-	int ret2 = get_op_val(glob, src_, sval, sizeof(sval));
+	int ret1 = get_op_val(glob, dest, &dval);
+	int ret2 = get_op_val(glob, src_, &sval);
 
 	if (ret1 ^ ret2) {
 		return 0;
 	}
 
-	int c_dval = (int)strtol(dval, NULL, 16);
-	int c_sval = (int)strtol(sval, NULL, 16);
-	
-	c_dval = (int16_t)c_dval;
-	c_sval = (int16_t)c_sval;
-
-	if (strcmp(inst, ADD) == 0) {
-		int ans = c_dval + c_sval;
-		glob->flags->zf = ans == 0;
-		
-		if (ans > 32767 || ans < -32768) {
-			strcpy(res, "0");
-			glob->flags->of = 1;
-			fprintf(stderr, "Overflow: operand value exceeds the limits.\n");
-			ret = 0;
-		} else {
-			sprintf(res, "%d", ans);
-		}
-	} else if (strcmp(inst, SUB) == 0) {
-		/* Answer is 0. Set zero flag */
-		if (c_dval == c_sval) {
-			glob->flags->zf = 1;
-		}
+	int width = OP_WIDTH(dest);
+	int c_dval = VAL_SIGNED(dval, width);
+	int c_sval = VAL_SIGNED(sval, OP_WIDTH(src_));
 
-		sprintf(res, "%d", c_dval - c_sval);
-	} else if (strcmp(inst, MUL) == 0) {
-		sprintf(res, "%d", c_dval * c_sval);
-		goto set;
-	} else if (strcmp(inst, DIV) == 0) {
-		sprintf(res, "%d", c_dval / c_sval);
-		goto set;
-	} else if (strcmp(inst, CMP) == 0) {
-		if (c_dval < c_sval) {
-			glob->flags->cf = 1;
-		} else if (c_dval == c_sval) {
-			glob->flags->zf = 1;
-		}
-		return 1;
-	} else {
-		return 0;
+	int ret = alu(glob, opc, c_dval, c_sval, width, &res);
+	if (!(ret & ALU_STORE)) {
+		return ret;
 	}
 
-	/**
-	 * Set the destination pointer. 
-	 * This part is skipped if the default destination has been set to
-	 * AX (accumulator).
-	 */
-	if (is_op_addr(dest)) {
-		char addr[BUF_SZ];
-		memset(addr, 0, sizeof(addr));
-		memcpy(addr, &dest[1], strlen(dest) - 2);
-		
-		for (int i = 0; i < strlen(addr); i++) {
-			if (!isdigit(addr[i])) {
-				fprintf(stderr, "move(): invalid address [%s].\n", addr);
-				return 0;
-			}
-		}
-
-		int offset = (int)strtol(addr, NULL, 0);
-		ptr = add_to_mem(glob, 0, offset)->val;
-	} else if (is_op_reg(dest)) {
-		ptr = get_reg_ptr(glob, dest);
+	/* MUL leaves dest set to AX (accumulator). */
+	if (dest->kind != OP_MEM && dest->kind != OP_REG) {
+		fprintf(stderr, "math_op(): invalid destination operand.\n");
+		return 0;
 	}
 
-	/**
-	 * We skip to this part if AX (accumulator) has been decided as the
-	 * default destination.
-	 */
-	set:
-	assert(ptr);
+	return (ret & ALU_OK) & put_op_val(glob, res, dest);
+}
 
-	return ret & get_op_val(glob, res, ptr, BUF_SZ);
-}
\ No newline at end of file
+ALU_FORM(sub_r_i, OPC_SUB, IMM)
+ALU_FORM(sub_r_r, OPC_SUB, REG)
@@ -4,8 +4,7 @@
  *        a) ADD
  *        b) SUB
  *        c) MUL
- *        d) DIV
- *        e) CMP
+ *        d) CMP
  */
 
 #ifndef _ASE_MATH_
@@ -14,12 +13,12 @@
 #include "glob.h"
 #include "parse.h"
 
-#define ADD "ADD"
-#define CMP "CMP"
-#define DIV "DIV"
-#define MUL "MUL"
-#define SUB "SUB"
+int add_r_i (glob_t *glob, char *buf, unsigned long size);
+int add_r_r (glob_t *glob, char *buf, unsigned long size);
+int cmp_r_i (glob_t *glob, char *buf, unsigned long size);
+int cmp_r_r (glob_t *glob, char *buf, unsigned long size);
+int math_op (glob_t *glob, char *buf, unsigned long size);
+int sub_r_i (glob_t *glob, char *buf, unsigned long size);
+int sub_r_r (glob_t *glob, char *buf, unsigned long size);
 
-int math_op(glob_t *glob, char *buf, unsigned long size);
-
-#endif
\ No newline at end of file
+#endif
@@ -10,7 +10,22 @@
 #include <string.h>
 #include <malloc.h>
 
+#include "alu.h"
 #include "mem.h"
+#include "probe.h"
+#include "spec.h"
+
+/* MOV specialised on [op1] and [op2] kinds, see move(). */
+#define MOVE_FORM(f_id, k0, k1)                                       \
+	int f_id(glob_t *glob, char *buf, unsigned long size) {           \
+		operand_t *ops = glob->instr->ops;                            \
+		int val;                                                      \
+                                                                      \
+		if (!SPEC_GET_##k1(glob, &ops[1], &val)) {                    \
+			return 0;                                                 \
+		}                                                             \
+		return SPEC_SET_##k0(glob, &ops[0], val);                     \
+	}
 
 /**
  * @desc  : Implements the HLT instruction.
@@ -20,6 +35,7 @@
  * @return: int  - 0 if fail, 1 if success.
  */ 
 int hlt(glob_t *glob, char *buf, unsigned long size) {
+	PROBE(halt, glob->c_line);
 	return -1;
 }
 
@@ -36,44 +52,34 @@ int move(glob_t *glob, char *buf, unsigned long size) {
 		return 1;
 	}
 
-	char *dest = glob->tokens[1];
-	char *src_ = glob->tokens[2];
+	operand_t *dest = &glob->instr->ops[0];
+	operand_t *src_ = &glob->instr->ops[1];
 
 	/* Strict size checking */
-	if (is_op_reg(dest) && is_op_reg(src_) &&
-	   (get_reg_size(dest) != get_reg_size(src_))) {
+	if (dest->kind == OP_REG && src_->kind == OP_REG && dest->width != src_->width) {
 		fprintf(stderr, "move(): both registers must be of same size.\n");
 		return 0;
 	}
 
-	if (!is_valid_op(dest)) {
+	if (dest->kind != OP_MEM && dest->kind != OP_REG) {
 		fprintf(stderr, "move(): invalid destination operand.\n");
 		return 0;
 	}
 
-	if (is_op_addr(dest)) {
-		char addr[BUF_SZ];
-		memset(addr, 0, sizeof(addr));
-		memcpy(addr, &dest[1], strlen(dest) - 2);
-		
-		for (int i = 0; i < strlen(addr); i++) {
-			if (!isdigit(addr[i])) {
-				fprintf(stderr, "move(): invalid address [%s].\n", addr);
-				return 0;
-			}
-		}
-
-		int offset = (int)strtol(addr, NULL, 0);
-		dest = add_to_mem(glob, glob->mem->ds, offset)->val;
-	}
-
-	if (is_op_reg(dest)) {
-		dest = get_reg_ptr(glob, dest);
+	int val;
+	if (!get_op_val(glob, src_, &val)) {
+		return 0;
 	}
 
-	return get_op_val(glob, src_, dest, BUF_SZ);
+	return set_op_val(glob, dest, val);
 }
 
+MOVE_FORM(move_m_i, MEM, IMM)
+MOVE_FORM(move_m_r, MEM, REG)
+MOVE_FORM(move_r_i, REG, IMM)
+MOVE_FORM(move_r_m, REG, MEM)
+MOVE_FORM(move_r_r, REG, REG)
+
 /**
  * @desc  : Implements the NEG instruction.
  * @param : glob -
@@ -88,43 +94,21 @@ int neg(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	assert(glob->n_op == 1);
-	char *op = glob->tokens[1], *ptr = NULL;
-
-	if (is_op_addr(op)) {
-		char addr[BUF_SZ];
-		memcpy(addr, &op[1], BUF_SZ);
-		int offset = (int)strtol(addr, NULL, 0);
+	operand_t *op = &glob->instr->ops[0];
+	int val;
 
-		mem_nodes_t *node = get_mem_node(glob, offset);
-		if (node) {
-			ptr = node->val;
-		}
-	}
-
-	if (is_op_reg(op)) {
-		ptr = get_reg_ptr(glob, op);
-	}
-
-	if (!ptr) {
-		fprintf(stderr, "neg(): Invalid operand specified [%s].\n", op);
+	if ((op->kind != OP_REG && op->kind != OP_MEM) || !get_op_val(glob, op, &val)) {
+		fprintf(stderr, "neg(): Invalid operand specified.\n");
 		return 0;
 	}
 
-	int temp = (int)strtol(ptr, NULL, 16) * -1;
-	sprintf(ptr, "%x", temp);
-	return 1;
+	int width = OP_WIDTH(op), res;
+	alu(glob, OPC_NEG, VAL_SIGNED(val, width), 0, width, &res);
+	return set_op_val(glob, op, res);
 }
 
-/**
- * @desc  : Implements the NOP instruction.
- * @param : glob -
- *          buf  - unused
- *          size - unused
- * @return: int  - 0 if fail, 1 if success.
- */  
-int nop(glob_t *glob, char *buf, unsigned long size) {
-	return 1;
-}
+/* NOP is defined in mem.h, this emits its external definition. */
+extern int nop(glob_t *glob, char *buf, unsigned long size);
 
 /**
  * 
@@ -141,34 +125,18 @@ int unary(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	assert(glob->n_op == 1);
-	char *ptr = NULL;
-	char *op = glob->tokens[1];
-	int uop = strcmp(glob->tokens[0], "INC") == 0 ? 1 : -1;
-
-	if (is_op_addr(op)) {
-		char addr[BUF_SZ];
-		memcpy(addr, &op[1], strlen(op) - 2);
-		int offset = (int)strtol(addr, NULL, 0);
-
-		mem_nodes_t *node = get_mem_node(glob, offset);
-		if (node) {
-			ptr = node->val;
-		}
-	}
-
-	if (is_op_reg(op) && !ptr) {
-		ptr = get_reg_ptr(glob, op);
-	}
+	operand_t *op = &glob->instr->ops[0];
+	int opc = glob->instr->opc;
+	int val;
 
-	if (!ptr) {
-		fprintf(stderr, "unary(): Invalid operand specified [%s].\n", op);
+	if ((op->kind != OP_REG && op->kind != OP_MEM) || !get_op_val(glob, op, &val)) {
+		fprintf(stderr, "unary(): Invalid operand specified.\n");
 		return 0;
 	}
 
-	char val[BUF_SZ];
-	memcpy(val, ptr, BUF_SZ);
-	sprintf(ptr, "%x", (int)strtol(val, 0, 16) + uop);
-	return 1;
+	int width = OP_WIDTH(op), res;
+	alu(glob, opc, VAL_SIGNED(val, width), 0, width, &res);
+	return set_op_val(glob, op, res);
 }
 
 /**
@@ -186,61 +154,45 @@ int xchg(glob_t *glob, char *buf, unsigned long size) {
 	}
 
 	assert(glob->n_op == 2);
-	char *dest = glob->tokens[1];
-	char *src  = glob->tokens[2];
+	int vals[2];
 
-	if (is_op_addr(src) && is_op_addr(dest)) {
+	if (glob->instr->ops[0].kind == OP_MEM && glob->instr->ops[1].kind == OP_MEM) {
 		fprintf(stderr, "xchg(): Both the operands cannot be memory addresses.\n");
 		return 0;
 	}
 
-	if (is_op_reg(dest)) {
-		dest = get_reg_ptr(glob, dest);
-	}
+	for (int i = 0; i < 2; i++) {
+		operand_t *op = &glob->instr->ops[i];
 
-	if (is_op_reg(src)) {
-		src = get_reg_ptr(glob, src);
+		if ((op->kind != OP_REG && op->kind != OP_MEM) || !get_op_val(glob, op, &vals[i])) {
+			fprintf(stderr, "xchg(): Invalid operand specified [op%d].\n", i + 1);
+			return 0;
+		}
 	}
 
-	int offset = -1;
-	if (is_op_addr(dest)) {
-		char addr[BUF_SZ];
-		memcpy(addr, &dest[1], strlen(dest) - 2);
-		offset = (int)strtol(addr, NULL, 0);
-	}
+	set_op_val(glob, &glob->instr->ops[0], vals[1]);
+	set_op_val(glob, &glob->instr->ops[1], vals[0]);
 
-	if (is_op_addr(src)) {
-		char addr[BUF_SZ];
-		memcpy(addr, &src[1], strlen(src) - 2);
-		offset = (int)strtol(addr, NULL, 0);
-	}
-
-	if (offset != -1) {
-		mem_nodes_t *node = get_mem_node(glob, offset);
-		if (node) {
-			dest = node->val;
-		} else {
-			
-			if (!glob->mem->warned && !getenv("DIW")) {
-				fprintf(stderr, "xchg(): Using uninitialised memory location [%d:%d]\n",
-				glob->mem->ds,
-				offset);
-			}
-
-			mem_nodes_t *node = add_to_mem(glob, glob->mem->ds, offset);
-			node->seg = glob->mem->ds;
-			node->offset = offset;
-			node->addr = (node->seg * 10) + node->offset;
-			strcpy(node->val, "0");
-
-			dest = node->val;
-		}
-	}
+	return 1;
+}
 
-	char temp[BUF_SZ];
-	memcpy(temp, dest, BUF_SZ);
-	memcpy(dest, src, BUF_SZ);
-	memcpy(src, temp, BUF_SZ);
+/**
+ * @desc  : Implements XCHG of two registers.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 1
+ */
+int xchg_r_r(glob_t *glob, char *buf, unsigned long size) {
+	const operand_t *ops = glob->instr->ops;
+	void *a = SPEC_REG(glob, &ops[0]);
+	void *b = SPEC_REG(glob, &ops[1]);
+
+	/* find_form() leaves mixed widths to xchg(). */
+	int w = ops[0].width;
+	int temp = read_val(a, w);
+	write_val(a, w, read_val(b, w));
+	write_val(b, w, temp);
 
 	return 1;
 }
@@ -14,11 +14,28 @@
 #include "glob.h"
 #include "parse.h"
 
-int hlt  (glob_t *glob, char *buf, unsigned long size);
-int move (glob_t *glob, char *buf, unsigned long size);
-int neg  (glob_t *glob, char *buf, unsigned long size);
-int nop  (glob_t *glob, char *buf, unsigned long size);
-int unary(glob_t *glob, char *buf, unsigned long size);
-int xchg (glob_t *glob, char *buf, unsigned long size);
+int hlt     (glob_t *glob, char *buf, unsigned long size);
+int move    (glob_t *glob, char *buf, unsigned long size);
+int move_m_i(glob_t *glob, char *buf, unsigned long size);
+int move_m_r(glob_t *glob, char *buf, unsigned long size);
+int move_r_i(glob_t *glob, char *buf, unsigned long size);
+int move_r_m(glob_t *glob, char *buf, unsigned long size);
+int move_r_r(glob_t *glob, char *buf, unsigned long size);
+int neg     (glob_t *glob, char *buf, unsigned long size);
+int unary   (glob_t *glob, char *buf, unsigned long size);
+int xchg    (glob_t *glob, char *buf, unsigned long size);
+int xchg_r_r(glob_t *glob, char *buf, unsigned long size);
+
+/**
+ * @desc  : Implements the NOP instruction. Defined here so exec_prog()
+ *          runs it without a call, mem.c holds the external definition.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: int  - 0 if fail, 1 if success.
+ */
+inline int nop(glob_t *glob, char *buf, unsigned long size) {
+	return 1;
+}
 
 #endif
\ No newline at end of file
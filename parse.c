@@ -6,12 +6,138 @@
  */ 
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "flags.h"
 #include "parse.h"
+#include "probe.h"
+#include "scan.h"
+#include "tengine.h"
+
+#define REG_NAME(name) #name,
+
+/* Names of the 16 bit registers, indexed by register id. */
+static const char reg_name[N_REG][3] = {
+	REG_SET(REG_NAME)
+};
+
+/**
+ * @desc  : Finds the register an upper case name stands for.
+ * @param : name - register name.
+ * @return: int  - register id, -1 if name is no register.
+ */
+static int find_reg(const char *name) {
+	if (strlen(name) != 2) {
+		return -1;
+	}
+
+	/* AL .. DL and AH .. DH are the bytes of AX .. DX. */
+	if (name[0] >= 'A' && name[0] <= 'D' && (name[1] == 'H' || name[1] == 'L')) {
+		return R_AX + name[0] - 'A';
+	}
+
+	for (int i = 0; i < N_REG; i++) {
+		if (!strcmp(reg_name[i], name)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Effective address form of each set of BX, BP, SI and DI, -1 if there is none. */
+#define EA_BIT(r) ((r) == R_BX ? 1 : (r) == R_BP ? 2 : (r) == R_SI ? 4 : (r) == R_DI ? 8 : 0)
+#define EA_MAP(name, r1, r2) [EA_BIT(r1) | EA_BIT(r2)] = EA_##name + 1,
+
+static const signed char ea_of[16] = {
+	EA_SET(EA_MAP)
+};
+
+/**
+ * @desc  : Decodes a memory operand, [terms] after an optional segment
+ *          override such as ES:. The terms are BX or BP, SI or DI and
+ *          decimal or hex displacements, joined by + and -.
+ * @param : buf - upper case operand, is_op_addr() holds.
+ *          tok - operand token, for errors.
+ *          ln  - source line number.
+ *          op  - receives the decoded operand.
+ * @return: int - 0 if fail, 1 if success.
+ */
+static int decode_ea(char *buf, const tok_t *tok, int ln, operand_t *op) {
+	int seg = -1, regs = 0;
+	long disp = 0;
+
+	/* Segment override. */
+	if (buf[0] != '[') {
+		buf[2] = '\0';
+		seg = find_reg(buf);
+		if (seg < R_CS) {
+			fprintf(stderr, "Invalid segment [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+			return 0;
+		}
+		buf += 3;
+	}
+
+	buf[strlen(buf) - 1] = '\0';
+	for (char *ptr = &buf[1]; *ptr; ) {
+		int neg = *ptr == '-';
+		ptr += *ptr == '-' || *ptr == '+';
+
+		char term[BUF_SZ];
+		int len = strcspn(ptr, "+-");
+		memcpy(term, ptr, len);
+		term[len] = '\0';
+		ptr += len;
+
+		/* find_reg() takes BL for BX, only 16 bit names are registers here. */
+		int reg = find_reg(term);
+		if (reg >= 0 && !strcmp(term, reg_name[reg])) {
+			int bit = EA_BIT(reg);
+			if (neg || !bit || regs & bit) {
+				fprintf(stderr, "Invalid address [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+				return 0;
+			}
+			regs |= bit;
+			continue;
+		}
+
+		/* Displacement, 1234 or 4D2H. */
+		int hex = len > 1 && term[len - 1] == HEX_FS;
+		term[len - hex] = '\0';
+
+		int valid = len > hex && sc_is(term[0], SC_DIGIT);
+		for (char *x = term; *x; x++) {
+			valid &= sc_is(*x, hex ? SC_HEX : SC_DIGIT) != 0;
+		}
+
+		if (!valid) {
+			fprintf(stderr, "Invalid address [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+			return 0;
+		}
+
+		long val = strtol(term, NULL, hex ? 16 : 10);
+		disp += neg ? -val : val;
+		if (disp > 0xffff || disp < -0xffff) {
+			fprintf(stderr, "Invalid address [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+			return 0;
+		}
+	}
+
+	/* BX with BP, SI with DI, or a bare register-less negative offset. */
+	if (!ea_of[regs] || (!regs && disp < 0)) {
+		fprintf(stderr, "Invalid address [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+		return 0;
+	}
+
+	/* BP addresses the stack. */
+	op->kind = OP_MEM;
+	op->ea   = ea_of[regs] - 1;
+	op->reg  = seg >= 0 ? seg : regs & EA_BIT(R_BP) ? R_SS : R_DS;
+	op->val  = (int)disp;
+	return 1;
+}
 
 /**
  * @desc  : Returns the binary representation of an unsigned number.
@@ -27,6 +153,134 @@ void binary_repr(int x, char *buf, unsigned long size) {
 	}
 }
 
+/**
+ * @desc  : Decodes an operand token into its typed form. Runs once per
+ *          instruction at load time, so handlers never classify strings.
+ * @param : tok - operand token.
+ *          ln  - source line number.
+ *          op  - receives the decoded operand.
+ * @return: int - 0 if fail, 1 if success.
+ */
+int decode_op(const tok_t *tok, int ln, operand_t *op) {
+	char buf[BUF_SZ];
+	memset(op, 0, sizeof(operand_t));
+
+	if (!tok->len) {
+		op->kind = OP_NONE;
+		return 1;
+	}
+
+	tok_str(tok, buf, sizeof(buf));
+	for (char *x = buf; *x; x++) {
+		*x = sc_upper(*x);
+	}
+
+	const int ksz = strlen(buf);
+	char *back = &buf[ksz - 1];
+
+	if (is_op_reg(buf)) {
+		op->kind  = OP_REG;
+		op->reg   = find_reg(buf);
+		op->width = get_reg_size(buf);
+		op->hi    = buf[1] == 'H';
+		return 1;
+	}
+
+	/* BYTE[..] and WORD[..] give the width of a memory operand. */
+	int width = !strncmp(buf, "BYTE", 4) ? 8 : !strncmp(buf, "WORD", 4) ? 16 : 0;
+	if (width && is_op_addr(&buf[4])) {
+		op->width = width;
+		return decode_ea(&buf[4], tok, ln, op);
+	}
+
+	if (is_op_addr(buf)) {
+		return decode_ea(buf, tok, ln, op);
+	}
+
+	long val;
+	int dec = *back != HEX_FS;
+
+	if (!dec) {
+		*back = '\0';
+		if (!*buf || !is_valid_hex(buf)) {
+			fprintf(stderr, "Invalid hex literal [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+			return 0;
+		}
+
+		val = strtol(buf, NULL, 16);
+	} else {
+		const char *ptr = *buf == '-' ? &buf[1] : buf;
+		int valid = *ptr != '\0';
+
+		for (; *ptr; ptr++) {
+			valid &= sc_is(*ptr, SC_DIGIT) != 0;
+		}
+
+		if (!valid) {
+			fprintf(stderr, "Invalid operand [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+			return 0;
+		}
+
+		val = strtol(buf, NULL, 10);
+	}
+
+	if (val > 0xffff || val < -32768) {
+		fprintf(stderr, "Operand value too large [%.*s] @ [%d].\n", tok->len, tok->ptr, ln);
+		return 0;
+	}
+
+	op->kind = OP_IMM;
+	op->val  = (int)val;
+	op->dec  = dec;
+	return 1;
+}
+
+/**
+ * @desc  : Builds the mnemonic and decodes the operands of a tokenised
+ *          instruction, then picks its handler. Operands of jumps are
+ *          labels, those are left to the assembler to resolve. Memory
+ *          operands take their width from the register operand.
+ * @param : instr - tokenised instruction.
+ *          toks  - [instr] [op1] [op2] tokens of the instruction.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+int decode_instr(instr_t *instr, const tok_t *toks) {
+	tok_str(&toks[0], instr->mnem, sizeof(instr->mnem));
+	for (char *x = instr->mnem; *x; x++) {
+		*x = sc_upper(*x);
+	}
+	instr->opc = find_opcode(instr->mnem);
+
+	for (int i = 0; i < 2; i++) {
+		operand_t *op = &instr->ops[i];
+
+		if (*instr->mnem == 'J' && toks[i + 1].len) {
+			memset(op, 0, sizeof(operand_t));
+			op->kind = OP_LABEL;
+		} else if (!decode_op(&toks[i + 1], instr->line, op)) {
+			return 0;
+		}
+	}
+
+	/* A memory operand of no width is as wide as the register with it. */
+	for (int i = 0; i < 2; i++) {
+		operand_t *op = &instr->ops[i], *other = &instr->ops[!i];
+
+		if (op->kind != OP_MEM || other->kind != OP_REG) {
+			continue;
+		}
+
+		if (op->width && op->width != other->width) {
+			fprintf(stderr, "Operand size mismatch @ [%d].\n", instr->line);
+			return 0;
+		}
+		op->width = other->width;
+	}
+
+	instr->form = find_form(instr);
+	return 1;
+}
+
 /**
  * @desc  : Returns the size of the register.
  * @param : reg - Size of the register that is required.
@@ -43,13 +297,12 @@ int get_reg_size(char *reg) {
 		return 0;
 	}
 
-	switch (reg[1]) {
-	case 'H':               /* Upper 8 bit register. */
-	case 'L': return 8;     /* Lower 8 bit register. */
-	case 'X': return 16;    /* 16 bit register.      */
+	/* Upper or lower 8 bit register, else 16 bit. */
+	if (reg[0] <= 'D' && (reg[1] == 'H' || reg[1] == 'L')) {
+		return 8;
 	}
 
-	return 0;
+	return 16;
 }
 
 /**
@@ -63,19 +316,13 @@ int is_op_reg(char *op) {
 		return 0;
 	}
 
-	if (strlen(op) != 2) {
-		return 0;
-	}
-
-	if (op[0] >= 'A' && op[0] <= 'D') {
-		return (op[1] == 'H' || op[1] == 'L' || op[1] == 'X');
-	}
-
-	return 0;
+	return find_reg(op) >= 0;
 }
 
 /**
- * @desc  : Returns if the specified location is a mem location.
+ * @desc  : Returns if the specified location is a mem location - [...],
+ *          or XS:[...] with a segment override. What is between the
+ *          brackets is left to decode_ea().
  * @param : op - location to check for.
  * @return: int - 0 if no, 1 if yes.
  */
@@ -85,36 +332,14 @@ int is_op_addr(char *op) {
 		return 0;
 	}
 
-	const int ksz = strlen(op);
-	/* Address must begin and end with square brackets */
-	int ret = (op[0] == '[' && op[ksz - 1] == ']') ?
-	          1 : 0;
-
-	for (int i = 1; i < ksz - 1; i++) {
-		if (!isdigit(op[i])) {
-			ret = 0;
-		}
-	}
-
-	return ret;
-}
-
-/**
- * @desc  : Validates if given address is a valid address form.
- * @param : addr - address to validate
- * @return: int - 0 if no, 1 if yes.
- */
-int is_valid_addr(char *addr) {
-	char *ptr = addr;
-	while (*ptr) {
-		if (!isdigit(*ptr)) {
-			return 0;
-		}
-
-		ptr++;
+	/* Skip the segment override. */
+	if (strlen(op) > 3 && op[2] == ':') {
+		op += 3;
 	}
 
-	return 1;
+	const int ksz = strlen(op);
+	/* Address must begin and end with square brackets, with something in between. */
+	return ksz > 2 && op[0] == '[' && op[ksz - 1] == ']';
 }
 
 /**
@@ -125,8 +350,7 @@ int is_valid_addr(char *addr) {
 int is_valid_hex(char *hex) {
 	char *ptr = hex;
 	while (*ptr) {
-		if ((!isalpha(*ptr) && !isdigit(*ptr)) ||
-		    (isalpha(*ptr) && toupper(*ptr) > 'F')) {
+		if (!sc_is(*ptr, SC_HEX)) {
 			return 0;
 		}
 		
@@ -136,26 +360,6 @@ int is_valid_hex(char *hex) {
 	return 1;
 }
 
-/**
- * @desc  : Returns if the specified operand is valid.
- * @param : op  - operand to validate.
- * @return: int - 0 if no, 1 if yes.
- */
-int is_valid_op(char *op) {
-	if (!op) {
-		fprintf(stderr, "Invalid op - points to NULL.\n");
-		return 0;
-	}
-
-	/**
-	 * An operand is valid if it is:
-	 * 	a) A value (hex?)
-	 * 	b) Is a memory location
-	 * 	c) Is a register
-	 */
-	return is_valid_hex(op) ^ is_op_addr(op) ^ is_op_reg(op);
-}
-
 /**
  * @desc  : Implements the JMP instruction.
  * @param : glob -
@@ -167,16 +371,13 @@ int is_valid_op(char *op) {
  */
 int jump(glob_t *glob, char *buf, unsigned long size) {
 	if (buf) {
+		flags_sync(glob->flags);
 		switch (*buf) {
 		/* buf - REG_CX - JCXZ */
 		case 'C': {
 			int diff = strcmp(buf, REG_CX);
 			if (!diff) {
-				char val[BUF_SZ];
-				char *ptr = get_reg_ptr(glob, REG_CX);
-				memcpy(val, ptr, sizeof(val));
-
-				if (strcmp(val, "0") != 0) {
+				if (glob->registers->x[R_CX] != 0) {
 					/* JCXZ condition failed. */
 					return 1;
 				} else {
@@ -227,47 +428,15 @@ int jump(glob_t *glob, char *buf, unsigned long size) {
 		}
 	}
 
-	/* Jump */
-	char line[BUF_SZ], to_label[BUF_SZ];
-	memcpy(to_label, glob->tokens[1], sizeof(to_label));
-
-	int ln = -1;
-	for (int i = 0; i < glob->idx; i++) {
-		if (strcmp(glob->label_locs[i].label, to_label) == 0) {
-			ln = glob->label_locs[i].line;
-		}
-	}
-
-	if (ln != -1) {
-		while (glob->c_line != ln) {
-			step_back(glob);
-			char line[1024] = {0};
-			fgets(line, sizeof(line), glob->fd);
-		}
-
-		assert(parse_line(glob, line));
-		return 1;
-	}
-
-	while (fgets(line, sizeof(line), glob->fd) != NULL) {
-		if (should_skip_ln(line)) {
-			continue;
-		}
-
-		/* Lets hope that the parser is good enough. */
-		if (!parse_line(glob, line)) {
-			fprintf(stderr, "Could not parse line.\n");
-			return 0;
-		}
-
-		int diff = strcmp(glob->label, to_label);
-		if (diff == 0) {
-			fseek(glob->fd, -(glob->c_len), SEEK_CUR);
-			return 1;
-		}
+	/* Jump - the target was resolved by the assembler. */
+	if (glob->instr->target < 0) {
+		fprintf(stderr, "jump(): Undefined label.\n");
+		return 0;
 	}
 
-	return 0;
+	PROBE(jump, glob->c_line, glob->instr->opc, glob->instr->target);
+	glob->ip = glob->instr->target;
+	return 1;
 }
 
 /**
@@ -289,7 +458,7 @@ int jump_cx(glob_t *glob, char *buf, unsigned long size) {
  * @return: 0 if fail, 1 if success.
  */
 int jump_jx(glob_t *glob, char *buf, unsigned long size) {
-	const char *instr = glob->tokens[0];
+	const char *instr = glob->instr->mnem;
 	const char back   = instr[strlen(instr) - 1];
 
 	switch (back) {
@@ -309,7 +478,7 @@ int jump_jx(glob_t *glob, char *buf, unsigned long size) {
  * @return: 0 if fail, 1 if success.
  */
 int jump_jnx(glob_t *glob, char *buf, unsigned long size) {
-	const char *instr = glob->tokens[0];
+	const char *instr = glob->instr->mnem;
 	const char back   = instr[strlen(instr) - 1];
 
 	switch (back) {
@@ -321,6 +490,25 @@ int jump_jnx(glob_t *glob, char *buf, unsigned long size) {
 	return 0;
 }
 
+/**
+ * @desc  : Makes instr the current instruction of glob.
+ * @param : glob  -
+ *          instr - instruction to load.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+int load_instr(glob_t *glob, instr_t *instr) {
+	if (!glob || !instr) {
+		fprintf(stderr, "load_instr(): nullptr received.\n");
+		return 0;
+	}
+
+	glob->c_line = instr->line;
+	glob->n_op = instr->n_op;
+	glob->instr = instr;
+
+	return 1;
+}
+
 /**
  * @desc  : Tokenises the given source line into [instr] [op1] [op2].
  * @param : glob -
@@ -329,32 +517,142 @@ int jump_jnx(glob_t *glob, char *buf, unsigned long size) {
  */
 int parse_line(glob_t *glob, char *line) {
 	assert(glob && line);
-	for (int i = 0; i < 3; i++) {
-		assert(glob->tokens[i]);
+
+	tok_t toks[3], label;
+
+	glob->c_line++;
+	if (!tokenize(line, line + strlen(line), glob->c_line, &glob->parsed, toks, &label) ||
+	    !decode_instr(&glob->parsed, toks)) {
+		return 0;
 	}
 
-	memset(glob->label, 0, BUF_SZ);
-	for (int i = 0; i <= 2; i++) {
-		memset(glob->tokens[i], 0, sizeof(glob->tokens[i]));
+	return load_instr(glob, &glob->parsed);
+}
+
+/**
+ * @desc  : Determines if the line should be skipped.
+ * @param : line - line to verify.
+ * @return: int  - 0 if no, 1 if yes.
+ * 
+ * 
+ */
+int should_skip_ln(const char *line) {
+	return (!line || line[0] == ';' || line[0] == '\n');
+}
+
+/**
+ * @desc  : Copies a token view into a NUL terminated buffer.
+ * @param : tok  - token to copy.
+ *          buf  - buffer that receives the token.
+ *          size - size of the buffer.
+ * @return: void
+ */
+void tok_str(const tok_t *tok, char *buf, unsigned long size) {
+	unsigned long len = tok->len < size ? tok->len : size - 1;
+
+	/* An empty token may have no text to point at. */
+	buf[0] = '\0';
+	if (!len) {
+		return;
 	}
 
-	glob->c_line++;
-	glob->p_len = glob->c_len;
-	glob->c_len = strlen(line);
+	memcpy(buf, tok->ptr, len);
+	buf[len] = '\0';
+}
+
+/**
+ * @desc  : Skips white space, walking the masks of scan_line().
+ * @param : m   - masks of the line, moved along past 64 bytes.
+ *          ptr - first char to look at.
+ *          end - one past the last char of the line.
+ * @return: const char* - the first other char, or end.
+ */
+static const char *skip_space(scan_mask_t *m, const char *ptr, const char *end) {
+	while (ptr < end) {
+		if (ptr >= m->base + m->len) {
+			scan_line(ptr, end, m);
+		}
+
+		unsigned long long bits = m->word >> (ptr - m->base);
+		if (bits) {
+			return ptr + __builtin_ctzll(bits);
+		}
+
+		ptr = m->base + m->len;
+	}
+
+	return end;
+}
+
+/**
+ * @desc  : Finds the first white space character or ';', walking the
+ *          masks of scan_line().
+ * @param : m   - masks of the line, moved along past 64 bytes.
+ *          ptr - first char to look at.
+ *          end - one past the last char of the line.
+ * @return: const char* - the delimiter, or end.
+ */
+static const char *find_delim(scan_mask_t *m, const char *ptr, const char *end) {
+	while (ptr < end) {
+		if (ptr >= m->base + m->len) {
+			scan_line(ptr, end, m);
+		}
+
+		unsigned long long bits = m->delim >> (ptr - m->base);
+		if (bits) {
+			return ptr + __builtin_ctzll(bits);
+		}
+
+		ptr = m->base + m->len;
+	}
+
+	return end;
+}
+
+/**
+ * @desc  : Tokenises a source line into [instr] [op1] [op2] views.
+ *          The line is neither modified nor copied, every token points
+ *          back into it.
+ * @param : line  - first char of the line.
+ *          end   - one past the last char of the line.
+ *          ln    - source line number.
+ *          instr - receives the operand count and line.
+ *          toks  - receives the [instr] [op1] [op2] tokens.
+ *          label - receives the label, len is 0 if there is none.
+ * @return: int   - 0 if fail, 1 if success.
+ */
+int tokenize(const char *line, const char *end, int ln, instr_t *instr,
+             tok_t *toks, tok_t *label) {
+	assert(line && end && instr && toks && label);
 
 	int i = 0;
 	int flag = 0;
-	char *ptr = strtok(line, " ");
+	const char *ptr = line;
+
+	memset(instr, 0, sizeof(instr_t));
+	memset(toks, 0, 3 * sizeof(tok_t));
+	label->ptr = NULL;
+	label->len = 0;
+	instr->line = ln;
+	instr->target = -1;
 
-	while (ptr) {
+	scan_mask_t m;
+	scan_line(line, end, &m);
+
+	while ((ptr = skip_space(&m, ptr, end)) < end) {
 		/* Skip if comment line begins. */
 		if (*ptr == ';') {
 			break;
 		}
 
+		const char *tok = ptr;
+		ptr = find_delim(&m, ptr + 1, end);
+
+		int len = ptr - tok;
+
 		/* There's a space between label and colon? */
-		if (*ptr == ':') {
-			fprintf(stderr, "Valid label syntax: Label: [instr] [operands] @ [%d].\n", glob->c_line);
+		if (*tok == ':') {
+			fprintf(stderr, "Valid label syntax: Label: [instr] [operands] @ [%d].\n", ln);
 			return 0;
 		}
 
@@ -364,28 +662,25 @@ int parse_line(glob_t *glob, char *line) {
 			return 0;
 		}
 
-		if (i == 0) {
-			char *x = ptr;
-			while (*x) {
-				*x = toupper(*x);
-				x++;
-			}
-		}
-
-		if (*ptr == ',') {
+		if (*tok == ',') {
 			/* Are we expecting a comma? Are we parsing op2? */
 			if (flag && i > 1) {
 				flag = 0;
-				goto l1;
-			} else {
-				fprintf(stderr, "Unexpected character [,].\n");
-				return 0;
+				continue;
 			}
+
+			fprintf(stderr, "Unexpected character [,].\n");
+			return 0;
 		}
 
 		/* Token can begin only with alpha-numeric chars or a '['. */
-		if (!isalnum(*ptr) && *ptr != '[' && *ptr != '-') {
-			fprintf(stderr, "Unexpected character [%c].\n", *ptr);
+		if (!sc_is(*tok, SC_ALNUM) && *tok != '[' && *tok != '-') {
+			fprintf(stderr, "Unexpected character [%c].\n", *tok);
+			return 0;
+		}
+
+		if (len >= BUF_SZ) {
+			fprintf(stderr, "Token too long @ [%d].\n", ln);
 			return 0;
 		}
 
@@ -393,73 +688,30 @@ int parse_line(glob_t *glob, char *line) {
 		 * Check if comment line begins. No space between op and ';' perhaps?
 		 * Eg: instr op1 op2; This is a comment line.
 		 */
-		char *end = strchr(ptr, ';');
-		if (end) {
-			/* Clip off the end and return */
-			*end = '\0';
-			memcpy(glob->tokens[i], ptr, BUF_SZ);
-			i++;
+		if (ptr < end && *ptr == ';') {
+			toks[i].ptr = tok;
+			toks[i++].len = len;
 			break;
 		}
 
-		char *back = &ptr[strlen(ptr) - 1];
-		/* Check for label. */
-		if (*back == ':') {
-			*back = '\0';
-			memcpy(glob->label, ptr, BUF_SZ);
-			memcpy(glob->label_locs[glob->idx].label, ptr, BUF_SZ);
-			glob->label_locs[glob->idx++].line = glob->c_line;
-
-			/* Do not count label as a token. */
-			goto l1;
+		/* Check for label. Do not count label as a token. */
+		if (tok[len - 1] == ':') {
+			label->ptr = tok;
+			label->len = len - 1;
+			continue;
 		}
 
-		if (!isalnum(*back) && *back != ']') {
-			*back = '\0';
+		if (!sc_is(tok[len - 1], SC_ALNUM) && tok[len - 1] != ']') {
+			len--;
 		} else {
 			/* We're expecting a comma. */
 			flag = 1;
 		}
 
-		memcpy(glob->tokens[i], ptr, BUF_SZ);
-		i++;
-
-		l1:
-		ptr = strtok(NULL, " ");
+		toks[i].ptr = tok;
+		toks[i++].len = len;
 	}
 
-	glob->n_op = i - 1;
+	instr->n_op = i - 1;
 	return 1;
-}
-
-/**
- * @desc  : Determines if the line should be skipped.
- * @param : line - line to verify.
- * @return: int  - 0 if no, 1 if yes.
- * 
- * 
- */
-int should_skip_ln(char *line) {
-	return (!line || line[0] == ';' || line[0] == '\n');
-}
-
-/**
- * @desc  : Used by jump instructions to step back.
- * @param : glob -
- * @return: int  - 0 if fail, 1 if success.
- */
-int step_back(glob_t *glob) {
-	if (!glob) {
-		fprintf(stderr, "Invalid glob - points to NULL.\n");
-		return 0;
-	}
-
-	if (!glob->fd) {
-		fprintf(stderr, "Invalid fd - points to NULL.\n");
-		return 0;
-	}
-
-	glob->c_line--;
-	fseek(glob->fd, -(glob->c_len + glob->p_len), SEEK_CUR);
-	return fseek(glob->fd, -(glob->c_len), SEEK_CUR) == 0;
 }
\ No newline at end of file
@@ -15,18 +15,21 @@
 #define HEX_FS  'H'
 
 void binary_repr    (int x, char *buf, unsigned long size);
+int  decode_instr   (instr_t *instr, const tok_t *toks);
+int  decode_op      (const tok_t *tok, int ln, operand_t *op);
 int  get_reg_size   (char *reg);
 int  is_op_reg      (char *op);
 int  is_op_addr     (char *op);
-int  is_valid_addr  (char *addr);
 int  is_valid_hex   (char *hex);
-int  is_valid_op    (char *op);
 int  jump           (glob_t *glob, char *buf, unsigned long size);
 int  jump_cx        (glob_t *glob, char *buf, unsigned long size);
 int  jump_jx        (glob_t *glob, char *buf, unsigned long size);
 int  jump_jnx       (glob_t *glob, char *buf, unsigned long size);
+int  load_instr     (glob_t *glob, instr_t *instr);
 int  parse_line     (glob_t *glob, char *line);
-int  should_skip_ln (char *line);
-int  step_back      (glob_t *glob);
+int  should_skip_ln (const char *line);
+void tok_str        (const tok_t *tok, char *buf, unsigned long size);
+int  tokenize       (const char *line, const char *end, int ln,
+                     instr_t *instr, tok_t *toks, tok_t *label);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * @file: plugin.c
+ * @desc: Defines the function that loads a plugin and binds the
+ *        instructions it adds into the opcode table, next to the
+ *        built-in ones. Plugins stay loaded until the emulator exits.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include "bind.h"
+#include "plugin.h"
+
+/**
+ * @desc  : Loads a shared object and binds the instructions it adds to
+ *          free opcodes. A plugin built for another ABI is unloaded
+ *          before any of its instructions is looked at.
+ * @param : path - path of the shared object.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int load_plugin(const char *path) {
+	if (!path) {
+		fprintf(stderr, "load_plugin(): nullptr received.\n");
+		return 0;
+	}
+
+	void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!lib) {
+		fprintf(stderr, "load_plugin(): %s.\n", dlerror());
+		return 0;
+	}
+
+	const plugin_t *plugin = dlsym(lib, PLUGIN_SYM);
+	if (!plugin) {
+		fprintf(stderr, "load_plugin(): %s does not export [%s].\n", path, PLUGIN_SYM);
+		dlclose(lib);
+		return 0;
+	}
+
+	if (plugin->abi != PLUGIN_ABI) {
+		fprintf(stderr, "load_plugin(): %s was built for ABI %u, this is ABI %u.\n",
+			path, plugin->abi, PLUGIN_ABI);
+		dlclose(lib);
+		return 0;
+	}
+
+	if (plugin->glob_sz != sizeof(glob_t)) {
+		fprintf(stderr, "load_plugin(): %s was built against another glob_t.\n", path);
+		dlclose(lib);
+		return 0;
+	}
+
+	for (int i = 0; i < plugin->n; i++) {
+		const plugin_instr_t *ins = &plugin->instrs[i];
+		if (!ins->mnem || !ins->f_ptr || ins->n_ops < 0 || ins->n_ops > 2) {
+			fprintf(stderr, "load_plugin(): Invalid instruction [%d] in [%s].\n", i, plugin->name);
+			dlclose(lib);
+			return 0;
+		}
+	}
+
+	/**
+	 * Mnemonics are checked by add_opcode(). Those bound before a bad one
+	 * stay bound, so the plugin stays loaded once one is.
+	 */
+	for (int i = 0; i < plugin->n; i++) {
+		const plugin_instr_t *ins = &plugin->instrs[i];
+		opc_t opc = add_opcode(ins->mnem);
+		if (opc == OPC_BAD) {
+			fprintf(stderr, "load_plugin(): Could not bind [%s] of [%s].\n", ins->mnem, plugin->name);
+			if (!i) {
+				dlclose(lib);
+			}
+			return 0;
+		}
+
+		instr_set[opc].n_ops = ins->n_ops;
+		instr_set[opc].f_ptr = ins->f_ptr;
+	}
+
+	return 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file: plugin.h
+ * @desc: Declares the interface between the emulator and the shared
+ *        objects that add instructions to it, and the function loading
+ *        them. Plugins include this header.
+ */
+
+#ifndef _ASE_PLUGIN_H_
+#define _ASE_PLUGIN_H_
+
+#include <stdint.h>
+
+#include "glob.h"
+
+/**
+ * Version of the plugin interface. Bump it whenever plugin_t,
+ * plugin_instr_t, the handler signature or glob_t change, plugins built
+ * against another version are rejected before anything else is read.
+ */
+#define PLUGIN_ABI 6
+
+/* Symbol a plugin exports its plugin_t under. */
+#define PLUGIN_SYM "ase_plugin"
+
+typedef struct plugin_instr {
+	/**
+	 * mnem  - Upper case mnemonic, 7 characters at most.
+	 * n_ops - Number of operands the instruction takes.
+	 * f_ptr - Handler, called like any built-in one - glob->instr is the
+	 *         instruction, 0 if fail, 1 if success, -1 to halt.
+	 */
+	const char *mnem;
+	int n_ops;
+	int (*f_ptr)(glob_t *glob, char *buf, unsigned long size);
+} plugin_instr_t;
+
+typedef struct plugin {
+	/**
+	 * abi     - PLUGIN_ABI the plugin was built against, comes first so
+	 *           it can be checked whatever the rest looks like.
+	 * glob_sz - sizeof(glob_t) the plugin was built against.
+	 * name    - Name of the plugin, for messages.
+	 * n       - Number of instructions.
+	 * instrs  - Instructions the plugin adds.
+	 */
+	uint32_t abi, glob_sz;
+	const char *name;
+	int n;
+	const plugin_instr_t *instrs;
+} plugin_t;
+
+/* Defines the plugin_t of a plugin adding the instructions of the array instrs. */
+#define PLUGIN(name, instrs) \
+	const plugin_t ase_plugin = {PLUGIN_ABI, sizeof(glob_t), name, \
+		sizeof(instrs) / sizeof(*(instrs)), instrs}
+
+int load_plugin (const char *path);
+
+#endif
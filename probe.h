@@ -0,0 +1,69 @@
+/**
+ * @file: probe.h
+ * @desc: Declares the static tracepoints of the emulator. Each one is a
+ *        single NOP until a tracer such as bpftrace or perf attaches to
+ *        it, e.g.
+ *
+ *          bpftrace -e 'usdt:./ase:ase:instr { @[str(arg2)] = count(); }'
+ *
+ *        Built without them where <sys/sdt.h> is missing, or with
+ *        -DPROBE_OFF.
+ */
+
+#ifndef _ASE_PROBE_H_
+#define _ASE_PROBE_H_
+
+#if !defined(PROBE_OFF) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+/* Every probe gets a semaphore, see PROBE_SEM(). */
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define PROBE_ON
+#endif
+#endif
+
+/* The probes by name - X(name). */
+#define PROBE_SET(X) X(instr) X(jump) X(mem) X(push) X(pop) X(halt)
+
+/**
+ * The probes, provider "ase" - PROBE(name, args...).
+ *
+ *   instr (line, opc, mnem, kind0, reg0, val0, kind1, reg1, val1)
+ *                   - an instruction is about to run, operands as
+ *                     decoded in operand_t.
+ *   jump  (line, opc, target)
+ *                   - a jump is taken, target is an instruction index.
+ *   mem   (line, opc, seg, offset, addr)
+ *                   - a memory word is written, addr is seg:offset
+ *                     as a physical address.
+ *   push  (line, opc, sp, val)
+ *   pop   (line, opc, sp, val)
+ *                   - a value went on or came off the stack at SS:sp.
+ *   halt  (line)    - HLT ran.
+ *
+ * exec_prog(), superinstructions and translated blocks fire them as
+ * call_instr() does, instr once for every instruction run.
+ */
+#ifdef PROBE_ON
+#define PROBE(...) STAP_PROBEV(ase, __VA_ARGS__)
+
+/**
+ * Semaphore of a probe, non-zero while a tracer is attached to it.
+ * Code translated by jit.c has no probe sites of its own, it tests the
+ * semaphore and calls out to fire the probe. Defined in glob.c.
+ */
+#define PROBE_SEM(name) ase_##name##_semaphore
+#define PROBE_SEM_DECL(name) extern unsigned short PROBE_SEM(name);
+
+PROBE_SET(PROBE_SEM_DECL)
+#else
+#define PROBE(...) ((void)0)
+#endif
+
+/* The instr probe, for the instruction being fetched - in, not instr, which names the probe. */
+#define PROBE_INSTR(in)                                                        \
+	PROBE(instr, (in)->line, (in)->opc, (in)->mnem,                            \
+		(in)->ops[0].kind, (in)->ops[0].reg, (in)->ops[0].val,                 \
+		(in)->ops[1].kind, (in)->ops[1].reg, (in)->ops[1].val)
+
+#endif
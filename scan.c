@@ -0,0 +1,120 @@
+/**
+ * @file: scan.c
+ * @desc: Defines the character scanner used by the tokeniser.
+ *
+ *        Characters are classified through 256 entry tables built at
+ *        compile time. Token boundaries are found a block at a time:
+ *        every byte of the block is compared against the delimiters at
+ *        once, giving a bit mask per line that the tokeniser walks
+ *        with count-trailing-zeros instead of testing each byte.
+ *        The AVX2 path is used when built with -mavx2, SSE2 is always
+ *        there on x86-64, anything else (or -DSCAN_SCALAR) falls back
+ *        to the tables.
+ */
+
+#include "scan.h"
+
+#if !defined(SCAN_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_BLK 32
+#elif !defined(SCAN_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_BLK 16
+#endif
+
+#define CLASS(c) (                                                            \
+	((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n' ?               \
+	 SC_SPACE | SC_DELIM : 0) |                                            \
+	((c) == ';' ? SC_DELIM : 0) |                                           \
+	((c) >= '0' && (c) <= '9' ? SC_DIGIT | SC_HEX : 0) |                    \
+	((c) >= 'A' && (c) <= 'Z' ? SC_ALPHA : 0) |                             \
+	((c) >= 'a' && (c) <= 'z' ? SC_ALPHA : 0) |                             \
+	(((c) >= 'A' && (c) <= 'F') || ((c) >= 'a' && (c) <= 'f') ? SC_HEX : 0))
+
+#define UPCASE(c) ((c) >= 'a' && (c) <= 'z' ? (c) - 'a' + 'A' : (c))
+
+#define ROW(f, c) f(c), f(c + 1), f(c + 2),  f(c + 3),  f(c + 4),  f(c + 5),  \
+                  f(c + 6),  f(c + 7),  f(c + 8),  f(c + 9),  f(c + 10),      \
+                  f(c + 11), f(c + 12), f(c + 13), f(c + 14), f(c + 15)
+#define TABLE(f)  ROW(f, 0x00), ROW(f, 0x10), ROW(f, 0x20), ROW(f, 0x30),    \
+                  ROW(f, 0x40), ROW(f, 0x50), ROW(f, 0x60), ROW(f, 0x70),    \
+                  ROW(f, 0x80), ROW(f, 0x90), ROW(f, 0xa0), ROW(f, 0xb0),    \
+                  ROW(f, 0xc0), ROW(f, 0xd0), ROW(f, 0xe0), ROW(f, 0xf0)
+
+const unsigned char sc_class[256]  = { TABLE(CLASS) };
+const unsigned char sc_upcase[256] = { TABLE(UPCASE) };
+
+#ifdef SCAN_BLK
+/**
+ * Lines are mostly shorter than a block. A load that stays within the
+ * page of ptr cannot fault, so the block is read whole and the bits
+ * past the end of the line are masked off. AddressSanitizer would
+ * report those reads, so it is turned off for the block scan.
+ */
+#define SAME_PAGE(ptr) (((unsigned long)(ptr) & 4095) <= 4096 - SCAN_BLK)
+
+/**
+ * @desc  : Compares a block against the white space characters and ';'.
+ * @param : ptr   - block, SCAN_BLK bytes must be readable.
+ *          space - receives the white space mask, bit i is ptr[i].
+ *          semi  - receives the ';' mask.
+ * @return: void
+ */
+__attribute__((no_sanitize_address))
+static inline void scan_blk(const char *ptr, unsigned int *space, unsigned int *semi) {
+#if SCAN_BLK == 32
+	__m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+	__m256i m = _mm256_or_si256(
+		_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+		                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+		_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+		                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+	*space = (unsigned int)_mm256_movemask_epi8(m);
+	*semi = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+#else
+	__m128i v = _mm_loadu_si128((const __m128i *)ptr);
+	__m128i m = _mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+		             _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+		_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+		             _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+	*space = (unsigned int)_mm_movemask_epi8(m);
+	*semi = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+#endif
+}
+#endif
+
+/**
+ * @desc  : Classifies the next (up to) 64 bytes of a line in one go, so
+ *          the tokeniser finds token boundaries with bit operations.
+ * @param : ptr - first byte to classify.
+ *          end - one past the last byte of the line, ptr < end.
+ *          m   - receives the masks.
+ * @return: void
+ */
+__attribute__((no_sanitize_address))
+void scan_line(const char *ptr, const char *end, scan_mask_t *m) {
+	int len = end - ptr < 64 ? (int)(end - ptr) : 64;
+	unsigned long long space = 0, semi = 0;
+	int i = 0;
+
+#ifdef SCAN_BLK
+	for (; i < len && (len - i >= SCAN_BLK || SAME_PAGE(ptr + i)); i += SCAN_BLK) {
+		unsigned int s, c;
+		scan_blk(ptr + i, &s, &c);
+		space |= (unsigned long long)s << i;
+		semi |= (unsigned long long)c << i;
+	}
+#endif
+
+	for (; i < len; i++) {
+		space |= (unsigned long long)!!sc_is(ptr[i], SC_SPACE) << i;
+		semi |= (unsigned long long)(ptr[i] == ';') << i;
+	}
+
+	unsigned long long valid = len == 64 ? ~0ull : (1ull << len) - 1;
+	m->base = ptr;
+	m->len = len;
+	m->word = ~space & valid;
+	m->delim = (space | semi) & valid;
+}
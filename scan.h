@@ -0,0 +1,43 @@
+/**
+ * @file: scan.h
+ * @desc: Declares the character scanner used by the tokeniser - lookup
+ *        tables that classify characters, and a block scan that finds
+ *        the token boundaries of a line 16 (SSE2) or 32 (AVX2) bytes
+ *        at a time.
+ */
+
+#ifndef _ASE_SCAN_H_
+#define _ASE_SCAN_H_
+
+/* Character classes, see sc_class. */
+#define SC_SPACE 0x01   /* Space, tab, CR and LF.  */
+#define SC_DIGIT 0x02   /* 0-9.                    */
+#define SC_ALPHA 0x04   /* A-Z, a-z.               */
+#define SC_HEX   0x08   /* 0-9, A-F, a-f.          */
+#define SC_DELIM 0x10   /* Ends a token: SC_SPACE and ';'. */
+
+#define SC_ALNUM (SC_DIGIT | SC_ALPHA)
+
+/* Tests c against a class, unlike <ctype.h> it ignores the locale. */
+#define sc_is(c, cls) (sc_class[(unsigned char)(c)] & (cls))
+#define sc_upper(c)   (sc_upcase[(unsigned char)(c)])
+
+extern const unsigned char sc_class[256];
+extern const unsigned char sc_upcase[256];
+
+/* Classifies up to 64 bytes of a line, bit i stands for base[i]. */
+typedef struct scan_mask {
+	/**
+	 * base  - first byte covered.
+	 * len   - number of bytes covered, 1 to 64.
+	 * word  - bytes that are not white space.
+	 * delim - bytes that end a token, see SC_DELIM.
+	 */
+	const char *base;
+	int len;
+	unsigned long long word, delim;
+} scan_mask_t;
+
+void scan_line (const char *ptr, const char *end, scan_mask_t *m);
+
+#endif
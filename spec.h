@@ -0,0 +1,40 @@
+/**
+ * @file: spec.h
+ * @desc: Operand accessors of the handlers specialised on operand kinds
+ *        (see FORM_SET in tengine.h). Each one expands to the code of a
+ *        single kind, so the handlers built from them check nothing at
+ *        run time.
+ */
+
+#ifndef _ASE_SPEC_H_
+#define _ASE_SPEC_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glob.h"
+
+/* Register or byte of one a register operand names, see get_op_ptr(). */
+#define SPEC_REG(glob, op) spec_reg((glob), (op))
+
+/* Reads the value of an operand into *val, as get_op_val() does. */
+#define SPEC_GET_REG(glob, op, val) (*(val) = read_val(SPEC_REG(glob, op), (op)->width), 1)
+#define SPEC_GET_IMM(glob, op, v)   (*(v) = (op)->val & 0xffff, 1)
+#define SPEC_GET_MEM(glob, op, val) get_op_val((glob), (op), (val))
+
+/* Writes val to an operand, as set_op_val() does. */
+#define SPEC_SET_REG(glob, op, val) (write_val(SPEC_REG(glob, op), (op)->width, (val)), 1)
+#define SPEC_SET_MEM(glob, op, val) mem_store((glob), (op), (val))
+
+/* Value of an operand as a signed number, as math_op() reads it. */
+#define SPEC_VAL_REG(glob, op) VAL_SIGNED(read_val(SPEC_REG(glob, op), (op)->width), (op)->width)
+#define SPEC_VAL_IMM(glob, op) ((int16_t)((op)->val & 0xffff))
+
+static inline void *spec_reg(glob_t *glob, const operand_t *op) {
+	registers_t *regs = glob->registers;
+	return op->width == 8 ? (void *)&regs->b[REG_BYTE(op->reg, op->hi)] : (void *)&regs->x[op->reg];
+}
+
+#endif
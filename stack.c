@@ -12,8 +12,68 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "probe.h"
+#include "spec.h"
 #include "stack.h"
 
+/**
+ * @desc  : Pops the word at SS:SP into val, SP goes up by 2.
+ * @param : glob -
+ *          val  - receives the value.
+ * @return: 0 if fail, 1 if success.
+ */
+static int pop_val(glob_t *glob, int *val) {
+	if (glob->stack->top == -1) {
+		fprintf(stderr, "Illegal instruction: POP before PUSH.\n");
+		return 0;
+	}
+
+	uint16_t *sp = &glob->registers->x[R_SP];
+	*val = mem_read(glob->mem, STACK_PA(glob, 0), 16);
+	PROBE(pop, glob->c_line, glob->instr->opc, *sp, *val);
+
+	*sp += 2;
+	glob->stack->top--;
+	return 1;
+}
+
+/**
+ * @desc  : Pushes val, once ret tells it was read - SP goes down by 2
+ *          and val is written to SS:SP.
+ * @param : glob -
+ *          ret  - what reading val returned.
+ *          val  - value to push.
+ * @return: int  - ret, 0 if the stack is full.
+ */
+static inline int push_val(glob_t *glob, int ret, int val) {
+	if (glob->stack->top + 1 >= STACK_MAX) {
+		fprintf(stderr, "push(): Stack overflow.\n");
+		return 0;
+	}
+
+	uint16_t *sp = &glob->registers->x[R_SP];
+	*sp -= 2;
+	if (!mem_write(glob->mem, STACK_PA(glob, 0), 16, val)) {
+		*sp += 2;
+		return 0;
+	}
+
+	glob->stack->top++;
+	if (ret == 1) {
+		PROBE(push, glob->c_line, glob->instr->opc, *sp, val);
+	}
+
+	return ret;
+}
+
+/* PUSH specialised on the kind of [op1], see push(). */
+#define PUSH_FORM(f_id, k0)                                           \
+	int f_id(glob_t *glob, char *buf, unsigned long size) {           \
+		int val = 0;                                                  \
+		int ret = SPEC_GET_##k0(glob, &glob->instr->ops[0], &val);    \
+		return push_val(glob, ret, val);                              \
+	}
+
 /**
  * @desc  : Implements 8086 POP function.
  * @param : glob -
@@ -27,40 +87,37 @@ int pop(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
-	char *op = glob->tokens[1];
-	char *dest = NULL;
-
-	if (is_op_addr(op)) {
-		char addr[BUF_SZ];
-		memset(addr, 0, sizeof(addr));
-		memcpy(addr, &op[1], strlen(op) - 2);
-
-		for (int i = 0; i < strlen(addr); i++) {
-			if (!isdigit(addr[i])) {
-				fprintf(stderr, "pop(): invalid address [%s].\n", addr);
-				return 0;
-			}
-		}
-
-		int offset = (int)strtol(addr, NULL, 0);
-		dest = add_to_mem(glob, 0, offset)->val;
-		
-	} else if (is_op_reg(op)) {
-		dest = get_reg_ptr(glob, op);
+	operand_t *op = &glob->instr->ops[0];
+	int val;
+
+	if (op->kind != OP_MEM && op->kind != OP_REG) {
+		fprintf(stderr, "pop(): Invalid operand specified.\n");
+		return 0;
 	}
 
-	assert(dest);
-	int idx = glob->stack->top--;
-	if (idx == -1) {
-		fprintf(stderr, "Illegal instruction: POP before PUSH.\n");
+	if (!pop_val(glob, &val)) {
 		return 0;
 	}
-	
-	char *s_ptr = glob->stack->arr[idx];
-	int ret = get_op_val(glob, s_ptr, dest, -1);
-	free(glob->stack->arr[idx]);
 
-	return ret;
+	return set_op_val(glob, op, val);
+}
+
+/**
+ * @desc  : Implements POP into a register.
+ * @param : glob -
+ *          buf  - unused
+ *          size - unused
+ * @return: 0 if fail, 1 if success.
+ */
+int pop_r(glob_t *glob, char *buf, unsigned long size) {
+	const operand_t *op = &glob->instr->ops[0];
+	int val;
+
+	if (!pop_val(glob, &val)) {
+		return 0;
+	}
+
+	return SPEC_SET_REG(glob, op, val);
 }
 
 /**
@@ -76,17 +133,10 @@ int push(glob_t *glob, char *buf, unsigned long size) {
 		return 0;
 	}
 
-	int idx = ++glob->stack->top;
-	char *op = glob->tokens[1];
-	char **s_ptr = &glob->stack->arr[idx];
-
-	if (!s_ptr) {
-		return 0;
-	}
-
-	if (!*s_ptr) {
-		*s_ptr = malloc((unsigned long)BUF_SZ);
-	}
+	int val = 0;
+	int ret = get_op_val(glob, &glob->instr->ops[0], &val);
+	return push_val(glob, ret, val);
+}
 
-	return get_op_val(glob, op, *s_ptr, size);
-}
\ No newline at end of file
+PUSH_FORM(push_i, IMM)
+PUSH_FORM(push_r, REG)
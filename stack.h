@@ -12,7 +12,10 @@
 #include "glob.h"
 #include "parse.h"
 
-int pop  (glob_t *glob, char *buf, unsigned long size);
-int push (glob_t *glob, char *buf, unsigned long size);
+int pop   (glob_t *glob, char *buf, unsigned long size);
+int pop_r (glob_t *glob, char *buf, unsigned long size);
+int push  (glob_t *glob, char *buf, unsigned long size);
+int push_i(glob_t *glob, char *buf, unsigned long size);
+int push_r(glob_t *glob, char *buf, unsigned long size);
 
 #endif
@@ -0,0 +1,400 @@
+/**
+ * @file: stream.c
+ * @desc: Defines the pipelined assembler. A producer thread tokenises
+ *        and decodes the source while the emulator already executes
+ *        the instructions decoded so far.
+ *
+ *        Decoded instructions and labels travel through a lock-free
+ *        single producer, single consumer ring. The execution loop is
+ *        the only consumer and the only owner of the program, so it
+ *        may grow the instruction array and the label table freely. It
+ *        blocks only when it reaches an instruction, or a jump to a
+ *        label, that the producer has not decoded yet. Either side
+ *        polls the ring for a while, then sleeps until the other one
+ *        moves.
+ */
+
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "stream.h"
+
+/* Producer may go on - a slot is free or it was asked to stop. */
+static int can_produce(stream_t *st) {
+	unsigned int head = atomic_load_explicit(&st->head, memory_order_relaxed);
+	return head - atomic_load_explicit(&st->tail, memory_order_acquire) != STREAM_SZ ||
+	       atomic_load_explicit(&st->stop, memory_order_relaxed);
+}
+
+/* Consumer may go on - a message is waiting. */
+static int can_consume(stream_t *st) {
+	unsigned int tail = atomic_load_explicit(&st->tail, memory_order_relaxed);
+	return atomic_load_explicit(&st->head, memory_order_acquire) != tail;
+}
+
+/**
+ * @desc  : Waits until ready(st) holds, polling STREAM_SPIN times with
+ *          a yield in between before sleeping on st->cond.
+ * @param : st    - stream.
+ *          ready - can_produce or can_consume.
+ * @return: void
+ */
+static void wait_for(stream_t *st, int (*ready)(stream_t *st)) {
+	for (int i = 0; i < STREAM_SPIN; i++) {
+		if (ready(st)) {
+			return;
+		}
+
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&st->lock);
+	atomic_fetch_add(&st->waiting, 1);
+	while (!ready(st)) {
+		pthread_cond_wait(&st->cond, &st->lock);
+	}
+
+	atomic_fetch_sub(&st->waiting, 1);
+	pthread_mutex_unlock(&st->lock);
+}
+
+/**
+ * @desc  : Wakes the other side if it sleeps. Called after head, tail
+ *          or stop moved; the fence orders that store before the load
+ *          of waiting, wait_for() checks again after raising it. Each
+ *          side calls it every STREAM_BATCH messages, so a sleeper is
+ *          not woken, nor the fence paid, for every one.
+ * @param : st - stream.
+ * @return: void
+ */
+static void wake(stream_t *st) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&st->waiting, memory_order_relaxed)) {
+		pthread_mutex_lock(&st->lock);
+		pthread_cond_broadcast(&st->cond);
+		pthread_mutex_unlock(&st->lock);
+	}
+}
+
+/**
+ * @desc  : Waits for a free slot in the ring (producer side).
+ * @param : st      - stream.
+ * @return: smsg_t* - free slot, or NULL if the consumer asked the
+ *                    producer to stop.
+ */
+static smsg_t *reserve(stream_t *st) {
+	wait_for(st, can_produce);
+	if (atomic_load_explicit(&st->stop, memory_order_relaxed)) {
+		return NULL;
+	}
+
+	unsigned int head = atomic_load_explicit(&st->head, memory_order_relaxed);
+	return &st->ring[head & (STREAM_SZ - 1)];
+}
+
+/**
+ * @desc  : Hands the slot returned by reserve() to the consumer.
+ * @param : st - stream.
+ * @return: void
+ */
+static void publish(stream_t *st) {
+	unsigned int head = atomic_load_explicit(&st->head, memory_order_relaxed);
+	int last = st->ring[head & (STREAM_SZ - 1)].type >= SMSG_ERROR;
+
+	atomic_store_explicit(&st->head, ++head, memory_order_release);
+	if (last || !(head % STREAM_BATCH)) {
+		wake(st);
+	}
+}
+
+/**
+ * @desc  : Sends a message without payload (producer side).
+ * @param : st   - stream.
+ *          type - SMSG_ERROR or SMSG_END.
+ *          line - source line.
+ * @return: void
+ */
+static void send(stream_t *st, int type, int line) {
+	smsg_t *msg = reserve(st);
+	if (msg) {
+		msg->type = type;
+		msg->line = line;
+		publish(st);
+	}
+}
+
+/**
+ * @desc  : Producer thread - tokenises and decodes the source.
+ * @param : arg   - stream.
+ * @return: void* - NULL
+ */
+static void *produce(void *arg) {
+	stream_t *st = arg;
+	const char *ptr = st->src->base;
+	const char *end = st->src->base + st->src->len;
+	int ln = 0, idx = 0;
+
+	while (ptr < end) {
+		const char *eol = memchr(ptr, '\n', end - ptr);
+		const char *next = eol ? eol + 1 : end;
+		ln++;
+
+		if (st->n_lines == st->l_cap) {
+			int cap = st->l_cap ? st->l_cap * 2 : 256;
+			unsigned int *lines = realloc(st->lines, cap * sizeof(unsigned int));
+			if (!lines) {
+				fprintf(stderr, "produce(): realloc failure.\n");
+				send(st, SMSG_ERROR, ln);
+				return NULL;
+			}
+
+			st->lines = lines;
+			st->l_cap = cap;
+		}
+
+		st->lines[st->n_lines++] = ptr - st->src->base;
+		if (should_skip_ln(ptr)) {
+			ptr = next;
+			continue;
+		}
+
+		instr_t instr;
+		tok_t toks[3], label;
+		if (!tokenize(ptr, eol ? eol : end, ln, &instr, toks, &label) ||
+		    !decode_instr(&instr, toks)) {
+			fprintf(stderr, "Could not parse line.\n");
+			send(st, SMSG_ERROR, ln);
+			return NULL;
+		}
+
+		smsg_t *msg;
+		if (label.len) {
+			if (!(msg = reserve(st))) {
+				return NULL;
+			}
+
+			msg->type = SMSG_LABEL;
+			msg->tok = label;
+			msg->line = ln;
+			msg->idx = idx;
+			publish(st);
+		}
+
+		/* A line holding only a label adds no instruction. */
+		if (toks[0].len) {
+			if (!(msg = reserve(st))) {
+				return NULL;
+			}
+
+			msg->type = SMSG_INSTR;
+			msg->instr = instr;
+			msg->tok = toks[1];
+			publish(st);
+			idx++;
+		}
+
+		ptr = next;
+	}
+
+	send(st, SMSG_END, ln);
+	return NULL;
+}
+
+/**
+ * @desc  : Marks the stream as failed at the given line.
+ * @param : st   - stream.
+ *          glob -
+ *          line - failing source line.
+ * @return: int  - 0
+ */
+static int fail(stream_t *st, glob_t *glob, int line) {
+	st->failed = st->done = 1;
+	glob->c_line = line;
+	return 0;
+}
+
+/**
+ * @desc  : Receives one message, waiting for it if the ring is empty
+ *          (consumer side).
+ * @param : st   - stream.
+ *          glob -
+ * @return: int  - 0 if the stream ended or failed, 1 if success.
+ */
+static int pull(stream_t *st, glob_t *glob) {
+	unsigned int tail = atomic_load_explicit(&st->tail, memory_order_relaxed);
+
+	/* The producer always ends with SMSG_END or SMSG_ERROR. */
+	wait_for(st, can_consume);
+
+	smsg_t *msg = &st->ring[tail & (STREAM_SZ - 1)];
+	prog_t *prog = st->prog;
+	int ret = 1;
+
+	switch (msg->type) {
+	case SMSG_INSTR:
+		if (prog->n == prog->cap) {
+			int cap = prog->cap ? prog->cap * 2 : 1024;
+			instr_t *instrs = realloc(prog->instrs, cap * sizeof(instr_t));
+			tok_t *refs = realloc(st->refs, cap * sizeof(tok_t));
+
+			prog->instrs = instrs ? instrs : prog->instrs;
+			st->refs = refs ? refs : st->refs;
+			if (!instrs || !refs) {
+				fprintf(stderr, "pull(): realloc failure.\n");
+				ret = fail(st, glob, msg->instr.line);
+				break;
+			}
+
+			prog->cap = st->r_cap = cap;
+		}
+
+		st->refs[prog->n] = msg->tok;
+		prog->instrs[prog->n++] = msg->instr;
+		break;
+
+	case SMSG_LABEL:
+		if (!add_sym(prog->labels, &msg->tok, msg->line, msg->idx)) {
+			ret = fail(st, glob, msg->line);
+		}
+		break;
+
+	case SMSG_ERROR:
+		ret = fail(st, glob, msg->line);
+		break;
+
+	case SMSG_END:
+		st->done = 1;
+		ret = 0;
+		break;
+	}
+
+	atomic_store_explicit(&st->tail, ++tail, memory_order_release);
+	if (!(tail % STREAM_BATCH)) {
+		wake(st);
+	}
+
+	return ret;
+}
+
+/**
+ * @desc  : Stops the producer and hands over the program. The line
+ *          map is complete only if the whole source was decoded.
+ * @param : st      - stream.
+ *          glob    -
+ *          drain   - if set, decode the rest of the source first.
+ * @return: prog_t* - the program, owned by the caller.
+ */
+prog_t *finish_stream(stream_t *st, glob_t *glob, int drain) {
+	if (!st) {
+		return NULL;
+	}
+
+	while (drain && !st->done && pull(st, glob));
+
+	atomic_store_explicit(&st->stop, 1, memory_order_relaxed);
+	wake(st);
+	pthread_join(st->thread, NULL);
+	pthread_mutex_destroy(&st->lock);
+	pthread_cond_destroy(&st->cond);
+
+	prog_t *prog = st->prog;
+	prog->lines = st->lines;
+	prog->n_lines = prog->l_cap = st->n_lines;
+
+	free(st->refs);
+	free(st->ring);
+	free(st);
+
+	return prog;
+}
+
+/**
+ * @desc  : Starts the producer thread on src.
+ * @param : src       - mapped source file.
+ * @return: stream_t* - the stream, or NULL.
+ */
+stream_t *init_stream(src_t *src) {
+	/* head, tail and stop are cache line aligned, calloc() does not honour that. */
+	stream_t *st = aligned_alloc(_Alignof(stream_t), sizeof(stream_t));
+	if (!st) {
+		fprintf(stderr, "init_stream(): malloc failure.\n");
+		return NULL;
+	}
+
+	memset(st, 0, sizeof(stream_t));
+	pthread_mutex_init(&st->lock, NULL);
+	pthread_cond_init(&st->cond, NULL);
+	st->src = src;
+	st->ring = malloc(STREAM_SZ * sizeof(smsg_t));
+	st->prog = calloc(1, sizeof(prog_t));
+	if (st->prog) {
+		st->prog->labels = init_symtab();
+		st->prog->text = src->base;
+		st->prog->text_len = src->len;
+	}
+
+	if (!st->ring || !st->prog || !st->prog->labels ||
+	    pthread_create(&st->thread, NULL, produce, st) != 0) {
+		fprintf(stderr, "init_stream(): Could not start the producer.\n");
+		pthread_mutex_destroy(&st->lock);
+		pthread_cond_destroy(&st->cond);
+		destroy_prog(st->prog);
+		free(st->ring);
+		free(st);
+		return NULL;
+	}
+
+	return st;
+}
+
+/**
+ * @desc  : Returns the instruction at ip, waiting for the producer to
+ *          decode it. The target of a jump is resolved on its first
+ *          execution, waiting for the label if it is not declared yet.
+ * @param : st       - stream.
+ *          glob     -
+ *          ip       - index of the instruction.
+ * @return: instr_t* - the instruction, or NULL at the end of the
+ *                     program or if st->failed is set.
+ */
+instr_t *stream_fetch(stream_t *st, glob_t *glob, int ip) {
+	prog_t *prog = st->prog;
+	while (ip >= prog->n && pull(st, glob));
+
+	if (ip >= prog->n || st->failed) {
+		return NULL;
+	}
+
+	instr_t *instr = &prog->instrs[ip];
+	if (instr->ops[0].kind != OP_LABEL || instr->n_op != 1 || instr->target >= 0) {
+		return instr;
+	}
+
+	tok_t *ref = &st->refs[ip];
+	sym_t *sym;
+
+	while (!(sym = find_sym(prog->labels, ref->ptr, ref->len))) {
+		if (st->done || !pull(st, glob)) {
+			if (!st->failed) {
+				fprintf(stderr, "Undefined label [%.*s] @ [%d].\n",
+					ref->len, ref->ptr, prog->instrs[ip].line);
+				fail(st, glob, prog->instrs[ip].line);
+			}
+
+			return NULL;
+		}
+
+		/* pull() may have moved the arrays. */
+		ref = &st->refs[ip];
+	}
+
+	instr = &prog->instrs[ip];
+	instr->target = sym->idx;
+	return instr;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file: stream.h
+ * @desc: Declares the pipelined assembler. A producer thread tokenises
+ *        and decodes the source while the emulator already executes
+ *        the instructions decoded so far.
+ */
+
+#ifndef _ASE_STREAM_H_
+#define _ASE_STREAM_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "glob.h"
+#include "load.h"
+#include "symtab.h"
+
+/* Number of messages the queue holds, must be a power of 2. */
+#define STREAM_SZ 4096
+
+/* Times a side polls the ring, yielding in between, before it sleeps. */
+#define STREAM_SPIN 64
+
+/* A sleeping side is woken after at most this many messages, not for each. */
+#define STREAM_BATCH (STREAM_SZ / 4)
+
+#define SMSG_INSTR 0
+#define SMSG_LABEL 1
+#define SMSG_ERROR 2
+#define SMSG_END   3
+
+/* Message passed from the producer to the execution loop. */
+typedef struct smsg {
+	/**
+	 * type  - SMSG_INSTR, SMSG_LABEL, SMSG_ERROR or SMSG_END.
+	 * instr - SMSG_INSTR: decoded instruction.
+	 * tok   - SMSG_INSTR: label operand, SMSG_LABEL: label name.
+	 * line  - SMSG_LABEL, SMSG_ERROR: source line.
+	 * idx   - SMSG_LABEL: instruction the label points to.
+	 */
+	int type;
+	instr_t instr;
+	tok_t tok;
+	int line, idx;
+} smsg_t;
+
+typedef struct stream {
+	/**
+	 * Single producer, single consumer ring. head is only written by
+	 * the producer and tail only by the consumer, each on its own
+	 * cache line.
+	 */
+	smsg_t *ring;
+	_Alignas(64) atomic_uint head;
+	_Alignas(64) atomic_uint tail;
+	_Alignas(64) atomic_int stop;
+
+	/**
+	 * A side that found the ring full or empty STREAM_SPIN times sleeps
+	 * on cond. waiting counts the sleepers, the other side signals only
+	 * if it is set.
+	 */
+	_Alignas(64) atomic_int waiting;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	/**
+	 * Producer side.
+	 * src     - mapped source file.
+	 * lines   - line map, handed to prog once the producer is done.
+	 * n_lines - number of entries in lines.
+	 */
+	src_t *src;
+	unsigned int *lines;
+	int n_lines, l_cap;
+	pthread_t thread;
+
+	/**
+	 * Consumer side.
+	 * prog   - program decoded so far.
+	 * refs   - label operand of every instruction in prog.
+	 * done   - set once SMSG_END or SMSG_ERROR was received.
+	 * failed - set if the source could not be assembled.
+	 */
+	prog_t *prog;
+	tok_t *refs;
+	int r_cap, done, failed;
+} stream_t;
+
+prog_t   *finish_stream (stream_t *st, glob_t *glob, int drain);
+stream_t *init_stream   (src_t *src);
+instr_t  *stream_fetch  (stream_t *st, glob_t *glob, int ip);
+
+#endif
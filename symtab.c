@@ -0,0 +1,214 @@
+/**
+ * @file: symtab.c
+ * @desc: Defines the label symbol table - an open addressing hash
+ *        table keyed on the label name.
+ *
+ *        Labels are collected once while assembling, so lookups only
+ *        happen at load time when jump targets are resolved.
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symtab.h"
+
+/**
+ * @desc  : FNV-1a hash of the label name.
+ * @param : name - label name.
+ *          len  - length of the name.
+ * @return: unsigned int - hash value.
+ */
+static unsigned int hash_name(const char *name, int len) {
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)name[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+/**
+ * @desc  : Returns the slot that holds name, or the empty slot where
+ *          name would be inserted.
+ * @param : tab  - symbol table.
+ *          name - label name.
+ *          len  - length of the name.
+ * @return: int* - slot pointer.
+ */
+static int *probe(symtab_t *tab, const char *name, int len) {
+	unsigned int mask = tab->n_slots - 1;
+	unsigned int i = hash_name(name, len) & mask;
+
+	while (tab->slots[i]) {
+		sym_t *sym = &tab->syms[tab->slots[i] - 1];
+		if (sym->name.len == len && !memcmp(sym->name.ptr, name, len)) {
+			break;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	return &tab->slots[i];
+}
+
+/**
+ * @desc  : Doubles the number of hash slots and rehashes all symbols.
+ * @param : tab - symbol table.
+ * @return: int - 0 if fail, 1 if success.
+ */
+static int grow_slots(symtab_t *tab) {
+	int *old = tab->slots;
+	unsigned int n_old = tab->n_slots;
+
+	tab->n_slots = n_old ? n_old * 2 : 64;
+	tab->slots = calloc(tab->n_slots, sizeof(int));
+	if (!tab->slots) {
+		fprintf(stderr, "grow_slots(): malloc failure.\n");
+		tab->slots = old;
+		tab->n_slots = n_old;
+		return 0;
+	}
+
+	for (int i = 0; i < tab->n; i++) {
+		*probe(tab, tab->syms[i].name.ptr, tab->syms[i].name.len) = i + 1;
+	}
+
+	free(old);
+	return 1;
+}
+
+/**
+ * @desc  : Adds a label to the table.
+ * @param : tab  - symbol table.
+ *          name - label name.
+ *          line - source line of the label.
+ *          idx  - instruction the label points to.
+ * @return: int  - 0 if fail or the label already exists, 1 if success.
+ */
+int add_sym(symtab_t *tab, tok_t *name, int line, int idx) {
+	if (!tab || !name) {
+		fprintf(stderr, "add_sym(): nullptr received.\n");
+		return 0;
+	}
+
+	/* Keep the load factor under 1/2. */
+	if ((unsigned int)(tab->n + 1) * 2 > tab->n_slots && !grow_slots(tab)) {
+		return 0;
+	}
+
+	int *slot = probe(tab, name->ptr, name->len);
+	if (*slot) {
+		fprintf(stderr, "Duplicate label [%.*s] @ [%d], first declared @ [%d].\n",
+			name->len, name->ptr, line, tab->syms[*slot - 1].line);
+		return 0;
+	}
+
+	if (tab->n == tab->cap) {
+		int cap = tab->cap ? tab->cap * 2 : 32;
+		sym_t *syms = realloc(tab->syms, cap * sizeof(sym_t));
+		if (!syms) {
+			fprintf(stderr, "add_sym(): realloc failure.\n");
+			return 0;
+		}
+
+		tab->syms = syms;
+		tab->cap = cap;
+	}
+
+	sym_t *sym = &tab->syms[tab->n++];
+	sym->name = *name;
+	sym->line = line;
+	sym->idx = idx;
+	*slot = tab->n;
+
+	return 1;
+}
+
+/**
+ * @desc  : Removes a label from the table. The last symbol takes its
+ *          place in syms, so declaration order is not kept.
+ * @param : tab  - symbol table.
+ *          name - label name.
+ *          len  - length of the name.
+ * @return: int  - 0 if the label is not declared, 1 if success.
+ */
+int del_sym(symtab_t *tab, const char *name, int len) {
+	if (!tab || !tab->n) {
+		return 0;
+	}
+
+	int *slot = probe(tab, name, len);
+	int idx = *slot - 1;
+	if (idx < 0) {
+		return 0;
+	}
+
+	/* Shift the rest of the probe run back over the freed slot. */
+	unsigned int mask = tab->n_slots - 1;
+	unsigned int i = slot - tab->slots, j = i;
+	while (tab->slots[j = (j + 1) & mask]) {
+		sym_t *sym = &tab->syms[tab->slots[j] - 1];
+		unsigned int home = hash_name(sym->name.ptr, sym->name.len) & mask;
+
+		/* Leave it if its home slot lies cyclically in (i, j]. */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+			continue;
+		}
+
+		tab->slots[i] = tab->slots[j];
+		i = j;
+	}
+
+	tab->slots[i] = 0;
+
+	if (idx != tab->n - 1) {
+		sym_t *last = &tab->syms[tab->n - 1];
+		*probe(tab, last->name.ptr, last->name.len) = idx + 1;
+		tab->syms[idx] = *last;
+	}
+
+	tab->n--;
+	return 1;
+}
+
+/**
+ * @desc  : Release memory allocated to the table.
+ * @param : tab - symbol table.
+ * @return: void
+ */
+void destroy_symtab(symtab_t *tab) {
+	if (!tab) {
+		return;
+	}
+
+	free(tab->syms);
+	free(tab->slots);
+	free(tab);
+}
+
+/**
+ * @desc  : Looks up a label.
+ * @param : tab    - symbol table.
+ *          name   - label name.
+ *          len    - length of the name.
+ * @return: sym_t* - the symbol, or NULL if it is not declared.
+ */
+sym_t *find_sym(symtab_t *tab, const char *name, int len) {
+	if (!tab || !tab->n) {
+		return NULL;
+	}
+
+	int slot = *probe(tab, name, len);
+	return slot ? &tab->syms[slot - 1] : NULL;
+}
+
+/**
+ * @desc  : Allocate an empty table.
+ * @param : none
+ * @return: symtab_t* - pointer to the table.
+ */
+symtab_t *init_symtab(void) {
+	return calloc(1, sizeof(symtab_t));
+}
@@ -0,0 +1,42 @@
+/**
+ * @file: symtab.h
+ * @desc: Declares the label symbol table - an open addressing hash
+ *        table keyed on the label name.
+ */
+
+#ifndef _ASE_SYMTAB_H_
+#define _ASE_SYMTAB_H_
+
+#include "glob.h"
+
+typedef struct sym {
+	/**
+	 * name - Label name, a view into the source.
+	 * line - Source line the label is declared on.
+	 * idx  - Index of the instruction the label points to.
+	 */
+	tok_t name;
+	int line, idx;
+} sym_t;
+
+typedef struct symtab {
+	/**
+	 * n       - Number of symbols.
+	 * cap     - Capacity of syms.
+	 * syms    - Symbols in declaration order.
+	 * n_slots - Number of hash slots, always a power of 2.
+	 * slots   - Hash slots, holds (index into syms + 1), 0 if empty.
+	 */
+	int n, cap;
+	sym_t *syms;
+	unsigned int n_slots;
+	int *slots;
+} symtab_t;
+
+int       add_sym        (symtab_t *tab, tok_t *name, int line, int idx);
+int       del_sym        (symtab_t *tab, const char *name, int len);
+void      destroy_symtab (symtab_t *tab);
+sym_t    *find_sym       (symtab_t *tab, const char *name, int len);
+symtab_t *init_symtab    (void);
+
+#endif
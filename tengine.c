@@ -1,145 +1,187 @@
 /**
  * @file: tengine.c
- * @desc: Declares functions that help in binding calls to string and
- *        calling the calls by name.
+ * @desc: Defines the functions that resolve a mnemonic to its opcode and
+ *        an instruction to its handler.
  */ 
 
-#include <ctype.h>
-#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "tengine.h"
 
+#define OPC_NAME(name, f_ptr, n_ops) [OPC_##name] = #name,
+
+static const char opc_name[N_OPC][8] = {
+	INSTR_SET(OPC_NAME)
+};
+
+/* Mnemonics bound by plugins, OPC_EXT + i is named ext_name[i]. */
+static char ext_name[OPC_EXT_MAX][8];
+static int n_ext;
+
+#define FORM_KINDS(name, k0, k1, f_ptr) \
+	{OPC_##name, OP_##k0, OP_##k1, FORM_##name##_##k0##_##k1},
+
+/* Opcode and operand kinds of each specialised handler. */
+static const struct {
+	int opc, k0, k1, form;
+} forms[] = {
+	FORM_SET(FORM_KINDS)
+};
+
 /**
- * @desc  : Call a function from table by it's name.
- * @param : table - table containing the entries.
- *          glob  -
- *          line  - line from source file.
- *          buf   - unused
- *          size  - unused
- * @return: int   - 0 if fail, 1 if success.
+ * Perfect hash of the mnemonics, the slot of a mnemonic is
+ * (packed mnemonic * OPC_HASH_MUL) >> (32 - OPC_HASH_BITS). Generated -
+ * tests/tengine.c prints new slots and a new multiplier when the
+ * instruction set changes.
  */
-int call_by_name(table_t *table, glob_t *glob, char *buf, unsigned long size) {
-	int x = 0;
-	const int klen = strlen(glob->tokens[0]);
-	for (int i = 0; i < klen; i++) {
-		if (isspace(glob->tokens[0][i])) {
-			x++;
+static const unsigned char opc_slot[OPC_HASH_SLOTS] = {
+	[ 1] = OPC_MUL,
+	[ 3] = OPC_PUSH,
+	[ 4] = OPC_INC,
+	[ 8] = OPC_STD,
+	[ 9] = OPC_CMC,
+	[11] = OPC_MOV,
+	[13] = OPC_CLI,
+	[14] = OPC_JPE,
+	[16] = OPC_SUB,
+	[17] = OPC_CMP,
+	[21] = OPC_HLT,
+	[22] = OPC_IN,
+	[23] = OPC_NEG,
+	[26] = OPC_JP,
+	[29] = OPC_ADD,
+	[30] = OPC_CLD,
+	[31] = OPC_LAHF,
+	[32] = OPC_NOP,
+	[34] = OPC_JC,
+	[37] = OPC_STC,
+	[38] = OPC_JMP,
+	[41] = OPC_OUT,
+	[43] = OPC_XCHG,
+	[44] = OPC_JNC,
+	[47] = OPC_POP,
+	[50] = OPC_JNE,
+	[52] = OPC_SAHF,
+	[54] = OPC_ORG,
+	[55] = OPC_STI,
+	[59] = OPC_CLC,
+	[60] = OPC_JCXZ,
+	[62] = OPC_JE,
+	[63] = OPC_DEC,
+};
+
+/**
+ * @desc  : Picks the handler of a decoded instruction - the one
+ *          specialised on its operand kinds if there is one, else the
+ *          generic handler of its opcode.
+ * @param : instr - decoded instruction.
+ * @return: int   - a form_t, or the opc_t of the generic handler.
+ */
+int find_form(const instr_t *instr) {
+	const operand_t *ops = instr->ops;
+
+	for (unsigned long i = 0; i < sizeof(forms) / sizeof(*forms); i++) {
+		if (forms[i].opc != instr->opc ||
+			forms[i].k0 != ops[0].kind || forms[i].k1 != ops[1].kind) {
+			continue;
 		}
-	}
 
-	if (x == klen) {
-		return 1;
-	}
+		/* Operands were counted by tokenize(), kinds only by decode_op(). */
+		int n_op = (ops[0].kind != OP_NONE) + (ops[1].kind != OP_NONE);
+		if (instr->n_op != n_op) {
+			break;
+		}
 
-	entry_t *entry = table->head;
-	while (entry) {
-		if (!strcmp(entry->f_id, glob->tokens[0])) {
-			/* Check if we've the operands required */
-			if (glob->n_op != entry->n_ops) {
-				fprintf(stderr, "call_by_name(): Invalid number of operands [%d] [%s].\n",
-					glob->n_op, entry->f_id);
-				return 0;
-			}
-
-			return entry->f_ptr(glob, buf, size);
+		/* Mixed widths are left to the generic handler to reject. */
+		if (ops[0].kind == OP_REG && ops[1].kind == OP_REG && ops[0].width != ops[1].width) {
+			break;
 		}
 
-		entry = entry->next;
+		return forms[i].form;
 	}
 
-	fprintf(stderr, "Invalid entry [%s]: reached end of the table.\n",
-	        glob->tokens[0]);
-	return 0;
+	return instr->opc;
 }
 
 /**
- * @desc  : Release memory allocated to the table and its entries.
- * @param : table - table containing the entries.
- * @return: void
+ * @desc  : Resolve an upper case mnemonic to its opcode.
+ * @param : mnem  - NUL terminated mnemonic.
+ * @return: opc_t - OPC_NONE if empty, OPC_BAD if unknown.
  */
-void destroy_table(table_t *table) {
-	if (!table) {
-		fprintf(stderr, "Invalid table - points to NULL.\n");
-		return;
+opc_t find_opcode(const char *mnem) {
+	if (!*mnem) {
+		return OPC_NONE;
+	}
+
+	/* Every mnemonic fits in 4 bytes. */
+	uint32_t key = 0;
+	for (int i = 0; i < 4 && mnem[i]; i++) {
+		key |= (uint32_t)(unsigned char)mnem[i] << (8 * i);
+	}
+
+	opc_t opc = opc_slot[(key * OPC_HASH_MUL) >> (32 - OPC_HASH_BITS)];
+	if (opc != OPC_NONE && !strcmp(opc_name[opc], mnem)) {
+		return opc;
 	}
 
-	entry_t *entry = table->head;
-	while (entry) {
-		free(entry->f_id);
-		entry_t *x = entry;
-		entry = entry->next;
-		free(x);
+	/* Only mnemonics missing from the instruction set get here. */
+	for (int i = 0; i < n_ext; i++) {
+		if (!strcmp(ext_name[i], mnem)) {
+			return OPC_EXT + i;
+		}
 	}
 
-	free(table);
+	return OPC_BAD;
 }
 
 /**
- * @desc  : Returns if the specified function's entry exists.
- * @param : table - table containing the entries.
- *          f_id  - binding function name.
- * @return: int   - 0 for fail, 1 for success.
+ * @desc  : Hands out the next free opcode for a mnemonic missing from
+ *          the instruction set.
+ * @param : mnem  - NUL terminated mnemonic, upper case letters and
+ *                  digits, 7 at most, not starting with J.
+ * @return: opc_t - OPC_BAD if the mnemonic is invalid, taken or no
+ *                  opcode is left.
  */
-int entry_exists(table_t *table, char *f_id) {
-	if (!table) {
-		return 0;
+opc_t add_opcode(const char *mnem) {
+	/* Operands of mnemonics starting with J are decoded as labels. */
+	size_t len = strlen(mnem);
+	if (!len || len >= sizeof(*ext_name) || *mnem < 'A' || *mnem > 'Z' || *mnem == 'J') {
+		fprintf(stderr, "add_opcode(): Invalid mnemonic [%s].\n", mnem);
+		return OPC_BAD;
 	}
 
-	entry_t *entry = table->head;
-	while (entry) {
-		if (!strcmp(entry->f_id, f_id)) {
-			return 1;
+	for (const char *x = mnem; *x; x++) {
+		if ((*x < 'A' || *x > 'Z') && (*x < '0' || *x > '9')) {
+			fprintf(stderr, "add_opcode(): Invalid mnemonic [%s].\n", mnem);
+			return OPC_BAD;
 		}
+	}
 
-		entry = entry->next;
+	if (find_opcode(mnem) != OPC_BAD) {
+		fprintf(stderr, "add_opcode(): Mnemonic [%s] is taken.\n", mnem);
+		return OPC_BAD;
 	}
 
-	return 0;
-}
+	if (n_ext == OPC_EXT_MAX) {
+		fprintf(stderr, "add_opcode(): No opcode left for [%s].\n", mnem);
+		return OPC_BAD;
+	}
 
-/**
- * @desc  : Allocate memory to table and return a pointer.
- * @param : none
- * @return: table* - pointer to the table.
- */
-table_t *init_table(void) {
-	table_t *table = malloc(sizeof(table_t));
-	return table;
+	memcpy(ext_name[n_ext], mnem, len + 1);
+	return OPC_EXT + n_ext++;
 }
 
 /**
- * @desc  : Bind a function with specified name.
- * @param : table - table containing the entries.
- *          f_id  - binding function name.
- *          glob  -
- *          line  - line from source file.
- *          buf   - unused
- *          size  - unused
- * @return: int   - 0 if fail, 1 if success.
+ * @desc  : Names an opcode.
+ * @param : opc - opcode.
+ * @return: const char * - mnemonic, empty if the opcode is not bound.
  */
-int register_entry(table_t *table, char *f_id,
-                    int (*f_ptr)(glob_t *glob, char *buf, unsigned long size), int n_ops) {
-	if (!table) {
-		fprintf(stderr, "table - nullptr: register_entry");
-		return 0;
-	}
-
-	entry_t *entry = malloc(sizeof(entry_t));
-	if (entry) {
-		entry->n_ops = n_ops;
-		entry->f_id = malloc(BUFSIZE);
-		memcpy(entry->f_id, f_id, BUFSIZE);
-		entry->f_ptr = f_ptr;
-		table->entries++;
-
-		entry->next = table->head;
-		table->head = entry;
-
-		return 1;
-	} else {
-		fprintf(stderr, "malloc() fail: register_entry");
+const char *opc_mnem(int opc) {
+	if (opc >= OPC_EXT && opc <= OPC_EXT_LAST) {
+		return ext_name[opc - OPC_EXT];
 	}
 
-	return 0;
+	return opc > OPC_NONE && opc < OPC_BAD ? opc_name[opc] : "";
 }
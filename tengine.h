@@ -1,8 +1,8 @@
 /**
  * @file: tengine.h
- * @desc: Declares functions that help in binding calls to string and
- *        calling the calls by name.
- */ 
+ * @desc: Declares the instruction set and the functions that resolve a
+ *        mnemonic to its opcode and an instruction to its handler.
+ */
 
 #ifndef _ASE_T_ENG_
 #define _ASE_T_ENG_
@@ -10,28 +10,106 @@
 #define RESV    "resv"
 #define BUFSIZE 128
 
+/* Slots of the mnemonic hash, see find_opcode(). */
+#define OPC_HASH_BITS  6
+#define OPC_HASH_SLOTS (1 << OPC_HASH_BITS)
+#define OPC_HASH_MUL   0x9e388c53u
+
+/* Opcodes left for plugins to bind mnemonics to, see plugin.c. */
+#define OPC_EXT_MAX    32
+
 #include "glob.h"
-#include "parse.h"
-
-typedef struct entry {
-	char *f_id;
-	int n_ops;
-	int (*f_ptr)(glob_t *glob, char *buf, unsigned long size);
-	struct entry *next;
-} entry_t;
-
-typedef struct table {
-	entry_t *head;
-	unsigned int entries;
-} table_t;
-
-int      call_by_name   (table_t *table, glob_t *glob,
-                         char *buf, unsigned long size);
-void     destroy_table  (table_t *table);
-int      entry_exists   (table_t *table, char *f_id);
-table_t *init_table     (void);
-int      register_entry (table_t *table,
-                         char *f_id,
-                         int (*f_ptr)(glob_t *glob, char *buf, unsigned long size), int n_ops);
+
+/**
+ * The instruction set - X(mnemonic, handler, number of operands). Adding
+ * an instruction here adds its opcode and its entry in bind.c; the hash slots
+ * in tengine.c need to be generated again (see tests/tengine.c).
+ */
+#define INSTR_SET(X)                   \
+	X(ADD,  math_op,    2)             \
+	X(CLC,  clear_flag, 0)             \
+	X(CLD,  clear_flag, 0)             \
+	X(CLI,  clear_flag, 0)             \
+	X(CMC,  cmc,        0)             \
+	X(CMP,  math_op,    2)             \
+	X(DEC,  unary,      1)             \
+	X(HLT,  hlt,        0)             \
+	X(IN,   nop,        2)             \
+	X(INC,  unary,      1)             \
+	X(JCXZ, jump_cx,    1)             \
+	X(JC,   jump_jx,    1)             \
+	X(JE,   jump_jx,    1)             \
+	X(JNC,  jump_jnx,   1)             \
+	X(JNE,  jump_jnx,   1)             \
+	X(JP,   jump_jx,    1)             \
+	X(JPE,  jump_jx,    1)             \
+	X(JMP,  jump,       1)             \
+	X(LAHF, lahf,       0)             \
+	X(MOV,  move,       2)             \
+	X(MUL,  math_op,    1)             \
+	X(NEG,  neg,        1)             \
+	X(NOP,  nop,        0)             \
+	X(ORG,  org,        1)             \
+	X(OUT,  nop,        2)             \
+	X(POP,  pop,        1)             \
+	X(PUSH, push,       1)             \
+	X(SAHF, sahf,       0)             \
+	X(STC,  set_flag,   0)             \
+	X(STD,  set_flag,   0)             \
+	X(STI,  set_flag,   0)             \
+	X(SUB,  math_op,    2)             \
+	X(XCHG, xchg,       2)
+
+/**
+ * Handlers specialised on the operand kinds - X(mnemonic, kind of op1,
+ * kind of op2, handler). Kinds are OP_ without the prefix. Picked by
+ * find_form() when the instruction is decoded; anything else runs on the
+ * generic handler of INSTR_SET.
+ */
+#define FORM_SET(X)                    \
+	X(ADD,  REG, IMM,  add_r_i)        \
+	X(ADD,  REG, REG,  add_r_r)        \
+	X(CMP,  REG, IMM,  cmp_r_i)        \
+	X(CMP,  REG, REG,  cmp_r_r)        \
+	X(MOV,  MEM, IMM,  move_m_i)       \
+	X(MOV,  MEM, REG,  move_m_r)       \
+	X(MOV,  REG, IMM,  move_r_i)       \
+	X(MOV,  REG, MEM,  move_r_m)       \
+	X(MOV,  REG, REG,  move_r_r)       \
+	X(POP,  REG, NONE, pop_r)          \
+	X(PUSH, IMM, NONE, push_i)         \
+	X(PUSH, REG, NONE, push_r)         \
+	X(SUB,  REG, IMM,  sub_r_i)        \
+	X(SUB,  REG, REG,  sub_r_r)        \
+	X(XCHG, REG, REG,  xchg_r_r)
+
+#define OPC_ENUM(name, f_ptr, n_ops) OPC_##name,
+#define FORM_ENUM(name, k0, k1, f_ptr) FORM_##name##_##k0##_##k1,
+
+/**
+ * OPC_NONE - Line without an instruction (empty or label only).
+ * OPC_BAD  - Unknown mnemonic, fails once it is executed.
+ * OPC_EXT  - First of the opcodes add_opcode() hands out to plugins.
+ */
+typedef enum opcode {
+	OPC_NONE,
+	INSTR_SET(OPC_ENUM)
+	OPC_BAD,
+	OPC_EXT,
+	OPC_EXT_LAST = OPC_EXT + OPC_EXT_MAX - 1,
+	N_OPC
+} opc_t;
+
+/* Specialised handlers, numbered on from the opcodes. */
+typedef enum form {
+	FORM_FIRST = N_OPC - 1,
+	FORM_SET(FORM_ENUM)
+	N_FORM
+} form_t;
+
+opc_t       add_opcode  (const char *mnem);
+int         find_form   (const instr_t *instr);
+opc_t       find_opcode (const char *mnem);
+const char *opc_mnem    (int opc);
 
 #endif
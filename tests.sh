@@ -8,7 +8,7 @@ fail=0
 for file in tests/*.c;
 do
 	echo "Running tests: $file"
-	gcc -std=c11 -Wall "$file" flags.c glob.c mathop.c mem.c parse.c stack.c
+	gcc -std=c11 -Wall -pthread "$file" alu.c asm.c batch.c bind.c cache.c display.c emit.c exec.c flags.c fuse.c glob.c jit.c load.c mathop.c mem.c parse.c plugin.c scan.c stack.c symtab.c tengine.c watch.c -rdynamic -ldl
 	./a.out
 
 	if [ $? -eq 1 ]
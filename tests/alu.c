@@ -0,0 +1,133 @@
+/* Unit test for the ALU and the flags it leaves pending [ALU]. */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../alu.h"
+#include "../glob.h"
+
+/* Flags of an operation, worked out the long way. */
+static flags_t expect(int opc, int w, int d, int s, int cf) {
+	int mask = w == 8 ? 0xff : 0xffff, max = mask >> 1;
+	int ud = d & mask, us = s & mask, r = 0;
+	flags_t f = {0};
+
+	switch (opc) {
+	case OPC_ADD: r = d + s; f.cf = ud + us > mask; break;
+	case OPC_SUB:
+	case OPC_CMP: r = d - s; f.cf = ud < us; break;
+	case OPC_MUL: r = d * s; break;
+	case OPC_INC: r = d + 1, s = 1; f.cf = cf; break;
+	case OPC_DEC: r = d - 1, s = 1; f.cf = cf; break;
+	case OPC_NEG: r = -d, s = d, d = 0; f.cf = (s & mask) != 0; break;
+	}
+
+	f.of = r > max || r < -max - 1;
+	if (opc == OPC_MUL) {
+		f.cf = f.of;
+	} else {
+		f.af = ((d ^ s ^ r) >> 4) & 1;
+	}
+
+	f.zf = (r & mask) == 0;
+	f.sf = (r & mask) >> (w - 1);
+	f.pf = __builtin_popcount(r & 0xff) % 2 == 0;
+	return f;
+}
+
+/* Runs an operation on alu(), checks the flags and that they were left pending. */
+static int same_flags(glob_t *glob, int opc, int w, int d, int s) {
+	flags_t *f = glob->flags;
+	int res, cf = (d ^ s) & 1;
+
+	/* INC and DEC keep a carry left pending by an operation before them. */
+	flags_defer(f, LZ_SUB, w, 0, cf, -cf);
+	alu(glob, opc, d, s, w, &res);
+	if (f->lz_op == LZ_NONE) {
+		return 0;
+	}
+
+	flags_t want = expect(opc, w, d, s, cf);
+	flags_sync(f);
+	return f->af == want.af && f->cf == want.cf && f->of == want.of &&
+	       f->pf == want.pf && f->sf == want.sf && f->zf == want.zf;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: ALU - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: ALU - Glob is NULL.\n");
+		return 1;
+	}
+
+	for (int b = 0; b < 256; b++) {
+		if (parity_tab[b] != (__builtin_popcount(b) % 2 == 0)) {
+			fprintf(stderr, "TEST: ALU - Wrong parity of [%x].\n", b);
+			return 1;
+		}
+	}
+
+	const int opcs[] = {OPC_ADD, OPC_SUB, OPC_CMP, OPC_MUL, OPC_INC, OPC_DEC, OPC_NEG};
+	const char *names[] = {"ADD", "SUB", "CMP", "MUL", "INC", "DEC", "NEG"};
+
+	/* Every pair of bytes, and words around the limits. */
+	const int words[] = {-32768, -32767, -256, -129, -128, -17, -16, -1,
+	                     0, 1, 15, 16, 127, 128, 255, 256, 32766, 32767};
+	int n_words = sizeof(words) / sizeof(*words);
+
+	/* ADD reports every sum that does not fit, keep those off the output. */
+	fflush(stderr);
+	int saved = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+	dup2(null, STDERR_FILENO);
+
+	int bad = -1, bad_w = 0, bad_d = 0, bad_s = 0;
+	for (int i = 0; i < 7 && bad < 0; i++) {
+		for (int d = -128; d < 128 && bad < 0; d++) {
+			for (int s = -128; s < 128; s++) {
+				if (!same_flags(glob, opcs[i], 8, d, s)) {
+					bad = i, bad_w = 8, bad_d = d, bad_s = s;
+					break;
+				}
+			}
+		}
+
+		for (int a = 0; a < n_words * n_words && bad < 0; a++) {
+			int d = words[a / n_words], s = words[a % n_words];
+			if (!same_flags(glob, opcs[i], 16, d, s)) {
+				bad = i, bad_w = 16, bad_d = d, bad_s = s;
+			}
+		}
+	}
+
+	fflush(stderr);
+	dup2(saved, STDERR_FILENO);
+	close(saved);
+	close(null);
+
+	if (bad >= 0) {
+		fprintf(stderr, "TEST: ALU - %s of [%d] [%d] on %d bits.\n", names[bad], bad_d, bad_s, bad_w);
+		return 1;
+	}
+
+	/* ADD fails once the sum does not fit, the rest wrap. */
+	int res;
+	if (alu(glob, OPC_ADD, 100, 100, 8, &res) != ALU_STORE ||
+		alu(glob, OPC_ADD, 100, 100, 16, &res) != (ALU_OK | ALU_STORE) ||
+		alu(glob, OPC_INC, 32767, 0, 16, &res) != (ALU_OK | ALU_STORE) || res != 32768) {
+		fprintf(stderr, "TEST: ALU - Wrong overflow handling.\n");
+		return 1;
+	}
+
+	destroy_glob(glob);
+	return 0;
+}
@@ -0,0 +1,113 @@
+/* Unit test for the assembler and label symbol table [ASM]. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../glob.h"
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: ASM - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: ASM - Glob is NULL.\n");
+		return 1;
+	}
+
+	char s_1[] = "ORG 100h\n"
+	             "; comment\n"
+	             "\n"
+	             "L1: MOV CX, 5\n"
+	             "L2:\n"
+	             "DEC CX\n"
+	             "JNE L2\n"
+	             "JMP L3\n"
+	             "L3: HLT";
+	char s_2[] = "L1: NOP\nL1: NOP\n";
+	char s_3[] = "JMP L4\n";
+
+	src_t src = {s_1, strlen(s_1), 0};
+	prog_t *prog = assemble(glob, &src);
+	if (!prog || prog->n != 6) {
+		fprintf(stderr, "TEST: ASM - Could not assemble source.\n");
+		return 1;
+	}
+
+	if (prog->instrs[1].line != 4 || prog->instrs[5].line != 9) {
+		fprintf(stderr, "TEST: ASM - Line map mismatch.\n");
+		return 1;
+	}
+
+	/* JNE L2 -> DEC CX, JMP L3 -> HLT */
+	if (prog->instrs[3].target != 2 || prog->instrs[4].target != 5) {
+		fprintf(stderr, "TEST: ASM - Jump targets not resolved.\n");
+		return 1;
+	}
+
+	sym_t *sym = find_sym(prog->labels, "L2", 2);
+	if (prog->labels->n != 3 || !sym || sym->line != 5 || sym->idx != 2) {
+		fprintf(stderr, "TEST: ASM - Label table mismatch.\n");
+		return 1;
+	}
+
+	destroy_prog(prog);
+
+	src.base = s_2;
+	src.len = strlen(s_2);
+	if (assemble(glob, &src)) {
+		fprintf(stderr, "TEST: ASM - Duplicate label accepted.\n");
+		return 1;
+	}
+
+	src.base = s_3;
+	src.len = strlen(s_3);
+	if (assemble(glob, &src)) {
+		fprintf(stderr, "TEST: ASM - Undefined label accepted.\n");
+		return 1;
+	}
+
+	/* Chunked assembly must match a single pass over the source. */
+	static char s_4[1 << 14];
+	int len = 0;
+	for (int i = 0; i < 200; i++) {
+		len += sprintf(s_4 + len, "L%d: MOV CX, %d\n; comment\nJNE L%d\n", i, i, 199 - i);
+	}
+
+	src.base = s_4;
+	src.len = len;
+	prog_t *seq = assemble(glob, &src);
+	glob->jobs = 7;
+	prog = assemble(glob, &src);
+	if (!seq || !prog || prog->n != seq->n || prog->n_lines != seq->n_lines ||
+	    memcmp(prog->instrs, seq->instrs, seq->n * sizeof(instr_t)) ||
+	    memcmp(prog->lines, seq->lines, seq->n_lines * sizeof(unsigned int)) ||
+	    prog->labels->n != seq->labels->n) {
+		fprintf(stderr, "TEST: ASM - Chunked assembly differs.\n");
+		return 1;
+	}
+
+	sym = find_sym(prog->labels, "L150", 4);
+	if (!sym || sym->line != 451 || sym->idx != 300 || prog->instrs[99].target != 300) {
+		fprintf(stderr, "TEST: ASM - Chunked label table mismatch.\n");
+		return 1;
+	}
+
+	destroy_prog(seq);
+	destroy_prog(prog);
+
+	/* Duplicate across chunks. */
+	src.len += sprintf(s_4 + len, "L0: NOP\n");
+	if (assemble(glob, &src) || glob->c_line != 601) {
+		fprintf(stderr, "TEST: ASM - Duplicate label across chunks accepted.\n");
+		return 1;
+	}
+
+	fclose(fd);
+	return 0;
+}
@@ -0,0 +1,112 @@
+/* Unit test for the batch loader [BATCH]. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../batch.h"
+
+#define N_FILES 100
+
+/* Files seen by one load_batch() run. */
+typedef struct seen {
+	int count[N_FILES];
+	int bad;
+} seen_t;
+
+/* Writes the source of file i, large ones span several read buffers. */
+static size_t make_src(int i, char *buf, size_t cap) {
+	size_t len = 0;
+	int lines = i % 10 == 0 ? 4000 : 1 + i;
+	for (int j = 0; j < lines && len + 32 < cap; j++) {
+		len += snprintf(buf + len, cap - len, "MOV AX, %d\n", i + j);
+	}
+	return len;
+}
+
+static void check_file(void *arg, const char *name, src_t *src) {
+	static char want[64 * 1024];
+	seen_t *seen = arg;
+	int i;
+
+	if (!src || sscanf(name, "f%d.asm", &i) != 1 || i < 0 || i >= N_FILES) {
+		seen->bad++;
+		return;
+	}
+
+	size_t len = make_src(i, want, sizeof(want));
+	if (src->len != len || memcmp(src->base, want, len)) {
+		seen->bad++;
+	}
+	seen->count[i]++;
+}
+
+static int run_batch(const char *dir, int uring) {
+	seen_t seen = {{0}, 0};
+	if (!load_batch(dir, uring, check_file, &seen) || seen.bad) {
+		return 0;
+	}
+
+	for (int i = 0; i < N_FILES; i++) {
+		if (seen.count[i] != 1) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(void) {
+	static char buf[64 * 1024];
+	char dir[] = "/tmp/ase_batchXXXXXX";
+	char path[64];
+
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "TEST: BATCH - Could not create directory.\n");
+		return 1;
+	}
+
+	for (int i = 0; i < N_FILES; i++) {
+		snprintf(path, sizeof(path), "%s/f%d.asm", dir, i);
+		FILE *fd = fopen(path, "w");
+		if (!fd) {
+			fprintf(stderr, "TEST: BATCH - Could not write %s.\n", path);
+			return 1;
+		}
+		fwrite(buf, 1, make_src(i, buf, sizeof(buf)), fd);
+		fclose(fd);
+	}
+
+	/* Not picked up. */
+	snprintf(path, sizeof(path), "%s/notes.txt", dir);
+	FILE *fd = fopen(path, "w");
+	fclose(fd);
+
+	int ok = 1;
+	if (!run_batch(dir, 1)) {
+		fprintf(stderr, "TEST: BATCH - io_uring batch mismatch.\n");
+		ok = 0;
+	}
+
+	if (ok && !run_batch(dir, 0)) {
+		fprintf(stderr, "TEST: BATCH - Thread pool batch mismatch.\n");
+		ok = 0;
+	}
+
+	if (ok && load_batch("/tmp/ase_batch_missing", 0, check_file, NULL)) {
+		fprintf(stderr, "TEST: BATCH - Missing directory loaded.\n");
+		ok = 0;
+	}
+
+	for (int i = 0; i < N_FILES; i++) {
+		snprintf(path, sizeof(path), "%s/f%d.asm", dir, i);
+		unlink(path);
+	}
+	snprintf(path, sizeof(path), "%s/notes.txt", dir);
+	unlink(path);
+	rmdir(dir);
+
+	return !ok;
+}
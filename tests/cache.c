@@ -0,0 +1,148 @@
+/* Unit test for the .aseb bytecode cache [CACHE]. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../asm.h"
+#include "../cache.h"
+#include "../exec.h"
+#include "../fuse.h"
+#include "../glob.h"
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: CACHE - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: CACHE - Glob is NULL.\n");
+		return 1;
+	}
+
+	char s_1[] = "L1: MOV CX, 5\n"
+	             "L2: DEC CX\n"
+	             "JNE L2\n";
+	char path[BUF_SZ];
+	cache_path("tests/ph.asm", path, sizeof(path));
+	if (strcmp(path, "tests/ph.aseb")) {
+		fprintf(stderr, "TEST: CACHE - Unexpected cache path [%s].\n", path);
+		return 1;
+	}
+
+	src_t src = {s_1, strlen(s_1), 0};
+	prog_t *prog = assemble(glob, &src);
+	if (!prog || !save_cache(prog, &src, path)) {
+		fprintf(stderr, "TEST: CACHE - Could not save cache.\n");
+		return 1;
+	}
+
+	prog_t *hit = load_cache(glob, &src, path);
+	if (!hit || !hit->map || hit->n != prog->n ||
+	    memcmp(hit->instrs, prog->instrs, prog->n * sizeof(instr_t))) {
+		fprintf(stderr, "TEST: CACHE - Cached instructions mismatch.\n");
+		return 1;
+	}
+
+	sym_t *sym = find_sym(hit->labels, "L2", 2);
+	if (hit->labels->n != 2 || !sym || sym->idx != 1 || hit->instrs[2].target != 1) {
+		fprintf(stderr, "TEST: CACHE - Cached labels mismatch.\n");
+		return 1;
+	}
+
+	tok_t line = src_line(hit, 3);
+	if (line.len != 6 || strncmp(line.ptr, "JNE L2", 6)) {
+		fprintf(stderr, "TEST: CACHE - Cached line map mismatch.\n");
+		return 1;
+	}
+
+	/* The cached program runs, unfused and fused (-F). */
+	glob->prog = hit;
+	for (int on = 0; on < 2; on++) {
+		reset_glob(glob);
+		if (fuse_prog(hit, on) != on || exec_prog(glob) ||
+		    glob->registers->x[R_CX] != 0 || glob->steps != 11) {
+			fprintf(stderr, "TEST: CACHE - Cached program run mismatch (fused %d).\n", on);
+			return 1;
+		}
+	}
+	glob->prog = NULL;
+
+	/* Fusing leaves the read-only mapping alone, the file is unchanged. */
+	prog_t *again = load_cache(glob, &src, path);
+	if (!again || memcmp(again->instrs, prog->instrs, prog->n * sizeof(instr_t))) {
+		fprintf(stderr, "TEST: CACHE - Fusion leaked into the cache file.\n");
+		return 1;
+	}
+	destroy_prog(again);
+
+	/* Records no build writes, with the hashes still matching - must miss. */
+	aseb_hdr_t hdr;
+	instr_t bad = prog->instrs[2];
+	FILE *cf = fopen(path, "r+b");
+	if (!cf || fread(&hdr, sizeof(hdr), 1, cf) != 1) {
+		fprintf(stderr, "TEST: CACHE - Could not read the cache header.\n");
+		return 1;
+	}
+
+	const int targets[] = {-2, 4, 1 << 20};
+	for (int i = 0; i < 3; i++) {
+		bad.target = targets[i];
+		fseek(cf, hdr.off_instrs + 2 * sizeof(instr_t), SEEK_SET);
+		fwrite(&bad, sizeof(bad), 1, cf);
+		fflush(cf);
+		if (load_cache(glob, &src, path)) {
+			fprintf(stderr, "TEST: CACHE - Jump target [%d] accepted.\n", targets[i]);
+			return 1;
+		}
+	}
+
+	bad = prog->instrs[2];
+	bad.form = N_EXEC;
+	fseek(cf, hdr.off_instrs + 2 * sizeof(instr_t), SEEK_SET);
+	fwrite(&bad, sizeof(bad), 1, cf);
+	fflush(cf);
+	if (load_cache(glob, &src, path)) {
+		fprintf(stderr, "TEST: CACHE - Handler out of range accepted.\n");
+		return 1;
+	}
+
+	fseek(cf, hdr.off_instrs + 2 * sizeof(instr_t), SEEK_SET);
+	fwrite(&prog->instrs[2], sizeof(instr_t), 1, cf);
+	hdr.off_lines += 4;
+	rewind(cf);
+	fwrite(&hdr, sizeof(hdr), 1, cf);
+	fflush(cf);
+	if (load_cache(glob, &src, path)) {
+		fprintf(stderr, "TEST: CACHE - Misaligned section accepted.\n");
+		return 1;
+	}
+
+	hdr.off_lines -= 4;
+	rewind(cf);
+	fwrite(&hdr, sizeof(hdr), 1, cf);
+	fclose(cf);
+	if (!(again = load_cache(glob, &src, path))) {
+		fprintf(stderr, "TEST: CACHE - Restored cache missed.\n");
+		return 1;
+	}
+	destroy_prog(again);
+
+	/* Same length, different content - must miss. */
+	s_1[12] = '6';
+	if (load_cache(glob, &src, path)) {
+		fprintf(stderr, "TEST: CACHE - Stale cache accepted.\n");
+		return 1;
+	}
+
+	destroy_prog(hit);
+	destroy_prog(prog);
+	unlink(path);
+
+	fclose(fd);
+	return 0;
+}
@@ -0,0 +1,207 @@
+/* Unit test for the C translator [EMIT]. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../asm.h"
+#include "../display.h"
+#include "../emit.h"
+#include "../exec.h"
+#include "../glob.h"
+
+#define WANT "/tmp/ase_emit_want.txt"
+#define GOT  "/tmp/ase_emit_got.txt"
+#define SRC  "/tmp/ase_emit.c"
+#define BIN  "/tmp/ase_emit"
+
+/* Reads path into buf, returns the length or -1. */
+static long slurp(const char *path, char *buf, size_t cap) {
+	FILE *fd = fopen(path, "r");
+	if (!fd) {
+		return -1;
+	}
+
+	long len = (long)fread(buf, 1, cap, fd);
+	fclose(fd);
+	return len;
+}
+
+/* Runs text on exec_prog() and the compiled translation, checks both print the same. */
+static int same_emit(glob_t *glob, const char *text, args_t args) {
+	static char want[8192], got[8192];
+	src_t src = {text, strlen(text), 0};
+
+	glob->prog = assemble(glob, &src);
+	if (!glob->prog) {
+		return 0;
+	}
+
+	reset_glob(glob);
+	int ok = emit_c(glob, args, SRC);
+
+	/* display() to a file, the way the emulator would show it on stdout. */
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	FILE *fd = fopen(WANT, "w");
+	if (!fd || saved < 0) {
+		return 0;
+	}
+	dup2(fileno(fd), STDOUT_FILENO);
+
+	int flag = exec_prog(glob);
+	display(glob, args);
+
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	fclose(fd);
+
+	ok = ok && !system("gcc -std=c11 -Wall -Wextra -Werror " SRC " -o " BIN);
+	int status = system(BIN " > " GOT " 2> /dev/null");
+	ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == flag;
+
+	long n_want = slurp(WANT, want, sizeof(want));
+	long n_got = slurp(GOT, got, sizeof(got));
+	ok = ok && n_want >= 0 && n_want == n_got && !memcmp(want, got, n_want);
+
+	destroy_prog(glob->prog);
+	glob->prog = NULL;
+	return ok;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: EMIT - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: EMIT - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	args_t args = {0};
+	args.f = args.m = args.r = 1;
+
+	/* Moves, arithmetic and memory written twice at one address. */
+	if (!same_emit(glob, "MOV AL, 12\n"
+	                     "MOV BX, 9876\n"
+	                     "MOV [10], 5\n"
+	                     "MOV [10], 7\n"
+	                     "MOV CX, [10]\n"
+	                     "XCHG DX, [20]\n"
+	                     "ADD [10], 2\n"
+	                     "SUB BX, CX\n"
+	                     "MUL BX\n"
+	                     "NEG CX\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Straight line mismatch.\n");
+		return 1;
+	}
+
+	/* Loops, the stack and the flag instructions. */
+	if (!same_emit(glob, "MOV CX, 10H\n"
+	                     "L1: ADD AX, CX\n"
+	                     "PUSH AX\n"
+	                     "POP [4]\n"
+	                     "ADD CX, 0FFFFH\n"
+	                     "JNE L1\n"
+	                     "STC\n"
+	                     "JC L2\n"
+	                     "MOV BX, 1\n"
+	                     "L2: CMC\n"
+	                     "LAHF\n"
+	                     "HLT\n"
+	                     "MOV DX, 1\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Loop mismatch.\n");
+		return 1;
+	}
+
+	/* Byte registers, the flags in AH and memory through DS. */
+	if (!same_emit(glob, "MOV DS, 1\n"
+	                     "MOV ES, 2\n"
+	                     "MOV AH, 0D5H\n"
+	                     "SAHF\n"
+	                     "INC BH\n"
+	                     "DEC BL\n"
+	                     "NEG CL\n"
+	                     "MOV SI, BX\n"
+	                     "XCHG DL, AH\n"
+	                     "LAHF\n"
+	                     "MOV [2], AX\n"
+	                     "PUSH DX\n"
+	                     "POP CH\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Byte register mismatch.\n");
+		return 1;
+	}
+
+	/* Effective addresses, BP on SS and segment overrides. */
+	if (!same_emit(glob, "MOV DS, 10H\n"
+	                     "MOV ES, 20H\n"
+	                     "MOV SS, 30H\n"
+	                     "MOV BX, 100H\n"
+	                     "MOV BP, 4\n"
+	                     "MOV SI, 2\n"
+	                     "MOV DI, 0FFFFH\n"
+	                     "MOV [BX+SI+6], 1234H\n"
+	                     "MOV [BP+DI-2], BX\n"
+	                     "MOV ES:[BX], 5\n"
+	                     "INC [BX+DI]\n"
+	                     "ADD AX, SS:[BP]\n"
+	                     "XCHG CX, [BX+SI+6]\n"
+	                     "POP [BP-4]\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Effective address mismatch.\n");
+		return 1;
+	}
+
+	/* Byte stores leave the next byte alone. */
+	if (!same_emit(glob, "MOV DS, 10H\n"
+	                     "MOV [100], 1234H\n"
+	                     "MOV AL, 0ABH\n"
+	                     "MOV [100], AL\n"
+	                     "MOV BL, [101]\n"
+	                     "INC BYTE[101]\n"
+	                     "MOV CX, [100]\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Byte memory mismatch.\n");
+		return 1;
+	}
+
+	if (!same_emit(glob, "MOV AL, 7FH\nADD AL, 1\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Byte overflow mismatch.\n");
+		return 1;
+	}
+
+	/* Runs that halt on an error keep their state and exit status. */
+	if (!same_emit(glob, "MOV AX, 1\nPOP BX\nMOV CX, 2\n", args)) {
+		fprintf(stderr, "TEST: EMIT - POP before PUSH mismatch.\n");
+		return 1;
+	}
+
+	if (!same_emit(glob, "MOV AX, 7FFFH\nADD AX, 1\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Overflow mismatch.\n");
+		return 1;
+	}
+
+	if (!same_emit(glob, "MOV AX, [5]\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Unwritten memory mismatch.\n");
+		return 1;
+	}
+
+	if (!same_emit(glob, "MOV AX, 1\nFOO BX\nMOV CX, 2\n", args)) {
+		fprintf(stderr, "TEST: EMIT - Unknown mnemonic mismatch.\n");
+		return 1;
+	}
+
+	remove(WANT);
+	remove(GOT);
+	remove(SRC);
+	remove(BIN);
+	destroy_glob(glob);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/* Unit test for the execution engine [EXEC]. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../bind.h"
+#include "../exec.h"
+#include "../glob.h"
+#include "same.h"
+
+/* Runs the program with call_instr() one instruction at a time. */
+static int step_all(glob_t *glob, void *arg) {
+	while (glob->ip < glob->prog->n) {
+		load_instr(glob, &glob->prog->instrs[glob->ip++]);
+		glob->steps++;
+
+		int ret = call_instr(glob, NULL, BUF_SZ);
+		if (ret == -1) {
+			return 0;
+		}
+		if (!ret) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int run_exec(glob_t *glob, void *arg) {
+	return exec_prog(glob);
+}
+
+/* Runs text on both loops, checks they end in the same state. */
+static int same_run(glob_t *glob, const char *text, int want_flag) {
+	int flag;
+	return same_runs(glob, text, step_all, run_exec, NULL, &flag) && flag == want_flag;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: EXEC - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: EXEC - Glob is NULL.\n");
+		return 1;
+	}
+
+	if (!same_run(glob, "MOV CX, 5\n"
+	                    "L1: ADD AX, 3\n"
+	                    "XCHG AX, BX\n"
+	                    "DEC CX\n"
+	                    "CMP CX, 0H\n"
+	                    "JNE L1\n"
+	                    "STC\n"
+	                    "MOV DX, CX\n", 0)) {
+		fprintf(stderr, "TEST: EXEC - Loop state mismatch.\n");
+		return 1;
+	}
+
+	/* Memory through each addressing form, and the stack. */
+	if (!same_run(glob, "MOV DS, 10H\n"
+	                    "MOV BX, 100H\n"
+	                    "MOV SI, 2\n"
+	                    "MOV [BX+SI+4], 1234H\n"
+	                    "MOV AL, 0ABH\n"
+	                    "MOV [BX], AL\n"
+	                    "PUSH [BX+SI+4]\n"
+	                    "PUSH BX\n"
+	                    "POP CX\n"
+	                    "INC BYTE[BX+1]\n", 0)) {
+		fprintf(stderr, "TEST: EXEC - Memory state mismatch.\n");
+		return 1;
+	}
+
+	if (!same_run(glob, "MOV AX, 1\nHLT\nMOV AX, 2\n", 0) || glob->steps != 2) {
+		fprintf(stderr, "TEST: EXEC - HLT did not stop the run.\n");
+		return 1;
+	}
+
+	if (!same_run(glob, "MOV AX, 1\nFOO AX\nMOV AX, 2\n", 1) || glob->c_line != 2) {
+		fprintf(stderr, "TEST: EXEC - Unknown mnemonic did not fail.\n");
+		return 1;
+	}
+
+	if (!same_run(glob, "MOV AX, 1\nNOP AX\nMOV AX, 2\n", 1) || glob->c_line != 2) {
+		fprintf(stderr, "TEST: EXEC - Operand count did not fail.\n");
+		return 1;
+	}
+
+	destroy_glob(glob);
+	return 0;
+}
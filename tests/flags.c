@@ -84,16 +84,23 @@ int main(void) {
 		return 1;
 	}
 
+	/* Literals leave the flags alone. */
 	parse_line(glob, l_8);
 	move(glob, NULL, BUF_SZ);
-	if (!glob->flags->zf) {
-		fprintf(stderr, "TEST: Flags - Move did not trigger zf.\n");
+	if (glob->flags->zf || glob->flags->pf) {
+		fprintf(stderr, "TEST: Flags - Move changed the flags.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_9);
 	math_op(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->ax, "1")) {
+	if (glob->flags->lz_op != LZ_ADD) {
+		fprintf(stderr, "TEST: Flags - ADD did not leave its flags pending.\n");
+		return 1;
+	}
+
+	flags_sync(glob->flags);
+	if (glob->registers->x[R_AX] != 1) {
 		fprintf(stderr, "TEST: Flags - MOV AX failed.\n");
 		return 1;
 	}
@@ -108,15 +115,35 @@ int main(void) {
 	
 	parse_line(glob, l_11);
 	math_op(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->ax, "0")) {
+	flags_sync(glob->flags);
+	if (glob->registers->x[R_AX] != 0) {
 		fprintf(stderr, "TEST: Flags - AX doesn't equal to 0. Error parsing -ve numbers.\n");
 		return 1;
 	}
 
-	if (glob->flags->zf != 1) {
-		fprintf(stderr, "TEST: Flags - zf did not change after MOV.\n");
+	if (glob->flags->zf != 1 || glob->flags->cf != 1 || glob->flags->pf != 1 ||
+		glob->flags->sf != 0 || glob->flags->of != 0 || glob->flags->af != 1) {
+		fprintf(stderr, "TEST: Flags - Wrong flags after -5 + 5.\n");
 		return 1;
 	}
+
+	/* CMP sets the flags of a SUB, each time. */
+	const char *cmps[][2] = {{"CMP AX, 1", "11100"}, {"CMP AX, 0", "00010"}, {"CMP AX, 8000H", "11001"}};
+	for (int i = 0; i < 3; i++) {
+		char line[BUF_SZ];
+		strcpy(line, cmps[i][0]);
+		parse_line(glob, line);
+		math_op(glob, NULL, BUF_SZ);
+
+		char got[6];
+		flags_sync(glob->flags);
+		sprintf(got, "%d%d%d%d%d", glob->flags->cf, glob->flags->sf,
+			glob->flags->af, glob->flags->zf, glob->flags->of);
+		if (strcmp(got, cmps[i][1])) {
+			fprintf(stderr, "TEST: Flags - [%s] set CF SF AF ZF OF to [%s].\n", cmps[i][0], got);
+			return 1;
+		}
+	}
 	
 	fclose(fd);
 	return 0;
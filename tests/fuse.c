@@ -0,0 +1,117 @@
+/* Unit test for superinstruction fusion [FUSE]. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../exec.h"
+#include "../fuse.h"
+#include "../glob.h"
+#include "same.h"
+
+/* What fuse_prog() did in a differential run. */
+typedef struct fuse_run {
+	int fused, restored;
+} fuse_run_t;
+
+/* Fuses and unfuses again, turning fusion off must restore every handler. */
+static int run_unfused(glob_t *glob, void *arg) {
+	fuse_run_t *run = arg;
+	prog_t *prog = glob->prog;
+
+	fuse_prog(prog, 1);
+	fuse_prog(prog, 0);
+	run->restored = 1;
+	for (int i = 0; i < prog->n; i++) {
+		run->restored &= prog->exec[i] == prog->instrs[i].form;
+	}
+
+	return exec_prog(glob);
+}
+
+static int run_fused(glob_t *glob, void *arg) {
+	((fuse_run_t *)arg)->fused = fuse_prog(glob->prog, 1);
+	return exec_prog(glob);
+}
+
+/* Runs text unfused and fused, checks the fused count and the end state. */
+static int same_fused(glob_t *glob, const char *text, int want) {
+	fuse_run_t run = {-1, 0};
+	int flag;
+
+	return same_runs(glob, text, run_unfused, run_fused, &run, &flag) &&
+	       run.restored && run.fused == want;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: FUSE - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: FUSE - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	/* Every conditional jump, taken and not taken. */
+	const char *jcc[] = {"JC", "JNC", "JE", "JNE", "JP", "JPE"};
+	const char *cmp[] = {"CMP AX, BX", "CMP AX, 3H", "CMP BX, AX", "CMP AX, 0", "CMP [10], 3"};
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 5; j++) {
+			char text[256];
+			snprintf(text, sizeof(text), "MOV [10], 3\nMOV AX, 3\nMOV BX, 5\nSTC\n"
+			                             "%s\n%s L1\nMOV CX, 1\nL1: MOV DX, 2\n",
+			                             cmp[j], jcc[i]);
+
+			if (!same_fused(glob, text, 3)) {
+				fprintf(stderr, "TEST: FUSE - [%s] + [%s] mismatch.\n", cmp[j], jcc[i]);
+				return 1;
+			}
+		}
+	}
+
+	/* Countdown loop, the CMP + JNE pair in it and the MOVs around it. */
+	if (!same_fused(glob, "MOV CX, 5\n"
+	                      "MOV AX, 0\n"
+	                      "L1: ADD AX, 2\n"
+	                      "DEC CX\n"
+	                      "CMP CX, 0H\n"
+	                      "JNE L1\n"
+	                      "MOV BX, AX\n"
+	                      "MOV DX, CX\n"
+	                      "MOV AX, 1\n", 3)) {
+		fprintf(stderr, "TEST: FUSE - Countdown loop mismatch.\n");
+		return 1;
+	}
+
+	/* DEC + JNE, ZF is left from the CMP before the loop (hex literals keep it). */
+	if (!same_fused(glob, "CMP AX, 0H\nMOV CX, 3H\nL1: INC BX\nDEC CX\nJNE L1\nHLT\n", 1)) {
+		fprintf(stderr, "TEST: FUSE - DEC + JNE mismatch.\n");
+		return 1;
+	}
+
+	/* Jump onto the second instruction of a pair. */
+	if (!same_fused(glob, "JMP L1\nMOV AX, 1\nL1: MOV BX, 2\nMOV CX, 3\n", 1)) {
+		fprintf(stderr, "TEST: FUSE - Jump into a pair mismatch.\n");
+		return 1;
+	}
+
+	/* The first instruction fails, the second never runs. */
+	if (!same_fused(glob, "MOV AX, BL\nMOV BX, 1\n", 1)) {
+		fprintf(stderr, "TEST: FUSE - Failing pair mismatch.\n");
+		return 1;
+	}
+
+	/* Operand count errors are left to the generic handlers. */
+	if (!same_fused(glob, "CMP AX\nJE L1\nL1: NOP\n", 0)) {
+		fprintf(stderr, "TEST: FUSE - Bad operand count fused.\n");
+		return 1;
+	}
+
+	destroy_glob(glob);
+	return 0;
+}
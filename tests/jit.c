@@ -0,0 +1,160 @@
+/* Unit test for the block translating tier [JIT]. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../exec.h"
+#include "../glob.h"
+#include "../jit.h"
+#include "../probe.h"
+#include "same.h"
+
+static int run_exec(glob_t *glob, void *arg) {
+	return exec_prog(glob);
+}
+
+static int run_jit(glob_t *glob, void *arg) {
+	return jit_prog(glob, arg);
+}
+
+/* Runs text on exec_prog() and jit_prog(), checks they end in the same state. */
+static int same_jit(glob_t *glob, const char *text, int want_flag, int want_blocks) {
+	int flag, blocks = 0;
+	int ok = same_runs(glob, text, run_exec, run_jit, &blocks, &flag) && flag == want_flag;
+
+#ifdef JIT_NATIVE
+	ok = ok && blocks == want_blocks;
+#endif
+
+	return ok;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: JIT - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: JIT - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	/* Too cold to translate. */
+	if (!same_jit(glob, "MOV CX, 3H\nL1: ADD AX, 2\nDEC CX\nCMP CX, 0H\nJNE L1\n", 0, 0)) {
+		fprintf(stderr, "TEST: JIT - Cold loop mismatch.\n");
+		return 1;
+	}
+
+	/* The loop body, then the code after it once the loop runs native. */
+	if (!same_jit(glob, "MOV CX, 40H\n"
+	                    "L1: ADD AX, 2\n"
+	                    "XCHG AX, BX\n"
+	                    "PUSH BX\n"
+	                    "POP DX\n"
+	                    "MOV [10], DX\n"
+	                    "DEC CX\n"
+	                    "CMP CX, 0H\n"
+	                    "JNE L1\n"
+	                    "MOV AX, [10]\n", 0, 1)) {
+		fprintf(stderr, "TEST: JIT - Counting loop mismatch.\n");
+		return 1;
+	}
+
+	/**
+	 * Every conditional jump, chained between two blocks. JP goes both
+	 * ways with the parity of BX - 5, so only the loop head gets hot.
+	 */
+	const char *jcc[] = {"JC", "JNC", "JE", "JNE", "JP", "JPE", "JCXZ"};
+	const int hot[]   = {2, 2, 2, 2, 1, 2, 2};
+	for (int i = 0; i < 7; i++) {
+		char text[256];
+		snprintf(text, sizeof(text), "MOV CX, 20H\n"
+		                             "L1: INC BX\n"
+		                             "CMP BX, 5H\n"
+		                             "%s L2\n"
+		                             "CMC\n"
+		                             "L2: ADD CX, 0FFFFH\n"
+		                             "JNE L1\n", jcc[i]);
+
+		if (!same_jit(glob, text, 0, hot[i])) {
+			fprintf(stderr, "TEST: JIT - [%s] mismatch.\n", jcc[i]);
+			return 1;
+		}
+	}
+
+	/* Inline code on AX .. DX, with byte registers and SI on their handlers in between. */
+	if (!same_jit(glob, "MOV CX, 30H\n"
+	                    "MOV DX, 8000H\n"
+	                    "L1: MOV AX, CX\n"
+	                    "MOV AL, 5\n"
+	                    "ADD AX, 3\n"
+	                    "SUB BX, AX\n"
+	                    "CMP DX, 1\n"
+	                    "MOV SI, BX\n"
+	                    "INC SI\n"
+	                    "DEC CX\n"
+	                    "JNE L1\n", 0, 1)) {
+		fprintf(stderr, "TEST: JIT - Inline arithmetic mismatch.\n");
+		return 1;
+	}
+
+	/* SUB out of range in translated code is reported and not stored. */
+	if (!same_jit(glob, "MOV BX, 8011H\nMOV CX, 12H\nL1: SUB BX, 1\nJP L2\nL2: DEC CX\nJNE L1\n", 0, 2)) {
+		fprintf(stderr, "TEST: JIT - SUB overflow mismatch.\n");
+		return 1;
+	}
+
+	/* ADD out of range in translated code fails. */
+	if (!same_jit(glob, "MOV AX, 7FE0H\nL1: ADD AX, 1\nJNE L1\n", 1, 1)) {
+		fprintf(stderr, "TEST: JIT - ADD overflow mismatch.\n");
+		return 1;
+	}
+
+	/* INC keeps the CF an ADD left pending. */
+	if (!same_jit(glob, "MOV CX, 20H\nL1: ADD AX, 0FFFFH\nINC BX\nJC L2\nL2: DEC CX\nJNE L1\n", 0, 2)) {
+		fprintf(stderr, "TEST: JIT - INC after ADD mismatch.\n");
+		return 1;
+	}
+
+	/* HLT inside translated code. */
+	if (!same_jit(glob, "L1: INC AX\nCMP AX, 20H\nJNE L1\nHLT\nMOV BX, 1\n", 0, 1)) {
+		fprintf(stderr, "TEST: JIT - HLT did not stop the run.\n");
+		return 1;
+	}
+
+	/* A handler failing inside translated code. */
+	if (!same_jit(glob, "L1: INC AX\nCMP AX, 20H\nJNE L1\nPOP BX\n", 1, 1)) {
+		fprintf(stderr, "TEST: JIT - Failing handler mismatch.\n");
+		return 1;
+	}
+
+	/* Instructions left to the dispatcher end a block early. */
+	if (!same_jit(glob, "L1: INC AX\nCMP AX, 20H\nJE L2\nJMP L1\nL2: NOP AX\n", 1, 2)) {
+		fprintf(stderr, "TEST: JIT - Operand count mismatch.\n");
+		return 1;
+	}
+
+	if (!same_jit(glob, "L1: INC AX\nFOO AX\nCMP AX, 20H\nJNE L1\n", 1, 0)) {
+		fprintf(stderr, "TEST: JIT - Unknown mnemonic mismatch.\n");
+		return 1;
+	}
+
+#ifdef PROBE_ON
+	/* Translated code calls out to the probes while a tracer is attached. */
+	PROBE_SEM(instr) = PROBE_SEM(jump) = 1;
+	if (!same_jit(glob, "MOV CX, 40H\nL1: ADD AX, 2\nCMP CX, 3\nJC L2\nL2: DEC CX\nJNE L1\n"
+	                    "JMP L3\nL3: HLT\n", 0, 2)) {
+		fprintf(stderr, "TEST: JIT - Traced run mismatch.\n");
+		return 1;
+	}
+	PROBE_SEM(instr) = PROBE_SEM(jump) = 0;
+#endif
+
+	destroy_glob(glob);
+	return 0;
+}
@@ -0,0 +1,117 @@
+/* Unit test for the paged memory [MEM]. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../exec.h"
+#include "../glob.h"
+
+/* Number of pages allocated. */
+static int n_pages(const glob_t *glob) {
+	int n = 0;
+	for (int pn = 0; pn < N_PAGES; pn++) {
+		n += glob->mem->pages[pn] != NULL;
+	}
+	return n;
+}
+
+/* Runs text from a clean state. */
+static int run(glob_t *glob, const char *text) {
+	src_t src = {text, strlen(text), 0};
+
+	glob->prog = assemble(glob, &src);
+	if (!glob->prog) {
+		return 1;
+	}
+
+	reset_glob(glob);
+	int ret = exec_prog(glob);
+
+	destroy_prog(glob->prog);
+	glob->prog = NULL;
+	return ret;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: MEM - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: MEM - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	/* An idle instance holds no memory, reads do not allocate it. */
+	if (n_pages(glob) || sizeof(mem_t) > 4 * 1024) {
+		fprintf(stderr, "TEST: MEM - Idle memory allocated.\n");
+		return 1;
+	}
+
+	if (run(glob, "MOV AX, [100]\nADD AX, [5000]\nCMP AX, [60000]\n") || n_pages(glob) ||
+		mem_read(glob->mem, 0x12345, 16)) {
+		fprintf(stderr, "TEST: MEM - Reads allocated memory.\n");
+		return 1;
+	}
+
+	/* Writes allocate the page they land on, once. */
+	if (run(glob, "MOV DS, 100H\nMOV [0], 1\nMOV [2], 2\nMOV DS, 200H\nMOV [4094], 3\n") ||
+		n_pages(glob) != 2 || !glob->mem->pages[1] || !glob->mem->pages[2] ||
+		mem_read(glob->mem, 0x1002, 16) != 2 || mem_read(glob->mem, 0x2ffe, 16) != 3) {
+		fprintf(stderr, "TEST: MEM - Wrong pages written.\n");
+		return 1;
+	}
+
+	/* A word on the last byte of a page straddles two. */
+	if (run(glob, "MOV DS, 0FFH\nMOV [15], 0ABCDH\nMOV BX, [15]\n") || n_pages(glob) != 2 ||
+		mem_read(glob->mem, 0xfff, 8) != 0xcd || mem_read(glob->mem, 0x1000, 8) != 0xab ||
+		glob->registers->x[R_BX] != 0xabcd) {
+		fprintf(stderr, "TEST: MEM - Word across pages.\n");
+		return 1;
+	}
+
+	/* The TLB follows writes to a page read before. */
+	if (run(glob, "MOV AX, [8]\nMOV [8], 7\nMOV BX, [8]\n") || glob->registers->x[R_BX] != 7 ||
+		glob->mem->tlb != glob->mem->pages[0]) {
+		fprintf(stderr, "TEST: MEM - Stale TLB.\n");
+		return 1;
+	}
+
+	/* Byte operands store and load one byte, the next one is left alone. */
+	const registers_t *regs = glob->registers;
+	if (run(glob, "MOV [100], 1234H\nMOV AL, 0ABH\nMOV [100], AL\nMOV AH, 7\nMOV [300], AH\n"
+	              "MOV BL, [101]\nMOV CL, [100]\nMOV DX, [100]\n") ||
+		mem_read(glob->mem, 100, 16) != 0x12ab || mem_read(glob->mem, 300, 16) != 7 ||
+		regs->x[R_BX] != 0x12 || regs->x[R_CX] != 0xab || regs->x[R_DX] != 0x12ab) {
+		fprintf(stderr, "TEST: MEM - Byte operand mismatch.\n");
+		return 1;
+	}
+
+	/* BYTE[..] when there is no register, INC wraps within the byte. */
+	if (run(glob, "MOV [200], 0FFFFH\nMOV [202], 0FFFFH\nMOV BYTE[200], 5\nINC BYTE[201]\n") ||
+		mem_read(glob->mem, 200, 16) != 5 || mem_read(glob->mem, 202, 16) != 0xffff) {
+		fprintf(stderr, "TEST: MEM - BYTE prefix mismatch.\n");
+		return 1;
+	}
+
+	/* A prefix must agree with the register. */
+	if (!run(glob, "MOV BYTE[10], AX\n") || run(glob, "MOV WORD[10], AX\n") ||
+		mem_read(glob->mem, 10, 16)) {
+		fprintf(stderr, "TEST: MEM - Operand size mismatch accepted.\n");
+		return 1;
+	}
+
+	reset_glob(glob);
+	if (n_pages(glob) || glob->mem->tlb_pn != N_PAGES) {
+		fprintf(stderr, "TEST: MEM - Reset kept pages.\n");
+		return 1;
+	}
+
+	destroy_glob(glob);
+	return 0;
+}
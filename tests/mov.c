@@ -31,35 +31,51 @@ int main(void) {
 
 	parse_line(glob, l_1);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->ax, "1234") != 0) {
+	if (glob->registers->x[R_AX] != 0x1234) {
 		fprintf(stderr, "Test: MOV - Failed to set AX value.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_2);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->bx, "1234") != 0) {
+	if (glob->registers->x[R_BX] != 0x1234) {
 		fprintf(stderr, "Test MOV: Failed to set BX value.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_3);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->cx, "") != 0) {
+	if (glob->registers->x[R_CX] != 0) {
 		fprintf(stderr, "TEST MOV: Failed to set DX value.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_4);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->dx, "34") != 0) {
+	if (glob->registers->x[R_DX] != 0x34) {
 		fprintf(stderr, "TEST MOV: Failed to set DL value.\n");
 		return 1;
 	}
 
-	int i = 0;
+	/* The bytes of a register are written on their own. */
+	char l_8[] = "MOV DH, 12H";
+	char l_9[] = "MOV AL, DH";
+	char l_10[] = "MOV SI, DX";
+
+	parse_line(glob, l_8);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_9);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_10);
+	move_r_r(glob, NULL, BUF_SZ);
+	if (glob->registers->x[R_DX] != 0x1234 || glob->registers->x[R_AX] != 0x1212 ||
+		glob->registers->x[R_SI] != 0x1234) {
+		fprintf(stderr, "TEST MOV: 8 bit registers are not aliased.\n");
+		return 1;
+	}
+
 	int   keys[] = {12, 123, 1234};
-	char *vals[] = {"39", "1234", "4d2"};
+	int   vals[] = {0x39, 0x1234, 0x4d2};
 
 	parse_line(glob, l_5);
 	move(glob, NULL, BUF_SZ);
@@ -70,24 +86,71 @@ int main(void) {
 	parse_line(glob, l_7);
 	move(glob, NULL, BUF_SZ);
 
-	mem_nodes_t *node = glob->mem->head;
-	while (node) {
-		if (node->addr != keys[i]) {
-			fprintf(stderr, "TEST MOV: Order mismatch [%d] - [%d].\n",
-				node->addr, keys[i]);
+	for (int i = 0; i < 3; i++) {
+		int val = mem_read(glob->mem, keys[i], 16);
+		if (val != vals[i]) {
+			fprintf(stderr, "TEST MOV: Value mismatch [%x] - [%x].\n", val, vals[i]);
 			return 1;
 		}
+	}
 
-		if (strcmp(node->val, vals[i])) {
-			fprintf(stderr, "TEST MOV: Value mismatch [%s] - [%s].\n",
-				node->val, vals[i]);
-		}
+	/* Words are little endian, DS:offset is DS * 16 + offset. */
+	char l_11[] = "MOV DS, 10H";
+	char l_12[] = "MOV [2], 1234H";
+	char l_13[] = "MOV AX, [2]";
+
+	parse_line(glob, l_11);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_12);
+	move_m_i(glob, NULL, BUF_SZ);
+	parse_line(glob, l_13);
+	move_r_m(glob, NULL, BUF_SZ);
+	if (mem_read(glob->mem, 0x102, 8) != 0x34 || mem_read(glob->mem, 0x103, 8) != 0x12 ||
+		glob->registers->x[R_AX] != 0x1234) {
+		fprintf(stderr, "TEST MOV: Wrong memory layout.\n");
+		return 1;
+	}
+
+	/* Addresses past 1 MiB wrap around, words too. */
+	char l_14[] = "MOV DS, 0FFFFH";
+	char l_15[] = "MOV [15], 5678H";
+	char l_16[] = "MOV [32], 9H";
 
-		node = node->next;
-		i++;
+	parse_line(glob, l_14);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_15);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_16);
+	move(glob, NULL, BUF_SZ);
+	if (mem_read(glob->mem, MEM_MASK, 8) != 0x78 || mem_read(glob->mem, 0, 8) != 0x56 ||
+		mem_read(glob->mem, 0x10, 8) != 0x9 || mem_read(glob->mem, MEM_PA(0xffff, 0xf), 16) != 0x5678) {
+		fprintf(stderr, "TEST MOV: Addresses do not wrap around.\n");
+		return 1;
+	}
+
+	/* Effective addresses are computed from the registers when they run. */
+	char l_17[] = "MOV DS, 100H";
+	char l_18[] = "MOV BX, 10H";
+	char l_19[] = "MOV SI, 2";
+	char l_20[] = "MOV [BX+SI+4], 0BEEFH";
+	char l_21[] = "MOV SI, 6";
+	char l_22[] = "MOV CX, [BX+SI]";
+	char l_23[] = "MOV SS, 200H";
+	char l_24[] = "MOV [BP+1], CX";
+	char l_25[] = "MOV ES:[SI], CX";
+
+	char *lines[] = {l_17, l_18, l_19, l_20, l_21, l_22, l_23, l_24, l_25};
+	for (int i = 0; i < 9; i++) {
+		parse_line(glob, lines[i]);
+		move(glob, NULL, BUF_SZ);
+	}
+
+	if (glob->registers->x[R_CX] != 0xbeef || mem_read(glob->mem, 0x1016, 16) != 0xbeef ||
+		mem_read(glob->mem, 0x2001, 16) != 0xbeef || mem_read(glob->mem, 0x6, 16) != 0xbeef) {
+		fprintf(stderr, "TEST MOV: Wrong effective address.\n");
+		return 1;
 	}
 
-	assert(i);
 	fclose(fd);
 	return 0;
-}
\ No newline at end of file
+}
@@ -40,5 +40,64 @@ int main(void) {
 		return 1;
 	}
 
+	/* Memory operands decode into their effective address form. */
+	const struct {
+		const char *text;
+		int ea, seg, val;
+	} eas[] = {
+		{"[1234]",        EA_DISP,  R_DS, 1234},
+		{"[4D2H]",        EA_DISP,  R_DS, 1234},
+		{"[bx+si]",       EA_BX_SI, R_DS, 0},
+		{"[DI+BX+4]",     EA_BX_DI, R_DS, 4},
+		{"[BP+SI-2]",     EA_BP_SI, R_SS, -2},
+		{"[BP+DI+300]",   EA_BP_DI, R_SS, 300},
+		{"[SI+1+1]",      EA_SI,    R_DS, 2},
+		{"[DI]",          EA_DI,    R_DS, 0},
+		{"[BP]",          EA_BP,    R_SS, 0},
+		{"[BX+0FFH]",     EA_BX,    R_DS, 255},
+		{"ES:[BX]",       EA_BX,    R_ES, 0},
+		{"SS:[SI]",       EA_SI,    R_SS, 0},
+		{"DS:[BP+2]",     EA_BP,    R_DS, 2},
+		{"CS:[10]",       EA_DISP,  R_CS, 10},
+	};
+
+	for (int i = 0; i < (int)(sizeof(eas) / sizeof(*eas)); i++) {
+		tok_t tok = {eas[i].text, strlen(eas[i].text)};
+		operand_t op;
+
+		if (!decode_op(&tok, 1, &op) || op.kind != OP_MEM || op.ea != eas[i].ea ||
+			op.reg != eas[i].seg || op.val != eas[i].val) {
+			fprintf(stderr, "TEST: PARSE - Wrong effective address of [%s].\n", eas[i].text);
+			return 1;
+		}
+	}
+
+	const char *bad[] = {"[BX+BP]", "[SI+DI]", "[AX]", "[BH]", "[BX+BX]", "[-BX]",
+	                     "[-4]", "[65536]", "[BX+]", "[X1]", "AX:[BX]", "[BX*2]"};
+	for (int i = 0; i < (int)(sizeof(bad) / sizeof(*bad)); i++) {
+		tok_t tok = {bad[i], strlen(bad[i])};
+		operand_t op;
+
+		if (decode_op(&tok, 1, &op)) {
+			fprintf(stderr, "TEST: PARSE - Invalid address [%s] decoded.\n", bad[i]);
+			return 1;
+		}
+	}
+
+	/* An empty token copies as an empty string, even without text. */
+	tok_t empty = {NULL, 0};
+	tok_str(&empty, buf, sizeof(buf));
+	if (buf[0] != '\0') {
+		fprintf(stderr, "TEST: PARSE - Empty token not copied as an empty string.\n");
+		return 1;
+	}
+
+	tok_t mov = {"MOV AX", 3};
+	tok_str(&mov, buf, 3);
+	if (strcmp(buf, "MO") != 0) {
+		fprintf(stderr, "TEST: PARSE - Token not cut to the buffer.\n");
+		return 1;
+	}
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+/* Unit test for instruction set plugins [PLUGIN]. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../exec.h"
+#include "../glob.h"
+#include "../jit.h"
+#include "../plugin.h"
+#include "../tengine.h"
+
+#define SRC "/tmp/ase_plugin.c"
+#define LIB "/tmp/ase_plugin.so"
+
+/* Doubles its operand. */
+static const char dbl_src[] =
+	"#include \"plugin.h\"\n"
+	"\n"
+	"static int dbl(glob_t *glob, char *buf, unsigned long size) {\n"
+	"\tint val, width;\n"
+	"\toperand_t *op = &glob->instr->ops[0];\n"
+	"\tif (!get_op_val(glob, op, &val)) {\n"
+	"\t\treturn 0;\n"
+	"\t}\n"
+	"\twidth = OP_WIDTH(op);\n"
+	"\treturn put_op_val(glob, 2 * VAL_SIGNED(val, width), op);\n"
+	"}\n"
+	"\n"
+	"static const plugin_instr_t instrs[] = {{\"DBL\", 1, dbl}};\n"
+	"%s\n";
+
+/* Builds a plugin out of dbl_src, tail ends the source. */
+static int build(const char *tail) {
+	FILE *fd = fopen(SRC, "w");
+	if (!fd) {
+		return 0;
+	}
+
+	fprintf(fd, dbl_src, tail);
+	fclose(fd);
+	return !system("gcc -std=c11 -shared -fPIC -I. " SRC " -o " LIB);
+}
+
+/* Runs text on exec_prog() or jit_prog(), returns the flag they return. */
+static int run(glob_t *glob, const char *text, int jit) {
+	src_t src = {text, strlen(text), 0};
+	int blocks;
+
+	glob->prog = assemble(glob, &src);
+	if (!glob->prog) {
+		return -1;
+	}
+
+	reset_glob(glob);
+	int flag = jit ? jit_prog(glob, &blocks) : exec_prog(glob);
+
+	destroy_prog(glob->prog);
+	glob->prog = NULL;
+	return flag;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: PLUGIN - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: PLUGIN - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	/* Rejected before anything is bound. */
+	if (load_plugin("/tmp/ase_plugin_none.so")) {
+		fprintf(stderr, "TEST: PLUGIN - Missing file loaded.\n");
+		return 1;
+	}
+
+	if (!build("") || load_plugin(LIB)) {
+		fprintf(stderr, "TEST: PLUGIN - Plugin without [%s] loaded.\n", PLUGIN_SYM);
+		return 1;
+	}
+
+	if (!build("const plugin_t ase_plugin = {PLUGIN_ABI - 1, sizeof(glob_t), \"old\", 1, instrs};") ||
+		load_plugin(LIB)) {
+		fprintf(stderr, "TEST: PLUGIN - Plugin of an older ABI loaded.\n");
+		return 1;
+	}
+
+	if (!build("const plugin_t ase_plugin = {PLUGIN_ABI, sizeof(glob_t) + 8, \"old\", 1, instrs};") ||
+		load_plugin(LIB)) {
+		fprintf(stderr, "TEST: PLUGIN - Plugin of another glob_t loaded.\n");
+		return 1;
+	}
+
+	if (find_opcode("DBL") != OPC_BAD) {
+		fprintf(stderr, "TEST: PLUGIN - Rejected plugin bound a mnemonic.\n");
+		return 1;
+	}
+
+	/* Mnemonics of the instruction set stay taken. */
+	if (!build("static const plugin_instr_t add[] = {{\"ADD\", 2, dbl}};\nPLUGIN(\"add\", add);") ||
+		load_plugin(LIB)) {
+		fprintf(stderr, "TEST: PLUGIN - Built-in mnemonic rebound.\n");
+		return 1;
+	}
+
+	if (!build("PLUGIN(\"dbl\", instrs);") || !load_plugin(LIB)) {
+		fprintf(stderr, "TEST: PLUGIN - Could not load plugin.\n");
+		return 1;
+	}
+
+	if (find_opcode("DBL") != OPC_EXT || find_opcode("ADD") != OPC_ADD || strcmp(opc_mnem(OPC_EXT), "DBL")) {
+		fprintf(stderr, "TEST: PLUGIN - DBL not bound to the first free opcode.\n");
+		return 1;
+	}
+
+	/* Dispatched like any other instruction, also from translated blocks. */
+	for (int jit = 0; jit < 2; jit++) {
+		if (run(glob, "MOV AX, 5H\nDBL AX\nMOV [4], AX\nDBL [4]\n", jit) ||
+			glob->registers->x[R_AX] != 0xa || mem_read(glob->mem, 4, 16) != 0x14) {
+			fprintf(stderr, "TEST: PLUGIN - DBL did not double [%d].\n", jit);
+			return 1;
+		}
+
+		if (run(glob, "MOV CX, 40H\nL1: DBL AX\nMOV AX, 1H\nADD CX, 0FFFFH\nJNE L1\n", jit) ||
+			glob->registers->x[R_AX] != 1) {
+			fprintf(stderr, "TEST: PLUGIN - DBL in a loop [%d].\n", jit);
+			return 1;
+		}
+
+		if (run(glob, "DBL AX, BX\n", jit) != 1) {
+			fprintf(stderr, "TEST: PLUGIN - Operand count not checked [%d].\n", jit);
+			return 1;
+		}
+	}
+
+	remove(SRC);
+	remove(LIB);
+	destroy_glob(glob);
+	return 0;
+}
@@ -0,0 +1,97 @@
+/* Differential fixture of the engine tests [EXEC] [FUSE] [JIT]. */
+
+#ifndef _ASE_TESTS_SAME_H_
+#define _ASE_TESTS_SAME_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../glob.h"
+
+/* Runs glob->prog from a clean state, returns 1 if it halted on an error. */
+typedef int (*run_fn)(glob_t *glob, void *arg);
+
+/* State a run ends in. */
+typedef struct run_state {
+	/**
+	 * flag  - what the run returned.
+	 * pages - copies of the written pages of memory, NULL where none.
+	 */
+	int flag, line, ip, top;
+	unsigned long steps;
+	registers_t regs;
+	flags_t flags;
+	uint8_t *pages[N_PAGES];
+} run_state_t;
+
+/* Takes the state glob was left in, 0 if a page could not be copied. */
+static int take_state(glob_t *glob, int flag, run_state_t *st) {
+	st->flag = flag;
+	st->line = glob->c_line;
+	st->ip = glob->ip;
+	st->top = glob->stack->top;
+	st->steps = glob->steps;
+	st->regs = *glob->registers;
+	st->flags = *glob->flags;
+	memset(st->pages, 0, sizeof(st->pages));
+
+	for (int pn = 0; pn < N_PAGES; pn++) {
+		if (glob->mem->pages[pn] && !(st->pages[pn] = malloc(PAGE_SZ))) {
+			return 0;
+		}
+
+		if (st->pages[pn]) {
+			memcpy(st->pages[pn], glob->mem->pages[pn], PAGE_SZ);
+		}
+	}
+
+	return 1;
+}
+
+/* Compares two pages, NULL reads as zeroes the way zero_page does. */
+static int same_page(const uint8_t *a, const uint8_t *b) {
+	static const uint8_t zero[PAGE_SZ];
+	return !memcmp(a ? a : zero, b ? b : zero, PAGE_SZ);
+}
+
+/**
+ * Assembles text and runs it with a, then with b, each from a clean
+ * state. Checks both end with the same result, line, ip, step count,
+ * registers, flags, memory and stack. glob is left as b left it.
+ */
+static int same_runs(glob_t *glob, const char *text, run_fn a, run_fn b, void *arg, int *flag) {
+	src_t src = {text, strlen(text), 0};
+	run_state_t st[2];
+	int ok = 1;
+
+	glob->prog = assemble(glob, &src);
+	if (!glob->prog) {
+		return 0;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		reset_glob(glob);
+		int f = (i ? b : a)(glob, arg);
+		ok = take_state(glob, f, &st[i]) && ok;
+	}
+
+	ok = ok && st[0].flag == st[1].flag && st[0].line == st[1].line &&
+	     st[0].ip == st[1].ip && st[0].top == st[1].top && st[0].steps == st[1].steps &&
+	     !memcmp(&st[0].regs, &st[1].regs, sizeof(registers_t)) &&
+	     !memcmp(&st[0].flags, &st[1].flags, sizeof(flags_t));
+
+	for (int pn = 0; pn < N_PAGES; pn++) {
+		ok = ok && same_page(st[0].pages[pn], st[1].pages[pn]);
+		free(st[0].pages[pn]);
+		free(st[1].pages[pn]);
+	}
+
+	*flag = st[1].flag;
+	destroy_prog(glob->prog);
+	glob->prog = NULL;
+	return ok;
+}
+
+#endif
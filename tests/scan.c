@@ -0,0 +1,56 @@
+/* Unit test for the character scanner [SCAN]. */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../scan.h"
+
+int main(void) {
+	for (int c = 0; c < 256; c++) {
+		int space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		if (!!sc_is(c, SC_SPACE) != space || !!sc_is(c, SC_DIGIT) != !!isdigit(c) ||
+		    !!sc_is(c, SC_ALPHA) != !!isalpha(c) || !!sc_is(c, SC_HEX) != !!isxdigit(c) ||
+		    !!sc_is(c, SC_DELIM) != (space || c == ';') || sc_upper(c) != toupper(c)) {
+			fprintf(stderr, "TEST: SCAN - Class table mismatch [%d].\n", c);
+			return 1;
+		}
+	}
+
+	/* Put the text against an unmapped page, so reads past it fault. */
+	char *map = mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED || mprotect(map + 4096, 4096, PROT_NONE)) {
+		fprintf(stderr, "TEST: SCAN - Could not map guard page.\n");
+		return 1;
+	}
+
+	char *buf = map + 4096 - 100;
+	for (int i = 0; i < 100; i++) {
+		buf[i] = i % 17 == 16 ? ' ' : i % 23 == 22 ? ';' : 'A' + i % 26;
+	}
+
+	for (int i = 0; i < 100; i++) {
+		for (int j = i + 1; j <= 100; j++) {
+			scan_mask_t m;
+			scan_line(buf + i, buf + j, &m);
+
+			int len = j - i < 64 ? j - i : 64;
+			unsigned long long word = 0, delim = 0;
+			for (int k = 0; k < len; k++) {
+				word |= (unsigned long long)(buf[i + k] != ' ') << k;
+				delim |= (unsigned long long)(buf[i + k] == ' ' || buf[i + k] == ';') << k;
+			}
+
+			if (m.base != buf + i || m.len != len || m.word != word || m.delim != delim) {
+				fprintf(stderr, "TEST: SCAN - Mask mismatch [%d, %d].\n", i, j);
+				return 1;
+			}
+		}
+	}
+
+	munmap(map, 8192);
+	return 0;
+}
@@ -0,0 +1,157 @@
+/* Unit test for the operand kind specialised handlers [SPEC]. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../exec.h"
+#include "../glob.h"
+#include "../tengine.h"
+
+/* Picked form of the only instruction in text. */
+static int form_of(glob_t *glob, const char *text) {
+	src_t src = {text, strlen(text), 0};
+	prog_t *prog = assemble(glob, &src);
+	int form = prog && prog->n == 1 ? prog->instrs[0].form : -1;
+
+	destroy_prog(prog);
+	return form;
+}
+
+/* Copies the memory of glob into ram, pages not written as zeroes. */
+static void copy_mem(glob_t *glob, uint8_t *ram) {
+	for (int pn = 0; pn < N_PAGES; pn++) {
+		const uint8_t *page = glob->mem->pages[pn];
+		memcpy(&ram[pn * PAGE_SZ], page ? page : zero_page, PAGE_SZ);
+	}
+}
+
+/* Runs the program once as assembled and once on generic handlers only. */
+static int same_state(glob_t *glob, const char *text) {
+	src_t src = {text, strlen(text), 0};
+	registers_t regs;
+	flags_t flags;
+	static uint8_t ram[MEM_SZ], now[MEM_SZ];
+	int flag, top, forms = 0;
+
+	glob->prog = assemble(glob, &src);
+	if (!glob->prog) {
+		return 0;
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		reset_glob(glob);
+		int f = exec_prog(glob);
+
+		copy_mem(glob, now);
+
+		if (!pass) {
+			regs = *glob->registers;
+			flags = *glob->flags;
+			flag = f;
+			top = glob->stack->top;
+			memcpy(ram, now, MEM_SZ);
+
+			for (int j = 0; j < glob->prog->n; j++) {
+				instr_t *instr = &glob->prog->instrs[j];
+				forms += instr->form != instr->opc;
+				instr->form = instr->opc;
+			}
+			continue;
+		}
+
+		int ok = forms && f == flag && top == glob->stack->top &&
+		         !memcmp(&regs, glob->registers, sizeof(regs)) &&
+		         !memcmp(&flags, glob->flags, sizeof(flags)) &&
+		         !memcmp(ram, now, MEM_SZ);
+
+		destroy_prog(glob->prog);
+		glob->prog = NULL;
+		return ok;
+	}
+
+	return 0;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: SPEC - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: SPEC - Glob is NULL.\n");
+		return 1;
+	}
+	glob->mem->warned = 1;
+
+	const struct {
+		const char *text;
+		int form;
+	} picks[] = {
+		{"MOV AX, 5\n",     FORM_MOV_REG_IMM},
+		{"mov bx, cx\n",    FORM_MOV_REG_REG},
+		{"MOV AL, BL\n",    FORM_MOV_REG_REG},
+		{"MOV AX, BL\n",    OPC_MOV},
+		{"MOV [100], 5\n",  FORM_MOV_MEM_IMM},
+		{"MOV [100], DX\n", FORM_MOV_MEM_REG},
+		{"MOV CX, [100]\n", FORM_MOV_REG_MEM},
+		{"MOV [1], [2]\n",  OPC_MOV},
+		{"ADD AX, BX\n",    FORM_ADD_REG_REG},
+		{"ADD [100], 1\n",  OPC_ADD},
+		{"CMP CX, 0H\n",    FORM_CMP_REG_IMM},
+		{"SUB DX, 1\n",     FORM_SUB_REG_IMM},
+		{"PUSH 12\n",       FORM_PUSH_IMM_NONE},
+		{"PUSH AX\n",       FORM_PUSH_REG_NONE},
+		{"PUSH AX, BX\n",   OPC_PUSH},
+		{"POP DX\n",        FORM_POP_REG_NONE},
+		{"XCHG AX, BX\n",   FORM_XCHG_REG_REG},
+		{"XCHG AX, [1]\n",  OPC_XCHG},
+		{"MUL BX\n",        OPC_MUL},
+		{"L1: JMP L1\n",    OPC_JMP},
+	};
+
+	for (int i = 0; i < (int)(sizeof(picks) / sizeof(*picks)); i++) {
+		if (form_of(glob, picks[i].text) != picks[i].form) {
+			fprintf(stderr, "TEST: SPEC - Wrong handler for [%s].\n", picks[i].text);
+			return 1;
+		}
+	}
+
+	if (!same_state(glob, "MOV AX, 10\n"
+	                      "MOV BX, 0AH\n"
+	                      "MOV [100], AX\n"
+	                      "MOV [102], 5\n"
+	                      "MOV CX, [100]\n"
+	                      "MOV AL, 12\n"
+	                      "ADD AX, BX\n"
+	                      "ADD AX, 3\n"
+	                      "ADD BX, 0\n"
+	                      "SUB CX, 1\n"
+	                      "SUB CX, CX\n"
+	                      "CMP AX, 0\n"
+	                      "CMP AX, AX\n"
+	                      "CMP BX, 7FFFH\n"
+	                      "PUSH AX\n"
+	                      "PUSH 12\n"
+	                      "PUSH [100]\n"
+	                      "POP CX\n"
+	                      "POP [106]\n"
+	                      "XCHG AX, BX\n"
+	                      "XCHG DX, DX\n"
+	                      "MOV AX, 7FFFH\n"
+	                      "ADD AX, 1\n")) {
+		fprintf(stderr, "TEST: SPEC - Specialised and generic handlers differ.\n");
+		return 1;
+	}
+
+	if (!same_state(glob, "PUSH AX\nPOP BX\nPOP CX\n")) {
+		fprintf(stderr, "TEST: SPEC - POP before PUSH differs.\n");
+		return 1;
+	}
+
+	destroy_glob(glob);
+	return 0;
+}
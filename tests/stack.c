@@ -30,39 +30,78 @@ int main(void) {
 
 	parse_line(glob, l_1);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->ax, "1234") != 0) {
+	if (glob->registers->x[R_AX] != 0x1234) {
 		fprintf(stderr, "TEST: STACK - Failed to set AX value.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_2);
 	move(glob, NULL, BUF_SZ);
-	if (strcmp(glob->registers->bx, "0") != 0) {
+	if (glob->registers->x[R_BX] != 0) {
 		fprintf(stderr, "TEST: STACK - Failed to set BX value.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_3);
 	push(glob, NULL, BUF_SZ);
-	if (glob->stack->top != 0 || strcmp(glob->stack->arr[0], "1234") != 0) {
+	if (glob->stack->top != 0 || glob->registers->x[R_SP] != 0xfffe ||
+		mem_read(glob->mem, 0xfffe, 16) != 0x1234) {
 		fprintf(stderr, "Test MOV: Could not push AX to stack.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_4);
 	push(glob, NULL, BUF_SZ);
-	if (glob->stack->top != 1 || strcmp(glob->stack->arr[1], "0") != 0) {
+	if (glob->stack->top != 1 || glob->registers->x[R_SP] != 0xfffc ||
+		mem_read(glob->mem, 0xfffc, 16) != 0) {
 		fprintf(stderr, "Test MOV: Could not push BX to stack.\n");
 		return 1;
 	}
 
 	parse_line(glob, l_5);
 	pop(glob, NULL, -1);
-	if (glob->stack->top != 0 || strcmp(glob->registers->dx, "0") != 0) {
+	if (glob->stack->top != 0 || glob->registers->x[R_DX] != 0 || glob->registers->x[R_SP] != 0xfffe) {
 		fprintf(stderr, "TEST MOV: Failed to pop to DX.\n");
 		return 1;
 	}
 
+	/* The stack lives at SS:SP, deeper than any fixed array. */
+	char l_6[] = "MOV SS, 2000H";
+	char l_7[] = "MOV SP, 0H";
+	char l_8[] = "PUSH CX";
+	char l_9[] = "POP CX";
+
+	parse_line(glob, l_6);
+	move(glob, NULL, BUF_SZ);
+	parse_line(glob, l_7);
+	move(glob, NULL, BUF_SZ);
+
+	parse_line(glob, l_8);
+	for (int i = 0; i < 1000; i++) {
+		glob->registers->x[R_CX] = i;
+		push(glob, NULL, BUF_SZ);
+	}
+
+	if (glob->stack->top != 1000 || glob->registers->x[R_SP] != (uint16_t)-2000 ||
+		mem_read(glob->mem, MEM_PA(0x2000, 0xfffe), 16) != 0 ||
+		mem_read(glob->mem, MEM_PA(0x2000, -2000), 16) != 999) {
+		fprintf(stderr, "TEST STACK: Deep stack not in SS:SP.\n");
+		return 1;
+	}
+
+	parse_line(glob, l_9);
+	for (int i = 999; i >= 0; i--) {
+		if (!pop(glob, NULL, BUF_SZ) || glob->registers->x[R_CX] != i) {
+			fprintf(stderr, "TEST STACK: Popped [%x] for [%x].\n", glob->registers->x[R_CX], i);
+			return 1;
+		}
+	}
+
+	if (glob->stack->top != 0 || glob->registers->x[R_SP] != 0) {
+		fprintf(stderr, "TEST STACK: SP not restored.\n");
+		return 1;
+	}
+
 	fclose(fd);
 	return 0;
 }
\ No newline at end of file
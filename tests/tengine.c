@@ -0,0 +1,84 @@
+/* Unit test for the opcode table [TENGINE]. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../tengine.h"
+
+#define NAME(name, f_ptr, n_ops) #name,
+
+static const char *names[] = {INSTR_SET(NAME)};
+static const int n_names = sizeof(names) / sizeof(*names);
+
+static uint32_t pack(const char *mnem) {
+	uint32_t key = 0;
+	for (int i = 0; i < 4 && mnem[i]; i++) {
+		key |= (uint32_t)(unsigned char)mnem[i] << (8 * i);
+	}
+	return key;
+}
+
+/* Returns 1 if no two mnemonics share a slot under mul. */
+static int is_perfect(uint32_t mul) {
+	unsigned char used[OPC_HASH_SLOTS] = {0};
+	for (int i = 0; i < n_names; i++) {
+		uint32_t slot = (pack(names[i]) * mul) >> (32 - OPC_HASH_BITS);
+		if (used[slot]++) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Prints a multiplier and the slots for tengine.h and tengine.c. */
+static void regenerate(void) {
+	for (uint32_t mul = 0x9e3779b1u; mul != 0x9e3779afu; mul += 2) {
+		if (!is_perfect(mul)) {
+			continue;
+		}
+
+		fprintf(stderr, "#define OPC_HASH_MUL   %#xu\n", mul);
+		for (uint32_t slot = 0; slot < OPC_HASH_SLOTS; slot++) {
+			for (int i = 0; i < n_names; i++) {
+				if (((pack(names[i]) * mul) >> (32 - OPC_HASH_BITS)) == slot) {
+					fprintf(stderr, "\t[%2u] = OPC_%s,\n", slot, names[i]);
+				}
+			}
+		}
+		return;
+	}
+
+	fprintf(stderr, "No multiplier found, raise OPC_HASH_BITS.\n");
+}
+
+int main(void) {
+	if (!is_perfect(OPC_HASH_MUL)) {
+		fprintf(stderr, "TEST: TENGINE - Mnemonics collide, new hash:\n");
+		regenerate();
+		return 1;
+	}
+
+	for (int i = 0; i < n_names; i++) {
+		if (strlen(names[i]) > 4 || find_opcode(names[i]) != (opc_t)(OPC_NONE + 1 + i)) {
+			fprintf(stderr, "TEST: TENGINE - [%s] resolved wrong, new hash:\n", names[i]);
+			regenerate();
+			return 1;
+		}
+	}
+
+	if (find_opcode("") != OPC_NONE) {
+		fprintf(stderr, "TEST: TENGINE - Empty mnemonic is not OPC_NONE.\n");
+		return 1;
+	}
+
+	const char *bad[] = {"FOO", "mov", "MOVS", "MOVX", "J", "PUSHA", "JCXZZ"};
+	for (int i = 0; i < (int)(sizeof(bad) / sizeof(*bad)); i++) {
+		if (find_opcode(bad[i]) != OPC_BAD) {
+			fprintf(stderr, "TEST: TENGINE - [%s] resolved to an opcode.\n", bad[i]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
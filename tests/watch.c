@@ -0,0 +1,104 @@
+/* Unit test for the watch mode re-assembly [WATCH]. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../asm.h"
+#include "../glob.h"
+#include "../watch.h"
+
+/* Patches a program of old into new, then checks it against new assembled whole. */
+static int same_as_whole(glob_t *glob, const char *old, const char *new) {
+	src_t s_old = {old, strlen(old), 0};
+	src_t s_new = {new, strlen(new), 0};
+	prog_t *prog = assemble(glob, &s_old);
+	prog_t *whole = assemble(glob, &s_new);
+
+	int ok = prog && whole && patch_prog(glob, prog, &s_new) &&
+	         prog->n == whole->n && prog->n_lines == whole->n_lines &&
+	         (!whole->n || !memcmp(prog->instrs, whole->instrs, whole->n * sizeof(instr_t))) &&
+	         (!whole->n_lines ||
+	          !memcmp(prog->lines, whole->lines, whole->n_lines * sizeof(unsigned int))) &&
+	         prog->labels->n == whole->labels->n;
+
+	for (int i = 0; ok && i < whole->labels->n; i++) {
+		sym_t *a = &whole->labels->syms[i];
+		sym_t *b = find_sym(prog->labels, a->name.ptr, a->name.len);
+		ok = b && b->line == a->line && b->idx == a->idx && b->name.ptr == a->name.ptr;
+	}
+
+	destroy_prog(prog);
+	destroy_prog(whole);
+	return ok;
+}
+
+int main(void) {
+	FILE *fd = fopen("tests/ph", "r");
+	if (!fd) {
+		fprintf(stderr, "TEST: WATCH - Could not open PH.\n");
+		return 1;
+	}
+
+	glob_t *glob = init_glob(fd);
+	if (!glob) {
+		fprintf(stderr, "TEST: WATCH - Glob is NULL.\n");
+		return 1;
+	}
+
+	const char *s_1 = "L1: MOV CX, 5\n"
+	                  "L2:\n"
+	                  "DEC CX\n"
+	                  "JNE L2\n"
+	                  "JMP L3\n"
+	                  "L3: HLT\n";
+
+	/* Operand changed. */
+	if (!same_as_whole(glob, s_1, "L1: MOV CX, 9\nL2:\nDEC CX\nJNE L2\nJMP L3\nL3: HLT\n")) {
+		fprintf(stderr, "TEST: WATCH - Changed line mismatch.\n");
+		return 1;
+	}
+
+	/* Lines and labels added between a jump and its target. */
+	if (!same_as_whole(glob, s_1, "L1: MOV CX, 5\nL2:\nDEC CX\nJNE L2\nJMP L3\n"
+	                              "L4: NOP\nNOP\nJE L4\nJMP L1\nL3: HLT\n")) {
+		fprintf(stderr, "TEST: WATCH - Inserted lines mismatch.\n");
+		return 1;
+	}
+
+	/* Blank line and comment added - the jumps keep their targets, lines move. */
+	if (!same_as_whole(glob, s_1, "L1: MOV CX, 5\n\n; wait\nL2:\nDEC CX\nJNE L2\nJMP L3\nL3: HLT\n")) {
+		fprintf(stderr, "TEST: WATCH - Added blank line mismatch.\n");
+		return 1;
+	}
+
+	/* Label moved, jumps from outside must follow it. */
+	if (!same_as_whole(glob, s_1, "L1: MOV CX, 5\nDEC CX\nL2: NOP\nJNE L2\nJMP L3\nL3: HLT\n")) {
+		fprintf(stderr, "TEST: WATCH - Moved label mismatch.\n");
+		return 1;
+	}
+
+	/* Lines removed at both ends, and no trailing line break. */
+	if (!same_as_whole(glob, s_1, "L2:\nDEC CX\nJNE L2") ||
+	    !same_as_whole(glob, "NOP", "NOP\nNOP\nL1: JMP L1\n") ||
+	    !same_as_whole(glob, s_1, "") ||
+	    !same_as_whole(glob, s_1, "L1: MOV CX, 5\nL2:\nDEC CX\nJNE L2\nL3: HLT\n")) {
+		fprintf(stderr, "TEST: WATCH - Trimmed source mismatch.\n");
+		return 1;
+	}
+
+	/* A label still in use removed - the program must stay as it was. */
+	src_t src = {s_1, strlen(s_1), 0};
+	const char *s_2 = "L1: MOV CX, 5\nDEC CX\nJNE L2\nJMP L3\nL3: HLT\n";
+	src_t edit = {s_2, strlen(s_2), 0};
+	prog_t *prog = assemble(glob, &src);
+	if (!prog || patch_prog(glob, prog, &edit) || glob->c_line != 3 ||
+	    prog->n != 5 || prog->instrs[2].target != 1 || prog->text != s_1) {
+		fprintf(stderr, "TEST: WATCH - Undefined label accepted.\n");
+		return 1;
+	}
+
+	destroy_prog(prog);
+	fclose(fd);
+	return 0;
+}
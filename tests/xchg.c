@@ -42,17 +42,17 @@ int main(void) {
 	parse_line(glob, l_5);
 	xchg(glob, NULL, BUF_SZ);
 
-	if ((strcmp(glob->mem->head->val, "b") != 0)) {
+	if (mem_read(glob->mem, 1128, 16) != 0xb) {
 		fprintf(stderr, "Test XCHG: [1128] value not modified.\n");
 		return 0;
 	}
 
-	if ((strcmp(glob->registers->ax, "a") != 0)) {
+	if (glob->registers->x[R_AX] != 0xa) {
 		fprintf(stderr, "Test XCHG: [AX] value not modified.\n");
 		return 0;
 	}
 
-	if ((strcmp(glob->registers->bx, "c") != 0)) {
+	if (glob->registers->x[R_BX] != 0xc) {
 		fprintf(stderr, "Test XCHG: [BX] value not modified.\n");
 		return 0;
 	}
@@ -0,0 +1,538 @@
+/**
+ * @file: watch.c
+ * @desc: Defines the watch mode. The directory of the source file is
+ *        watched with inotify, and once the file is saved only the
+ *        lines that differ from the previous version are assembled
+ *        again. The instruction array, the line map and the label table
+ *        are patched in place.
+ *
+ *        Only the changed lines are tokenised. An edit that keeps the
+ *        number of lines and instructions and touches no label only
+ *        rewrites the replaced instructions. Otherwise the rest of the
+ *        program is moved and renumbered with plain integer passes.
+ *        Finding the changed bytes compares both versions, a block at a
+ *        time, and the label names are moved to the new text, so a save
+ *        is never entirely free of the size of the file.
+ */
+
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <malloc.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "asm.h"
+#include "watch.h"
+
+/* Time to wait for more events once the file was saved, in ms. */
+#define WATCH_SETTLE 50
+
+/* Bytes the two versions are compared by, before the byte that differs is looked for. */
+#define WATCH_BLOCK 256
+
+/* The lines of the old program that are replaced, and by what. */
+typedef struct patch {
+	/**
+	 * a, b    - old lines [a, b) are replaced, counted from 0.
+	 * i0, i1  - old instructions [i0, i1) are replaced.
+	 * d_line  - change in the number of lines.
+	 * d_instr - change in the number of instructions.
+	 * d_byte  - change in the length of the source.
+	 * r1      - offset of the first old byte past the replaced lines.
+	 * part    - the new lines, label indices relative to i0.
+	 * refs    - label operand of every instruction in part.
+	 * retarget - set if a jump outside the replaced lines may change
+	 *           target, else only their line numbers move.
+	 */
+	int a, b, i0, i1;
+	int d_line, d_instr, retarget;
+	long d_byte;
+	unsigned long r1;
+	prog_t *part;
+	tok_t *refs;
+} patch_t;
+
+/**
+ * @desc  : Returns the name of the file path points to.
+ * @param : path - path of the file.
+ * @return: const char* - the name, a view into path.
+ */
+static const char *base_name(const char *path) {
+	const char *name = strrchr(path, '/');
+	return name ? name + 1 : path;
+}
+
+/**
+ * @desc  : Counts the bytes two texts begin with, a block at a time.
+ * @param : a, b - texts.
+ *          max  - length of the shorter one.
+ * @return: unsigned long - number of equal bytes.
+ */
+static unsigned long same_head(const char *a, const char *b, unsigned long max) {
+	unsigned long n = 0;
+	while (n + WATCH_BLOCK <= max && !memcmp(a + n, b + n, WATCH_BLOCK)) {
+		n += WATCH_BLOCK;
+	}
+
+	while (n < max && a[n] == b[n]) {
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * @desc  : Counts the bytes two texts end with, a block at a time.
+ * @param : a, b - one past the end of the texts.
+ *          max  - bytes that may be compared.
+ * @return: unsigned long - number of equal bytes.
+ */
+static unsigned long same_tail(const char *a, const char *b, unsigned long max) {
+	unsigned long n = 0;
+	while (n + WATCH_BLOCK <= max && !memcmp(a - n - WATCH_BLOCK, b - n - WATCH_BLOCK, WATCH_BLOCK)) {
+		n += WATCH_BLOCK;
+	}
+
+	while (n < max && a[-1 - (long)n] == b[-1 - (long)n]) {
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * @desc  : Returns the first line that starts past off.
+ * @param : prog - program.
+ *          off  - offset into the source text.
+ * @return: int  - index into the line map, n_lines if there is none.
+ */
+static int line_after(prog_t *prog, unsigned long off) {
+	int lo = 0, hi = prog->n_lines;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (prog->lines[mid] > off) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * @desc  : Returns the first instruction on a line past ln.
+ * @param : prog - program.
+ *          ln   - source line number.
+ * @return: int  - index of the instruction, n if there is none.
+ */
+static int instr_after(prog_t *prog, int ln) {
+	int lo = 0, hi = prog->n;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (prog->instrs[mid].line > ln) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * @desc  : Checks if a label of the old program is on a replaced line.
+ * @param : p   - patch.
+ *          sym - label.
+ * @return: int - 0 if no, 1 if yes.
+ */
+static int replaced(patch_t *p, sym_t *sym) {
+	return sym->line > p->a && sym->line <= p->b;
+}
+
+/**
+ * @desc  : Resolves a label against the patched program.
+ * @param : p    - patch.
+ *          prog - program being patched.
+ *          ref  - label name.
+ * @return: int  - index of the instruction in the patched program, -1
+ *                 if the label is not declared.
+ */
+static int resolve(patch_t *p, prog_t *prog, tok_t *ref) {
+	sym_t *sym = find_sym(p->part->labels, ref->ptr, ref->len);
+	if (sym) {
+		return p->i0 + sym->idx;
+	}
+
+	sym = find_sym(prog->labels, ref->ptr, ref->len);
+	if (!sym || replaced(p, sym)) {
+		return -1;
+	}
+
+	return sym->line <= p->a ? sym->idx : sym->idx + p->d_instr;
+}
+
+/**
+ * @desc  : Resolves a jump outside the replaced lines that pointed into
+ *          them. Its label name is read back from the new source.
+ * @param : p     - patch.
+ *          prog  - program being patched.
+ *          src   - new source.
+ *          instr - the jump.
+ * @return: int   - new target, -1 if the label is no longer declared.
+ */
+static int re_resolve(patch_t *p, prog_t *prog, src_t *src, instr_t *instr) {
+	unsigned long off = prog->lines[instr->line - 1];
+	int ln = instr->line;
+
+	if (ln > p->b) {
+		off += p->d_byte;
+		ln += p->d_line;
+	}
+
+	const char *line = src->base + off;
+	const char *eol = memchr(line, '\n', src->len - off);
+	instr_t tmp;
+	tok_t toks[3], label;
+
+	if (!tokenize(line, eol ? eol : src->base + src->len, ln, &tmp, toks, &label)) {
+		return -1;
+	}
+
+	int target = resolve(p, prog, &toks[1]);
+	if (target < 0) {
+		fprintf(stderr, "Undefined label [%.*s] @ [%d].\n", toks[1].len, toks[1].ptr, ln);
+	}
+
+	return target;
+}
+
+/**
+ * @desc  : Checks the new lines against the rest of the program and
+ *          resolves their jumps. Nothing is modified yet, so a bad edit
+ *          leaves the previous program intact.
+ * @param : glob  -
+ *          p     - patch.
+ *          prog  - program being patched.
+ *          src   - new source.
+ *          fixes - receives the new target of every jump in the old
+ *                  program, -1 where it does not change. Not used
+ *                  unless p->retarget is set.
+ * @return: int   - 0 if a label is duplicated or undefined, 1 if success.
+ */
+static int check_patch(glob_t *glob, patch_t *p, prog_t *prog, src_t *src, int *fixes) {
+	symtab_t *labels = p->part->labels;
+	for (int i = 0; i < labels->n; i++) {
+		sym_t *sym = find_sym(prog->labels, labels->syms[i].name.ptr, labels->syms[i].name.len);
+		if (sym && !replaced(p, sym)) {
+			int line = sym->line > p->b ? sym->line + p->d_line : sym->line;
+			fprintf(stderr, "Duplicate label [%.*s] @ [%d], first declared @ [%d].\n",
+				labels->syms[i].name.len, labels->syms[i].name.ptr,
+				labels->syms[i].line, line);
+			glob->c_line = labels->syms[i].line;
+			return 0;
+		}
+	}
+
+	for (int i = 0; i < p->part->n; i++) {
+		instr_t *instr = &p->part->instrs[i];
+		if (instr->ops[0].kind != OP_LABEL || instr->n_op != 1) {
+			continue;
+		}
+
+		if ((instr->target = resolve(p, prog, &p->refs[i])) < 0) {
+			fprintf(stderr, "Undefined label [%.*s] @ [%d].\n",
+				p->refs[i].len, p->refs[i].ptr, instr->line);
+			glob->c_line = instr->line;
+			return 0;
+		}
+	}
+
+	for (int i = 0; p->retarget && i < prog->n; i++) {
+		instr_t *instr = &prog->instrs[i];
+		fixes[i] = -1;
+
+		if (i >= p->i0 && i < p->i1) {
+			continue;
+		}
+
+		if (instr->ops[0].kind != OP_LABEL || instr->n_op != 1) {
+			continue;
+		}
+
+		/* Pointed at a replaced line, or at the label-only line before. */
+		if (instr->target >= p->i0 && instr->target <= p->i1) {
+			if ((fixes[i] = re_resolve(p, prog, src, instr)) < 0) {
+				glob->c_line = instr->line > p->b ? instr->line + p->d_line : instr->line;
+				return 0;
+			}
+		} else if (instr->target > p->i1) {
+			fixes[i] = instr->target + p->d_instr;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @desc  : Splices the new lines into the program.
+ * @param : p     - checked patch.
+ *          prog  - program being patched.
+ *          src   - new source.
+ *          fixes - jump targets from check_patch().
+ * @return: int   - 0 if fail, 1 if success.
+ */
+static int apply_patch(patch_t *p, prog_t *prog, src_t *src, int *fixes) {
+	int n = prog->n + p->d_instr;
+	int n_lines = prog->n_lines + p->d_line;
+
+	if (n > prog->cap) {
+		instr_t *instrs = realloc(prog->instrs, n * sizeof(instr_t));
+		if (!instrs) {
+			fprintf(stderr, "apply_patch(): realloc failure.\n");
+			return 0;
+		}
+
+		prog->instrs = instrs;
+		prog->cap = n;
+	}
+
+	if (n_lines > prog->l_cap) {
+		unsigned int *lines = realloc(prog->lines, n_lines * sizeof(unsigned int));
+		if (!lines) {
+			fprintf(stderr, "apply_patch(): realloc failure.\n");
+			return 0;
+		}
+
+		prog->lines = lines;
+		prog->l_cap = n_lines;
+	}
+
+	/* Labels, before their names are moved to the new source. */
+	symtab_t *labels = prog->labels;
+	for (int i = labels->n - 1; i >= 0; i--) {
+		if (replaced(p, &labels->syms[i])) {
+			del_sym(labels, labels->syms[i].name.ptr, labels->syms[i].name.len);
+		}
+	}
+
+	for (int i = 0; i < labels->n; i++) {
+		sym_t *sym = &labels->syms[i];
+		unsigned long off = sym->name.ptr - prog->text;
+
+		sym->name.ptr = src->base + (off >= p->r1 ? off + p->d_byte : off);
+		if (sym->line > p->b && (p->d_line || p->d_instr)) {
+			sym->line += p->d_line;
+			sym->idx += p->d_instr;
+		}
+	}
+
+	for (int i = 0; i < p->part->labels->n; i++) {
+		sym_t *sym = &p->part->labels->syms[i];
+		if (!add_sym(labels, &sym->name, sym->line, sym->idx + p->i0)) {
+			return 0;
+		}
+	}
+
+	/**
+	 * Instructions, renumbered in place before the tail moves. Without
+	 * new targets, the instructions before the edit keep everything and
+	 * the ones after only change if lines were added or removed.
+	 */
+	int first = p->retarget ? 0 : p->d_line ? p->i1 : prog->n;
+	for (int i = first; i < prog->n; i++) {
+		if (i >= p->i0 && i < p->i1) {
+			continue;
+		}
+
+		if (p->retarget && fixes[i] >= 0) {
+			prog->instrs[i].target = fixes[i];
+		}
+
+		if (i >= p->i1) {
+			prog->instrs[i].line += p->d_line;
+		}
+	}
+
+	/* An empty program or replacement has no array to copy from. */
+	if (p->d_instr && p->i1 < prog->n) {
+		memmove(&prog->instrs[p->i0 + p->part->n], &prog->instrs[p->i1],
+			(prog->n - p->i1) * sizeof(instr_t));
+	}
+
+	if (p->part->n) {
+		memcpy(&prog->instrs[p->i0], p->part->instrs, p->part->n * sizeof(instr_t));
+	}
+
+	prog->n = n;
+
+	/* Line map. */
+	for (int i = p->b; p->d_byte && i < prog->n_lines; i++) {
+		prog->lines[i] += p->d_byte;
+	}
+
+	if (p->d_line && p->b < prog->n_lines) {
+		memmove(&prog->lines[p->a + p->part->n_lines], &prog->lines[p->b],
+			(prog->n_lines - p->b) * sizeof(unsigned int));
+	}
+
+	if (p->part->n_lines) {
+		memcpy(&prog->lines[p->a], p->part->lines, p->part->n_lines * sizeof(unsigned int));
+	}
+
+	prog->n_lines = n_lines;
+
+	prog->text = src->base;
+	prog->text_len = src->len;
+
+	/* The handlers no longer match, exec_prog() builds them again. */
+	free(prog->exec);
+	prog->exec = NULL;
+	return 1;
+}
+
+/**
+ * @desc  : Starts watching the source file. The directory is watched,
+ *          since editors often save by renaming a new file over it.
+ * @param : path - path of the source file.
+ * @return: int  - inotify descriptor, -1 if fail.
+ */
+int init_watch(const char *path) {
+	char dir[PATH_MAX];
+	const char *name = base_name(path);
+
+	if (name == path) {
+		strcpy(dir, ".");
+	} else {
+		snprintf(dir, sizeof(dir), "%.*s", (int)(name - path), path);
+	}
+
+	int wfd = inotify_init1(IN_CLOEXEC);
+	if (wfd < 0 || inotify_add_watch(wfd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		fprintf(stderr, "init_watch(): Could not watch [%s].\n", dir);
+		if (wfd >= 0) {
+			close(wfd);
+		}
+
+		return -1;
+	}
+
+	printf("Watching %s for changes.\n", path);
+	return wfd;
+}
+
+/**
+ * @desc  : Patches prog to match a new version of its source. Only the
+ *          lines between the first and the last changed byte are
+ *          tokenised. If the new lines do not assemble, prog is left as
+ *          it was.
+ * @param : glob -
+ *          prog - program assembled from the previous version, its text
+ *                 must still be readable.
+ *          src  - new version of the source. prog refers to it from now
+ *                 on, the previous version can be released.
+ * @return: int  - 0 if fail, 1 if success.
+ */
+int patch_prog(glob_t *glob, prog_t *prog, src_t *src) {
+	if (!glob || !prog || !src) {
+		fprintf(stderr, "patch_prog(): nullptr received.\n");
+		return 0;
+	}
+
+	if (prog->map) {
+		fprintf(stderr, "patch_prog(): Cannot patch a cached program.\n");
+		return 0;
+	}
+
+	const char *old = prog->text, *new = src->base;
+	unsigned long o_len = prog->text_len, n_len = src->len;
+	unsigned long max = o_len < n_len ? o_len : n_len;
+	unsigned long pre = 0, suf = 0;
+
+	/* Bytes both versions begin and end with. */
+	pre = same_head(old, new, max);
+	suf = same_tail(old + o_len, new + n_len, max - pre);
+
+	patch_t p;
+	memset(&p, 0, sizeof(patch_t));
+
+	/* Old lines [a, b) hold every changed byte. */
+	p.a = line_after(prog, pre) - 1;
+	if (pre == o_len && (!o_len || old[o_len - 1] == '\n')) {
+		p.a = prog->n_lines;
+	}
+
+	p.a = p.a < 0 ? 0 : p.a;
+	p.b = line_after(prog, o_len - suf);
+	p.b = p.b < p.a ? p.a : p.b;
+
+	unsigned long r0 = p.a < prog->n_lines ? prog->lines[p.a] : o_len;
+	p.r1 = p.b < prog->n_lines ? prog->lines[p.b] : o_len;
+	p.d_byte = (long)n_len - (long)o_len;
+
+	p.part = assemble_lines(glob, src, new + r0, new + p.r1 + p.d_byte, p.a, &p.refs);
+	if (!p.part) {
+		return 0;
+	}
+
+	p.i0 = instr_after(prog, p.a);
+	p.i1 = instr_after(prog, p.b);
+	p.d_line = p.part->n_lines - (p.b - p.a);
+	p.d_instr = p.part->n - (p.i1 - p.i0);
+
+	/* Jumps keep their targets unless instructions or labels came or went. */
+	p.retarget = p.d_instr || p.part->labels->n;
+	for (int i = 0; !p.retarget && i < prog->labels->n; i++) {
+		p.retarget = replaced(&p, &prog->labels->syms[i]);
+	}
+
+	int *fixes = p.retarget ? malloc((prog->n + 1) * sizeof(int)) : NULL;
+	int ok = (fixes || !p.retarget) && check_patch(glob, &p, prog, src, fixes) &&
+	         apply_patch(&p, prog, src, fixes);
+
+	free(fixes);
+	free(p.refs);
+	destroy_prog(p.part);
+	return ok;
+}
+
+/**
+ * @desc  : Blocks until the source file is saved. Editors often write
+ *          a file in several steps, so events arriving right after the
+ *          first one are drained.
+ * @param : wfd  - inotify descriptor from init_watch().
+ *          path - path of the source file.
+ * @return: int  - 0 if the watch failed, 1 once the file was saved.
+ */
+int wait_watch(int wfd, const char *path) {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const char *name = base_name(path);
+	int saved = 0;
+
+	while (1) {
+		struct pollfd pfd = {wfd, POLLIN, 0};
+		if (saved && poll(&pfd, 1, WATCH_SETTLE) <= 0) {
+			return 1;
+		}
+
+		ssize_t len = read(wfd, buf, sizeof(buf));
+		if (len <= 0) {
+			fprintf(stderr, "wait_watch(): Could not read events.\n");
+			return 0;
+		}
+
+		for (char *ptr = buf; ptr < buf + len; ) {
+			struct inotify_event *ev = (struct inotify_event *)ptr;
+			if (ev->len && !strcmp(ev->name, name)) {
+				saved = 1;
+			}
+
+			ptr += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+}
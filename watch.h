@@ -0,0 +1,17 @@
+/**
+ * @file: watch.h
+ * @desc: Declares the watch mode - re-assembling only the lines of the
+ *        source that changed since the previous run.
+ */
+
+#ifndef _ASE_WATCH_H_
+#define _ASE_WATCH_H_
+
+#include "glob.h"
+#include "load.h"
+
+int init_watch (const char *path);
+int patch_prog (glob_t *glob, prog_t *prog, src_t *src);
+int wait_watch (int wfd, const char *path);
+
+#endif